@@ -0,0 +1,158 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+// Compare binary serialization through std::streambuf with
+// serialization to and from a contiguous buffer.
+
+#include "traverse.h"
+#include "traverse-buffer.h"
+#include "test.h"
+#include "bench.h"
+
+// The same fields as Point, but always read and written a field at a
+// time, to measure what visit_fixed() saves
+struct SlowPoint {
+  int x, y;
+};
+TRAVERSE_STRUCT(SlowPoint, FIELD(x) FIELD(y))
+
+constexpr bool visit_fixed(traverse::BufferSerialize&, const SlowPoint&) { return false; }
+constexpr bool visit_fixed(traverse::BufferDeserialize&, SlowPoint&) { return false; }
+
+
+int main(int argc, char** argv) {
+  bench_init("buffer", argc, argv);
+  Polygon polygon{BLUE, Mood::SAD, Charred::START, "benchmark", {}};
+  for (int i = 0; i < 50000; i++) {
+    polygon.points.push_back(Point{i * 37 - 100000, (i * 7919) % 200000});
+  }
+
+  std::stringbuf reference;
+  traverse::BinarySerialize reference_writer(reference);
+  visit(reference_writer, polygon);
+  const std::string msg = reference.str();
+  const size_t size = msg.size();
+  size_t total = 0;
+
+  bench("serialize streambuf", size, [&]() {
+    std::stringbuf buf;
+    traverse::BinarySerialize writer(buf);
+    visit(writer, polygon);
+    total += buf.str().size();
+  });
+
+  std::vector<uint8_t> bytes;
+  bench("serialize buffer", size, [&]() {
+    bytes.clear();
+    traverse::BufferSerialize writer(bytes);
+    visit(writer, polygon);
+    writer.Finish();
+    total += bytes.size();
+  });
+
+  Polygon output;
+  bench("deserialize streambuf", size, [&]() {
+    std::stringbuf buf(msg);
+    traverse::BinaryDeserialize reader(buf);
+    visit(reader, output);
+    total += output.points.size();
+  });
+
+  bench("deserialize buffer", size, [&]() {
+    traverse::BufferDeserialize reader(reinterpret_cast<const uint8_t*>(msg.data()), size);
+    visit(reader, output);
+    total += output.points.size();
+  });
+
+  // Structs that only hold numbers are written and read all at once;
+  // compare with the same struct read and written a field at a time
+  const std::vector<Point>& points = polygon.points;
+  std::vector<SlowPoint> slow_points;
+  for (const Point& point : points) {
+    slow_points.push_back(SlowPoint{point.x, point.y});
+  }
+  std::vector<uint8_t> points_bytes;
+  {
+    traverse::BufferSerialize writer(points_bytes);
+    visit(writer, points);
+  }
+
+  bench("serialize vector<Point> field by field", points_bytes.size(), [&]() {
+    bytes.clear();
+    traverse::BufferSerialize writer(bytes);
+    visit(writer, slow_points);
+    writer.Finish();
+    total += bytes.size();
+  });
+
+  bench("serialize vector<Point> whole structs", points_bytes.size(), [&]() {
+    bytes.clear();
+    traverse::BufferSerialize writer(bytes);
+    visit(writer, points);
+    writer.Finish();
+    total += bytes.size();
+  });
+
+  std::vector<SlowPoint> slow_points_output;
+  bench("deserialize vector<Point> field by field", points_bytes.size(), [&]() {
+    traverse::BufferDeserialize reader(points_bytes);
+    visit(reader, slow_points_output);
+    total += slow_points_output.size();
+  });
+
+  std::vector<Point> points_output;
+  bench("deserialize vector<Point> whole structs", points_bytes.size(), [&]() {
+    traverse::BufferDeserialize reader(points_bytes);
+    visit(reader, points_output);
+    total += points_output.size();
+  });
+
+  std::vector<uint8_t> columns_bytes;
+  {
+    traverse::BufferSerialize writer(columns_bytes);
+    writer.columnar = true;
+    visit(writer, points);
+  }
+
+  bench("serialize vector<Point> columns", columns_bytes.size(), [&]() {
+    bytes.clear();
+    traverse::BufferSerialize writer(bytes);
+    writer.columnar = true;
+    visit(writer, points);
+    writer.Finish();
+    total += bytes.size();
+  });
+
+  bench("deserialize vector<Point> columns", columns_bytes.size(), [&]() {
+    traverse::BufferDeserialize reader(columns_bytes);
+    reader.columnar = true;
+    visit(reader, points_output);
+    total += points_output.size();
+  });
+
+  std::vector<int> numbers;
+  for (int i = 0; i < 1000000; i++) {
+    numbers.push_back(int((int64_t(i) * 7919) % 100000) - 50000);
+  }
+  std::stringbuf numbers_buf;
+  traverse::BinarySerialize numbers_writer(numbers_buf);
+  visit(numbers_writer, numbers);
+  const std::string numbers_msg = numbers_buf.str();
+
+  std::vector<int> numbers_output;
+  bench("deserialize vector<int> streambuf", numbers_msg.size(), [&]() {
+    std::stringbuf buf(numbers_msg);
+    traverse::BinaryDeserialize reader(buf);
+    visit(reader, numbers_output);
+    total += numbers_output.size();
+  });
+
+  bench("deserialize vector<int> buffer", numbers_msg.size(), [&]() {
+    traverse::BufferDeserialize reader(reinterpret_cast<const uint8_t*>(numbers_msg.data()), numbers_msg.size());
+    visit(reader, numbers_output);
+    total += numbers_output.size();
+  });
+
+  std::printf("(checksum %zu)\n", total);
+}
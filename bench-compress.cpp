@@ -0,0 +1,58 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+// Throughput of BinarySerialize and BinaryDeserialize through the
+// compressing streambufs in traverse-compress.h, over each payload
+// shape. MB/s is for the uncompressed bytes.
+
+#include "traverse.h"
+#include "traverse-compress.h"
+#include "bench-payloads.h"
+#include "bench.h"
+
+
+int main(int argc, char** argv) {
+  bench_init("compress", argc, argv);
+  size_t total = 0;
+
+  for_each_payload([&](const std::string& name, const auto& payload) {
+    using T = std::decay_t<decltype(payload)>;
+    size_t size = binary_size(payload);
+
+    auto run = [&](const std::string& codec, auto make_compressor, auto make_decompressor) {
+      std::stringbuf reference;
+      {
+        traverse::CompressStreambuf<decltype(make_compressor())> compressed(reference, make_compressor());
+        traverse::BinarySerialize writer(compressed);
+        visit(writer, payload);
+      }
+      const std::string msg = reference.str();
+      std::printf("%-40s %10zu bytes, %.1f%% of %zu\n", (codec + " " + name).c_str(),
+                  msg.size(), 100.0 * double(msg.size()) / double(size), size);
+
+      bench("BinarySerialize+" + codec + " " + name, size, [&]() {
+        std::stringbuf buf;
+        traverse::CompressStreambuf<decltype(make_compressor())> compressed(buf, make_compressor());
+        traverse::BinarySerialize writer(compressed);
+        visit(writer, payload);
+        compressed.Finish();
+        total += buf.str().size();
+      });
+
+      bench(codec + "+BinaryDeserialize " + name, size, [&]() {
+        std::stringbuf buf(msg);
+        traverse::DecompressStreambuf<decltype(make_decompressor())> decompressed(buf, make_decompressor());
+        traverse::BinaryDeserialize reader(decompressed);
+        T output;
+        visit(reader, output);
+        total += reader.Errors().size();
+      });
+    };
+
+    run("LZ4", [] { return traverse::Lz4Compressor(); }, [] { return traverse::Lz4Decompressor(); });
+    run("zstd", [] { return traverse::ZstdCompressor(); }, [] { return traverse::ZstdDecompressor(); });
+  });
+
+  std::printf("(checksum %zu)\n", total);
+}
@@ -0,0 +1,47 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+// Throughput of the Lua visitors over each payload shape. There's no
+// Lua encoding to measure, so MB/s is for the size of the binary
+// serialization of the same data.
+
+#include "traverse.h"
+#include "traverse-lua.h"
+#include "bench-payloads.h"
+#include "bench.h"
+
+
+int main(int argc, char** argv) {
+  bench_init("lua", argc, argv);
+  lua_State* L = luaL_newstate();
+  luaL_openlibs(L);
+  size_t total = 0;
+
+  for_each_payload([&](const std::string& name, const auto& payload) {
+    using T = std::decay_t<decltype(payload)>;
+    const size_t size = binary_size(payload);
+
+    bench("LuaWriter " + name, size, [&]() {
+      traverse::LuaWriter writer{L};
+      visit(writer, payload);    // stack: value
+      total += size_t(lua_type(L, -1));
+      lua_pop(L, 1);             // stack: 
+    });
+
+    traverse::LuaWriter reference_writer{L};
+    visit(reference_writer, payload); // stack: reference
+    bench("LuaReader " + name, size, [&]() {
+      lua_pushvalue(L, -1);      // stack: reference reference
+      std::stringstream errors;
+      traverse::LuaReader reader{L, errors};
+      T output;
+      visit(reader, output);     // stack: reference
+      total += size_t(errors.tellp());
+    });
+    lua_pop(L, 1);               // stack:
+  });
+
+  lua_close(L);
+  std::printf("(checksum %zu)\n", total);
+}
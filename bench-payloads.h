@@ -0,0 +1,72 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#ifndef BENCH_PAYLOADS_H
+#define BENCH_PAYLOADS_H
+
+// Data shared by the benchmarks, built from the types in test.h. Each
+// benchmark program runs its visitors over every payload with
+// for_each_payload(f), which calls f(name, payload).
+
+#include <string>
+#include <vector>
+#include "traverse.h"
+#include "test.h"
+
+// For nested structs; kept shallow enough for the Lua stack
+struct Node {
+  int value;
+  std::string label;
+  std::vector<Node> children;
+};
+TRAVERSE_STRUCT(Node, FIELD(value) FIELD(label) FIELD(children))
+
+inline Polygon make_polygon(int points) {
+  Polygon polygon{BLUE, Mood::SAD, Charred::START, "benchmark polygon", {}};
+  for (int i = 0; i < points; i++) {
+    polygon.points.push_back(Point{i * 37 - 100000, (i * 7919) % 200000});
+  }
+  return polygon;
+}
+
+inline std::vector<std::string> make_long_strings() {
+  std::vector<std::string> strings;
+  for (int i = 0; i < 100; i++) {
+    std::string s;
+    for (int j = 0; j < 10000; j++) {
+      s.push_back(char('a' + (i * 31 + j) % 26));
+    }
+    strings.push_back(s);
+  }
+  return strings;
+}
+
+inline Node make_tree(int depth, int value = 1) {
+  Node node{value, "node " + std::to_string(value), {}};
+  if (depth > 1) {
+    node.children.push_back(make_tree(depth - 1, value * 2));
+    node.children.push_back(make_tree(depth - 1, value * 2 + 1));
+  }
+  return node;
+}
+
+template<typename Function>
+void for_each_payload(Function f) {
+  f("polygon-small", make_polygon(3));
+  f("polygon-large", make_polygon(10000));
+  f("long-strings", make_long_strings());
+  f("tree", make_tree(8));
+}
+
+// Size of the binary serialization, for visitors that don't produce
+// bytes of their own
+template<typename T>
+size_t binary_size(const T& obj) {
+  traverse::SizeCounter counter;
+  visit(counter, obj);
+  return counter.size;
+}
+
+
+#endif
@@ -0,0 +1,45 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+// Throughput of the picojson visitors over each payload shape
+
+#include "traverse.h"
+#include "traverse-picojson.h"
+#include "bench-payloads.h"
+#include "bench.h"
+
+
+int main(int argc, char** argv) {
+  bench_init("picojson", argc, argv);
+  size_t total = 0;
+
+  for_each_payload([&](const std::string& name, const auto& payload) {
+    using T = std::decay_t<decltype(payload)>;
+
+    picojson::value reference;
+    traverse::PicoJsonWriter reference_writer{reference};
+    visit(reference_writer, payload);
+    const std::string text = reference.serialize();
+
+    // Serializing is part of writing, as it would be for real output
+    bench("PicoJsonWriter " + name, text.size(), [&]() {
+      picojson::value json;
+      traverse::PicoJsonWriter writer{json};
+      visit(writer, payload);
+      total += json.serialize().size();
+    });
+
+    bench("PicoJsonReader " + name, text.size(), [&]() {
+      picojson::value json;
+      picojson::parse(json, text);
+      std::stringstream errors;
+      traverse::PicoJsonReader reader{json, errors};
+      T output;
+      visit(reader, output);
+      total += size_t(errors.tellp());
+    });
+  });
+
+  std::printf("(checksum %zu)\n", total);
+}
@@ -0,0 +1,62 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+// Throughput of the rapidjson visitors over each payload shape
+
+#include "traverse.h"
+#include "traverse-rapidjson.h"
+#include "bench-payloads.h"
+#include "bench.h"
+
+
+int main(int argc, char** argv) {
+  bench_init("rapidjson", argc, argv);
+  size_t total = 0;
+
+  for_each_payload([&](const std::string& name, const auto& payload) {
+    using T = std::decay_t<decltype(payload)>;
+
+    rapidjson::StringBuffer reference;
+    traverse::RapidJsonWriter reference_writer{reference};
+    visit(reference_writer, payload);
+    const std::string text = reference.GetString();
+
+    bench("RapidJsonWriter " + name, text.size(), [&]() {
+      rapidjson::StringBuffer json;
+      traverse::RapidJsonWriter writer{json};
+      visit(writer, payload);
+      total += json.GetSize();
+    });
+
+    std::vector<char> buffer(text.size());
+    bench("RapidJsonWriter to buffer " + name, text.size(), [&]() {
+      traverse::JsonBufferStream output(buffer.data(), buffer.size());
+      traverse::BasicRapidJsonWriter<traverse::JsonBufferStream> writer{output};
+      visit(writer, payload);
+      total += output.size();
+    });
+
+    // Parsing is part of reading, as it would be for real input
+    bench("RapidJsonReader " + name, text.size(), [&]() {
+      rapidjson::Document json;
+      json.Parse(text.c_str());
+      std::stringstream errors;
+      traverse::RapidJsonReader reader{json, errors};
+      T output;
+      visit(reader, output);
+      total += size_t(errors.tellp());
+    });
+
+    bench("RapidJsonSaxReader " + name, text.size(), [&]() {
+      rapidjson::StringStream stream(text.c_str());
+      std::stringstream errors;
+      traverse::RapidJsonSaxReader reader{stream, errors};
+      T output;
+      visit(reader, output);
+      total += size_t(errors.tellp());
+    });
+  });
+
+  std::printf("(checksum %zu)\n", total);
+}
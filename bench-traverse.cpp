@@ -0,0 +1,68 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+// Throughput of the visitors in traverse.h over each payload shape
+
+#include "traverse.h"
+#include "traverse-text.h"
+#include "bench-payloads.h"
+#include "bench.h"
+
+
+int main(int argc, char** argv) {
+  bench_init("traverse", argc, argv);
+  size_t total = 0;
+
+  for_each_payload([&](const std::string& name, const auto& payload) {
+    using T = std::decay_t<decltype(payload)>;
+
+    std::stringbuf reference;
+    traverse::BinarySerialize reference_writer(reference);
+    visit(reference_writer, payload);
+    const std::string msg = reference.str();
+
+    bench("BinarySerialize " + name, msg.size(), [&]() {
+      std::stringbuf buf;
+      traverse::BinarySerialize writer(buf);
+      visit(writer, payload);
+      total += buf.str().size();
+    });
+
+    bench("BinaryDeserialize " + name, msg.size(), [&]() {
+      std::stringbuf buf(msg);
+      traverse::BinaryDeserialize reader(buf);
+      T output;
+      visit(reader, output);
+      total += reader.Errors().size();
+    });
+
+    bench("SizeCounter " + name, msg.size(), [&]() {
+      traverse::SizeCounter counter;
+      visit(counter, payload);
+      total += counter.size;
+    });
+
+    std::stringstream reference_text;
+    traverse::CoutWriter reference_cout(reference_text);
+    visit(reference_cout, payload);
+    const size_t text_size = reference_text.str().size();
+
+    bench("CoutWriter " + name, text_size, [&]() {
+      std::stringstream out;
+      traverse::CoutWriter writer(out);
+      visit(writer, payload);
+      total += size_t(out.tellp());
+    });
+
+    bench("TextWriter " + name, text_size, [&]() {
+      std::stringstream out;
+      traverse::TextWriter writer(out);
+      visit(writer, payload);
+      writer.Flush();
+      total += size_t(out.tellp());
+    });
+  });
+
+  std::printf("(checksum %zu)\n", total);
+}
@@ -0,0 +1,71 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+// Throughput of the variant visitors in traverse-variant.h
+
+#include "traverse.h"
+#include "traverse-variant.h"
+#include "bench-payloads.h"
+#include "bench.h"
+
+using Shape = traverse::variant<Point, Polygon, std::string>;
+
+std::vector<Shape> make_shapes(int count) {
+  std::vector<Shape> shapes;
+  for (int i = 0; i < count; i++) {
+    switch (i % 3) {
+    case 0: shapes.emplace_back(Point{i, -i}); break;
+    case 1: shapes.emplace_back(make_polygon(5)); break;
+    case 2: shapes.emplace_back(std::string("shape ") + std::to_string(i)); break;
+    }
+  }
+  return shapes;
+}
+
+
+int main(int argc, char** argv) {
+  bench_init("variant", argc, argv);
+  size_t total = 0;
+  const std::vector<Shape> shapes = make_shapes(3000);
+
+  std::stringbuf reference;
+  traverse::BinarySerialize reference_writer(reference);
+  visit(reference_writer, shapes);
+  const std::string msg = reference.str();
+
+  bench("BinarySerialize variants", msg.size(), [&]() {
+    std::stringbuf buf;
+    traverse::BinarySerialize writer(buf);
+    visit(writer, shapes);
+    total += buf.str().size();
+  });
+
+  bench("BinaryDeserialize variants", msg.size(), [&]() {
+    std::stringbuf buf(msg);
+    traverse::BinaryDeserialize reader(buf);
+    std::vector<Shape> output;
+    visit(reader, output);
+    total += reader.Errors().size();
+  });
+
+  bench("SizeCounter variants", msg.size(), [&]() {
+    traverse::SizeCounter counter;
+    visit(counter, shapes);
+    total += counter.size;
+  });
+
+  std::stringstream reference_text;
+  traverse::CoutWriter reference_cout(reference_text);
+  visit(reference_cout, shapes);
+  const size_t text_size = reference_text.str().size();
+
+  bench("CoutWriter variants", text_size, [&]() {
+    std::stringstream out;
+    traverse::CoutWriter writer(out);
+    visit(writer, shapes);
+    total += size_t(out.tellp());
+  });
+
+  std::printf("(checksum %zu)\n", total);
+}
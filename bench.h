@@ -0,0 +1,75 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include "test-alloc.h"
+
+// Helper function for the benchmarks. Runs the function until enough
+// time has passed to get a stable measurement, then prints the
+// throughput and the number of heap allocations per call. Keep the
+// result of the function somewhere observable so that the compiler
+// doesn't optimize the work away.
+//
+// Call bench_init() at the start of main. If the benchmark is run
+// with a file name argument, each result is also appended to that
+// file as one line of JSON, for tracking results over time:
+//
+//   {"suite":"traverse","name":"BinarySerialize polygon-small","bytes_per_op":55,
+//    "mb_per_s":812.3,"objects_per_s":14769000.0,"ns_per_op":67.7,"allocations_per_op":1.00}
+
+struct BenchOptions {
+  const char* suite = "";
+  std::FILE* json = nullptr;
+};
+inline BenchOptions bench_options;
+
+inline void bench_init(const char* suite, int argc, char** argv) {
+  bench_options.suite = suite;
+  if (argc > 1) {
+    bench_options.json = std::fopen(argv[1], "a");
+    if (bench_options.json == nullptr) {
+      std::perror(argv[1]);
+    }
+  }
+}
+
+template<typename Function>
+double bench(const std::string& name, size_t bytes_per_op, Function function) {
+  using clock = std::chrono::steady_clock;
+  const std::chrono::duration<double> min_time(0.5);
+  size_t ops = 0;
+  size_t allocations = allocation_count;
+  auto start = clock::now();
+  std::chrono::duration<double> elapsed(0);
+  do {
+    function();
+    ++ops;
+    elapsed = clock::now() - start;
+  } while (elapsed < min_time);
+  allocations = allocation_count - allocations;
+  double seconds_per_op = elapsed.count() / ops;
+  double mb_per_second = bytes_per_op / seconds_per_op / 1e6;
+  double allocations_per_op = double(allocations) / ops;
+  std::printf("%-40s %10.1f MB/s %12.1f ops/s %10.2f allocs/op\n",
+              name.c_str(), mb_per_second, 1.0 / seconds_per_op, allocations_per_op);
+  if (bench_options.json != nullptr) {
+    std::fprintf(bench_options.json,
+                 "{\"suite\":\"%s\",\"name\":\"%s\",\"bytes_per_op\":%zu,"
+                 "\"mb_per_s\":%.1f,\"objects_per_s\":%.1f,\"ns_per_op\":%.1f,"
+                 "\"allocations_per_op\":%.2f}\n",
+                 bench_options.suite, name.c_str(), bytes_per_op,
+                 mb_per_second, 1.0 / seconds_per_op, seconds_per_op * 1e9,
+                 allocations_per_op);
+    std::fflush(bench_options.json);
+  }
+  return mb_per_second;
+}
+
+
+#endif
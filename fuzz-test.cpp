@@ -8,16 +8,56 @@
  */
 
 #include "traverse.h"
+#include "traverse-buffer.h"
 #include <iostream>
 #include <fstream>
+#include <iterator>
+#include <cstdlib>
 #include "test.h"
 
 using namespace std;
 
-int main() {
-  Polygon P;
-  traverse::BinaryDeserialize reader(*cin.rdbuf());
+// The streambuf and contiguous buffer readers have different code
+// paths for numbers; they must agree on every input, valid or not
+template<typename T>
+void decode_both(const string& input, bool print) {
+  T P{}, Q{};
+  stringbuf buf(input);
+  traverse::BinaryDeserialize reader(buf);
   visit(reader, P);
-  std::cout << P << "\n";
-  std::cout << reader.Errors() << "\n";
+  traverse::BufferDeserialize buffer_reader(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+  visit(buffer_reader, Q);
+  if (print) {
+    traverse::CoutWriter writer(cout);
+    visit(writer, P);
+    cout << "\n" << reader.Errors() << "\n";
+  }
+  if (!(P == Q) || reader.Errors().empty() != buffer_reader.Errors().empty()) {
+    abort();
+  }
+
+  // Stopping at the first error finds the same first error
+  T R{};
+  traverse::BufferDeserialize fast_reader(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+  fast_reader.fail_fast = true;
+  visit(fast_reader, R);
+  if (fast_reader.errors.summary() != buffer_reader.errors.summary()
+      || (buffer_reader.Errors().empty() && !(R == Q))) {
+    abort();
+  }
+}
+
+bool operator == (const Point& a, const Point& b) {
+  return a.x == b.x && a.y == b.y;
+}
+
+bool operator == (const Polygon& a, const Polygon& b) {
+  return a.color == b.color && a.mood == b.mood && a.charred == b.charred
+    && a.name == b.name && a.points == b.points;
+}
+
+int main() {
+  string input((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+  decode_both<Polygon>(input, true);
+  decode_both<vector<int>>(input, false);
 }
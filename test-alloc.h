@@ -0,0 +1,52 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#ifndef TEST_ALLOC_H
+#define TEST_ALLOC_H
+
+// Count heap allocations, for unit tests that check how often a
+// visitor allocates. This replaces the global operator new, so it
+// can only be included in one source file of a program.
+
+#include <cstdlib>
+#include <new>
+
+static size_t allocation_count = 0;
+
+void* operator new(std::size_t size) {
+  ++allocation_count;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+// At -O2, gcc inlines these into library code and then warns that the
+// pointer from operator new is passed to free, which is what we want
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// Returns how many allocations f() made
+template<typename Function>
+size_t count_allocations(Function f) {
+  size_t before = allocation_count;
+  f();
+  return allocation_count - before;
+}
+
+#endif
@@ -0,0 +1,185 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#include "traverse.h"
+#include "traverse-batch.h"
+#include <iostream>
+#include "test.h"
+
+
+std::vector<Polygon> make_messages() {
+  std::vector<Polygon> messages;
+  for (int i = 0; i < 10; i++) {
+    messages.push_back(make_message_polygon(i, i));
+  }
+  return messages;
+}
+
+std::vector<uint8_t> to_vector(const std::string& bytes) {
+  return std::vector<uint8_t>(bytes.begin(), bytes.end());
+}
+
+// Read every record and check that it matches the message
+void test_read_all(traverse::BatchReader& reader, const std::vector<Polygon>& messages) {
+  TEST_EQ(reader.size(), messages.size());
+  for (size_t i = 0; i < reader.size(); i++) {
+    Polygon polygon;
+    TEST_EQ_QUIET(reader.read(i, polygon), true);
+    TEST_EQ_QUIET(to_string(polygon), to_string(messages[i]));
+  }
+  TEST_EQ(reader.Errors(), "");
+}
+
+
+void test_records() {
+  std::cout << "__ Size prefixed records __" << std::endl;
+  const auto messages = make_messages();
+  std::stringbuf buf;
+  traverse::RecordWriter writer(buf);
+  for (const auto& message : messages) {
+    writer.add(message);
+  }
+  const std::vector<uint8_t> bytes = to_vector(buf.str());
+
+  traverse::BatchReader reader(bytes, traverse::BatchFormat::RECORDS);
+  TEST_EQ(reader.Errors(), "");
+  TEST_EQ(reader.used(), bytes.size());
+  test_read_all(reader, messages);
+
+  // Each record is the BinarySerialize format
+  std::stringbuf one;
+  traverse::BinarySerialize serialize(one);
+  visit(serialize, messages[3]);
+  auto record = reader.record(3);
+  TEST_EQ(std::string(record.begin(), record.end()), one.str());
+
+  // Records before a truncated record can still be read
+  std::vector<uint8_t> truncated(bytes.begin(), bytes.end() - 3);
+  traverse::BatchReader reader2(truncated, traverse::BatchFormat::RECORDS);
+  TEST_EQ(reader2.size(), messages.size() - 1);
+  TEST_EQ(reader2.Errors(), "Error: record 9 goes past the end of the input\n");
+  Polygon polygon;
+  TEST_EQ(reader2.read(8, polygon), true);
+  TEST_EQ(to_string(polygon), to_string(messages[8]));
+}
+
+
+void test_indexed() {
+  std::cout << "__ Indexed batch __" << std::endl;
+  const auto messages = make_messages();
+  std::stringbuf buf;
+  {
+    traverse::BatchWriter writer(buf);
+    for (const auto& message : messages) {
+      writer.add(message);
+    }
+    TEST_EQ(writer.size(), messages.size());
+  }
+  std::vector<uint8_t> bytes = to_vector(buf.str());
+
+  traverse::BatchReader reader(bytes);
+  TEST_EQ(reader.Errors(), "");
+  TEST_EQ(reader.used(), bytes.size());
+  test_read_all(reader, messages);
+
+  // Random access, in any order, without reading the other records
+  traverse::BatchReader reader2(bytes);
+  Polygon polygon;
+  TEST_EQ(reader2.read(7, polygon), true);
+  TEST_EQ(to_string(polygon), to_string(messages[7]));
+  TEST_EQ(reader2.read(2, polygon), true);
+  TEST_EQ(to_string(polygon), to_string(messages[2]));
+  TEST_EQ(reader2.read(10, polygon), false);
+  TEST_EQ(reader2.Errors(), "Error: record 10 not in batch of 10 records\n");
+
+  // Data after the batch isn't part of it
+  bytes.push_back(42);
+  traverse::BatchReader reader3(bytes);
+  TEST_EQ(reader3.Errors(), "");
+  TEST_EQ(reader3.used(), bytes.size() - 1);
+  test_read_all(reader3, messages);
+}
+
+
+void test_writer_reuse() {
+  std::cout << "__ Reuse the batch writer __" << std::endl;
+  const auto messages = make_messages();
+  std::stringbuf buf;
+  traverse::BatchWriter writer(buf);
+  writer.add(messages[1]);
+  writer.add(messages[2]);
+  writer.Finish();
+  const size_t first_size = buf.str().size();
+  writer.add(messages[3]);
+  writer.Finish();
+  writer.Finish(); // an empty batch
+  const std::vector<uint8_t> bytes = to_vector(buf.str());
+
+  traverse::BatchReader reader(bytes);
+  TEST_EQ(reader.used(), first_size);
+  test_read_all(reader, {messages[1], messages[2]});
+
+  traverse::BatchReader reader2(bytes.data() + first_size, bytes.size() - first_size);
+  test_read_all(reader2, {messages[3]});
+
+  size_t offset = first_size + reader2.used();
+  traverse::BatchReader reader3(bytes.data() + offset, bytes.size() - offset);
+  TEST_EQ(reader3.size(), 0u);
+  TEST_EQ(reader3.used(), 1u);
+  TEST_EQ(reader3.Errors(), "");
+}
+
+
+void test_corrupt() {
+  std::cout << "__ Corrupt batches __" << std::endl;
+  {
+    const auto bytes = to_vector("");
+    traverse::BatchReader reader(bytes);
+    TEST_EQ(reader.size(), 0u);
+    TEST_EQ(reader.Errors(), "Error: batch header is incomplete\n");
+  }
+  {
+    // A huge record count shouldn't allocate anything
+    const auto bytes = to_vector("\xff\xff\xff\xff\x0f\x01\x02");
+    traverse::BatchReader reader(bytes);
+    TEST_EQ(reader.size(), 0u);
+    TEST_EQ(reader.Errors(), "Error: batch claims 4294967295 records but has only 2 bytes\n");
+  }
+  {
+    const auto bytes = to_vector("\x03\x01\x01\x81");
+    traverse::BatchReader reader(bytes);
+    TEST_EQ(reader.size(), 0u);
+    TEST_EQ(reader.Errors(), "Error: batch header is incomplete\n");
+  }
+  {
+    // The second record is too long
+    const auto bytes = to_vector("\x02\x01\x05\x06\x07\x08");
+    traverse::BatchReader reader(bytes);
+    TEST_EQ(reader.size(), 1u);
+    TEST_EQ(reader.Errors(), "Error: record 1 of size 5 goes past the end of the batch\n");
+    int value = 0;
+    TEST_EQ(reader.read(0, value), true);
+    TEST_EQ(value, 3);
+  }
+  {
+    // A record with bytes left over, and one that's too short
+    const auto bytes = to_vector("\x02\x02\x01\x08\x09\x80");
+    traverse::BatchReader reader(bytes);
+    TEST_EQ(reader.size(), 2u);
+    int value = 0;
+    TEST_EQ(reader.read(0, value), false);
+    TEST_EQ(value, 4);
+    TEST_EQ(reader.read(1, value), false);
+    TEST_EQ(reader.Errors(), "Record 0: Error: 1 bytes left over\n"
+            "Record 1: Error: not enough data in buffer to read number\n");
+  }
+}
+
+
+int main() {
+  test_records();
+  test_indexed();
+  test_writer_reuse();
+  test_corrupt();
+}
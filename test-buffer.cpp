@@ -0,0 +1,539 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#include "traverse.h"
+#include "traverse-buffer.h"
+#include <iostream>
+#include "test.h"
+
+
+template<typename T>
+std::string buffer_bytes(const T& obj) {
+  std::vector<uint8_t> bytes;
+  traverse::BufferSerialize serialize(bytes);
+  visit(serialize, obj);
+  serialize.Finish();
+  return std::string(bytes.begin(), bytes.end());
+}
+
+// The buffer and streambuf versions should produce the same bytes
+template<typename T>
+void test_same_format(const T& obj) {
+  TEST_EQ_QUIET(buffer_bytes(obj), streambuf_bytes(obj));
+}
+
+// Bytes written by the streambuf version should be readable by the
+// buffer version, and give back the same value
+template<typename T>
+void test_roundtrip(const T& obj) {
+  std::string msg = streambuf_bytes(obj);
+  traverse::BufferDeserialize reader(reinterpret_cast<const uint8_t*>(msg.data()), msg.size());
+  T obj2{};
+  visit(reader, obj2);
+  TEST_EQ_QUIET(obj2 == obj, true);
+  TEST_EQ_QUIET(reader.Errors(), "");
+  TEST_EQ_QUIET(reader.remaining(), 0u);
+}
+
+
+void test_ints() {
+  std::cout << "__ Test ints __" << std::endl;
+  for (uint64_t x = 1; x != 0; x <<= 1) {
+    for (uint64_t y : {x-1, x, x+1}) {
+      test_same_format(y);
+      test_roundtrip(y);
+      test_same_format(int64_t(y));
+      test_roundtrip(int64_t(y));
+      test_same_format(int64_t(0 - y));
+      test_roundtrip(int64_t(0 - y));
+    }
+  }
+  test_same_format('@');
+  test_same_format((signed char)'\xff');
+  test_roundtrip((unsigned char)'\xff');
+  test_same_format(Mood::HULK_SMASH);
+  test_same_format(Signed::NEGATIVE);
+  test_roundtrip(Signed::NEGATIVE);
+  test_same_format(std::string("UFO\"1942\""));
+  test_roundtrip(std::string("UFO\"1942\""));
+  test_same_format(std::string(1000, 'x'));
+  test_roundtrip(std::vector<int>{3, -5, 1 << 30});
+  test_same_format(std::variant<int, std::string>("UFO"));
+  test_roundtrip(std::variant<int, std::string>("UFO"));
+  test_roundtrip(std::vector<std::variant<int, std::string>>{-3, "", 5});
+  test_same_format(std::optional<int>());
+  test_roundtrip(std::optional<int>(-300));
+  test_same_format(std::array<int, 3>{1, -2, 3});
+  test_roundtrip(std::array<int, 3>{1, -2, 3});
+  test_same_format(std::map<std::string, int>{{"a", 1}, {"b", 2}});
+  test_roundtrip(std::map<std::string, int>{{"a", 1}, {"b", 2}});
+  test_roundtrip(std::unordered_map<int, std::vector<int>>{{1, {2, 3}}, {-4, {}}});
+  test_same_format(std::make_unique<std::string>("UFO"));
+  test_same_format(std::unique_ptr<int>());
+}
+
+
+// Vectors of integers go through the bulk decoder
+template<typename T>
+void test_integer_vector() {
+  std::vector<T> v;
+  for (uint64_t x = 0; x < 2000; x++) {
+    v.push_back(T(x * x * x * 7919));
+    v.push_back(T(-int64_t(x)));
+  }
+  test_roundtrip(v);
+
+  // Cutting the message short should give the same result as the
+  // streambuf version
+  std::string msg = streambuf_bytes(v);
+  for (size_t length : {size_t(0), size_t(1), msg.size() / 3, msg.size() - 1}) {
+    std::stringbuf buf(msg.substr(0, length));
+    traverse::BinaryDeserialize reader1(buf);
+    traverse::BufferDeserialize reader2(reinterpret_cast<const uint8_t*>(msg.data()), length);
+    std::vector<T> v1, v2;
+    visit(reader1, v1);
+    visit(reader2, v2);
+    TEST_EQ_QUIET(v1 == v2, true);
+    TEST_EQ_QUIET(reader1.Errors().empty(), false);
+    TEST_EQ_QUIET(reader2.Errors().empty(), false);
+  }
+}
+
+void test_integer_vectors() {
+  std::cout << "__ Test integer vectors __" << std::endl;
+  test_integer_vector<char>();
+  test_integer_vector<signed char>();
+  test_integer_vector<unsigned char>();
+  test_integer_vector<int16_t>();
+  test_integer_vector<uint16_t>();
+  test_integer_vector<int>();
+  test_integer_vector<unsigned int>();
+  test_integer_vector<int64_t>();
+  test_integer_vector<uint64_t>();
+}
+
+
+void test_serialization_cache() {
+  std::cout << "__ Serialization cache __" << std::endl;
+  const Polygon polygon = {BLUE, Mood::HULK_SMASH, Charred::END, "UFO", {{3, 5}, {4, 6}}};
+  Scene scene{"scene", std::vector<traverse::Versioned<Polygon>>(3, polygon)};
+  scene.shapes[2].modify().name = "changed";
+  traverse::SerializationCache cache;
+  for (int i = 0; i < 2; i++) {
+    std::vector<uint8_t> bytes;
+    traverse::BufferSerialize serialize(bytes);
+    serialize.cache = &cache;
+    visit(serialize, scene);
+    serialize.Finish();
+    TEST_EQ(std::string(bytes.begin(), bytes.end()), streambuf_bytes(scene));
+  }
+  TEST_EQ(cache.hits, 4u);
+
+  // The buffer and streambuf versions share the cache entries
+  std::stringbuf buf;
+  traverse::BinarySerialize serialize(buf);
+  serialize.cache = &cache;
+  visit(serialize, scene);
+  TEST_EQ(buf.str(), streambuf_bytes(scene));
+  TEST_EQ(cache.hits, 7u);
+}
+
+// A struct that only holds numbers is encoded all at once
+struct Sample {
+  bool valid;
+  char tag;
+  Signed sign;
+  int64_t time;
+  std::array<Point, 2> box;
+  uint8_t level;
+};
+TRAVERSE_STRUCT(Sample, FIELD(valid) FIELD(tag) FIELD(sign) FIELD(time) FIELD(box) FIELD(level))
+
+bool operator == (const Point& a, const Point& b) { return a.x == b.x && a.y == b.y; }
+bool operator == (const Sample& a, const Sample& b) {
+  return a.valid == b.valid && a.tag == b.tag && a.sign == b.sign && a.time == b.time
+    && a.box == b.box && a.level == b.level;
+}
+
+void test_fixed_structs() {
+  std::cout << "__ Structs that only hold numbers __" << std::endl;
+  TEST_EQ(traverse::max_encoded_size_v<Point>, 10u);
+  TEST_EQ(traverse::max_encoded_size_v<Sample>, 1u + 2u + 5u + 10u + 20u + 2u);
+  TEST_EQ(traverse::fixed_encoding<Sample>().numbers, 9u);
+  TEST_EQ(traverse::max_encoded_size_v<Polygon>, 0u);
+  TEST_EQ(traverse::max_encoded_size_v<std::string>, 0u);
+
+  const Sample sample = {true, '\xff', Signed::NEGATIVE, -(int64_t(1) << 62), {{{-1, 2}, {INT32_MIN, INT32_MAX}}}, 200};
+  test_same_format(sample);
+  test_roundtrip(sample);
+  test_same_format(std::vector<Sample>(10, sample));
+  test_roundtrip(std::vector<Sample>(10, sample));
+  test_roundtrip(std::vector<Point>{{0, 0}, {-5, 5}, {INT32_MAX, 1}});
+
+  // Near the end of a fixed block, fields are written one at a time
+  const Sample small = {false, 'a', Signed::ONE, 3, {{{1, 2}, {3, 4}}}, 5};
+  uint8_t block[25];
+  traverse::BufferSerialize serialize(block, sizeof(block));
+  visit(serialize, small);
+  TEST_EQ(serialize.overflow, false);
+  TEST_EQ(std::string(block, block + serialize.size()), streambuf_bytes(small));
+
+  // A number that doesn't end is read again a field at a time, to
+  // get the same error
+  std::vector<uint8_t> bad(30, 0x80);
+  traverse::BufferDeserialize reader(bad);
+  Point point;
+  visit(reader, point);
+  TEST_EQ(reader.errors.code == traverse::ErrorCode::END_OF_INPUT, true);
+  TEST_EQ(reader.errors.field_path(), "x");
+}
+
+template<typename T>
+std::string columnar_bytes(const T& obj) {
+  std::vector<uint8_t> bytes;
+  traverse::BufferSerialize serialize(bytes);
+  serialize.columnar = true;
+  visit(serialize, obj);
+  serialize.Finish();
+  return std::string(bytes.begin(), bytes.end());
+}
+
+// Its columns, for reading a vector<Polygon> into
+struct PolygonColumns {
+  std::vector<Color> color;
+  std::vector<Mood> mood;
+  std::vector<Charred> charred;
+  std::vector<std::string> name;
+  std::vector<std::vector<Point>> points;
+};
+TRAVERSE_STRUCT(PolygonColumns, FIELD(color) FIELD(mood) FIELD(charred) FIELD(name) FIELD(points))
+
+void test_columns() {
+  std::cout << "__ Vectors of structs as columns __" << std::endl;
+  std::vector<Point> points;
+  for (int i = 0; i < 100; i++) {
+    points.push_back(Point{1000 + i, 5000 - 2 * i});
+  }
+  // The size, then the x and y columns
+  std::string bytes = columnar_bytes(points);
+  TEST_EQ(bytes.size(), 1u + (2u + 99u) + (2u + 99u));
+  TEST_EQ(bytes.size() < streambuf_bytes(points).size(), true);
+  TEST_EQ(columnar_bytes(std::vector<Point>{}), std::string(1, '\0'));
+
+  std::vector<Polygon> polygons;
+  for (int i = 0; i < 10; i++) {
+    polygons.push_back(Polygon{Color(i % 2), Mood::SAD, Charred::END, "polygon " + std::to_string(i),
+                               std::vector<Point>(points.begin(), points.begin() + i)});
+  }
+  polygons[3].points[1].y = INT32_MIN;
+  std::string polygon_bytes = columnar_bytes(polygons);
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(polygon_bytes.data());
+
+  traverse::BufferDeserialize reader(data, polygon_bytes.size());
+  reader.columnar = true;
+  std::vector<Polygon> polygons2;
+  visit(reader, polygons2);
+  TEST_EQ(reader.Errors(), "");
+  TEST_EQ(reader.remaining(), 0u);
+  TEST_EQ(to_string(polygons2), to_string(polygons));
+
+  // Into a struct of vectors
+  traverse::BufferDeserialize columns_reader(data, polygon_bytes.size());
+  columns_reader.columnar = true;
+  PolygonColumns columns;
+  read_columns(columns_reader, columns);
+  TEST_EQ(columns_reader.Errors(), "");
+  TEST_EQ(columns_reader.remaining(), 0u);
+  TEST_EQ(columns.name.size(), 10u);
+  TEST_EQ(columns.name[9], "polygon 9");
+  TEST_EQ(columns.color[3] == BLUE, true);
+  TEST_EQ(to_string(columns.points[3]), to_string(polygons[3].points));
+
+  // Incomplete columns are an error, and leave the vector empty
+  for (size_t length = 0; length < polygon_bytes.size(); length++) {
+    traverse::BufferDeserialize short_reader(data, length);
+    short_reader.columnar = true;
+    visit(short_reader, polygons2);
+    TEST_EQ_QUIET(short_reader.Errors().substr(0, 5), "Error");
+    TEST_EQ_QUIET(polygons2.size(), 0u);
+  }
+
+  std::string point_bytes = columnar_bytes(points);
+  traverse::BufferDeserialize short_reader(reinterpret_cast<const uint8_t*>(point_bytes.data()), 120);
+  short_reader.columnar = true;
+  visit(short_reader, points);
+  TEST_EQ(short_reader.Errors(), "Error: expected 100 numbers in column but only found 17\n");
+  TEST_EQ(short_reader.errors.field_path(), "y");
+
+  traverse::BufferDeserialize limited(data, polygon_bytes.size());
+  limited.columnar = true;
+  limited.max_elements = 5;
+  visit(limited, polygons2);
+  TEST_EQ(limited.errors.code == traverse::ErrorCode::SIZE_LIMIT, true);
+
+  // Columnar and row-wise writers sharing a cache keep their own entries
+  Scene scene{"scene", {polygons[3], polygons[5]}};
+  traverse::SerializationCache cache;
+  for (bool columnar : {true, false, true}) {
+    std::vector<uint8_t> cached;
+    traverse::BufferSerialize serialize(cached);
+    serialize.cache = &cache;
+    serialize.columnar = columnar;
+    visit(serialize, scene);
+    serialize.Finish();
+    TEST_EQ(std::string(cached.begin(), cached.end()), columnar ? columnar_bytes(scene) : streambuf_bytes(scene));
+  }
+  std::stringbuf buf;
+  traverse::BinarySerialize row_serialize(buf);
+  row_serialize.cache = &cache;
+  visit(row_serialize, scene);
+  TEST_EQ(buf.str(), streambuf_bytes(scene));
+  TEST_EQ(cache.hits, 4u);
+}
+
+int main() {
+  test_ints();
+  test_integer_vectors();
+  test_serialization_cache();
+  test_fixed_structs();
+  test_columns();
+
+  const Polygon polygon = {BLUE, Mood::HULK_SMASH, Charred::END, "UFO\"1942\"", {{3, 5}, {4, 6}, {5, 7}}};
+  const std::string msg = streambuf_bytes(polygon);
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(msg.data());
+
+  {
+    std::cout << "__ Serialize to vector __" << std::endl;
+    TEST_EQ(buffer_bytes(polygon), msg);
+  }
+
+  {
+    std::cout << "__ Serialize appends to vector __" << std::endl;
+    std::vector<uint8_t> bytes = {42};
+    {
+      traverse::BufferSerialize serialize(bytes);
+      visit(serialize, polygon);
+    }
+    TEST_EQ(bytes.size(), msg.size() + 1);
+    TEST_EQ(std::string(bytes.begin() + 1, bytes.end()), msg);
+  }
+
+  {
+    std::cout << "__ Serialize to fixed buffer __" << std::endl;
+    uint8_t block[100];
+    traverse::BufferSerialize serialize(block, sizeof(block));
+    visit(serialize, polygon);
+    TEST_EQ(serialize.overflow, false);
+    TEST_EQ(std::string(block, block + serialize.size()), msg);
+  }
+
+  {
+    std::cout << "__ Serialize to vector of counted size __" << std::endl;
+    std::vector<uint8_t> bytes = traverse::serialize_to_vector(polygon);
+    TEST_EQ(bytes.size(), msg.size());
+    TEST_EQ(std::string(bytes.begin(), bytes.end()), msg);
+
+    traverse::SizeCounter counter;
+    visit(counter, polygon);
+    std::vector<uint8_t> block(counter.size + traverse::max_varint_size);
+    traverse::BufferSerialize serialize(block.data(), block.size());
+    visit(serialize, polygon);
+    TEST_EQ(serialize.overflow, false);
+    TEST_EQ(serialize.size(), msg.size());
+
+    for (size_t length = 0; length < msg.size(); length++) {
+      std::vector<uint8_t> small(length);
+      traverse::BufferSerialize small_serialize(small.data(), small.size());
+      visit(small_serialize, polygon);
+      TEST_EQ_QUIET(small_serialize.overflow, true);
+    }
+    const std::vector<int> numbers = {0, 1 << 20, -1, 1000000000};
+    TEST_EQ(traverse::serialize_to_vector(numbers).size(), streambuf_bytes(numbers).size());
+  }
+
+  {
+    std::cout << "__ Serialize to fixed buffer that's too small __" << std::endl;
+    uint8_t block[10];
+    traverse::BufferSerialize serialize(block, sizeof(block));
+    visit(serialize, polygon);
+    TEST_EQ(serialize.overflow, true);
+    TEST_EQ(serialize.size() <= sizeof(block), true);
+  }
+
+  {
+    std::cout << "__ Deserialize from buffer __" << std::endl;
+    traverse::BufferDeserialize reader(data, msg.size());
+    Polygon polygon2;
+    visit(reader, polygon2);
+    std::stringstream out1, out2;
+    out1 << polygon;
+    out2 << polygon2;
+    TEST_EQ(out1.str(), out2.str());
+    TEST_EQ(reader.Errors(), "");
+    TEST_EQ(reader.remaining(), 0u);
+  }
+
+  {
+    std::cout << "__ Corrupt deserialize __" << std::endl;
+    std::vector<uint8_t> corrupted(msg.size(), 0x7f);
+    traverse::BufferDeserialize reader(corrupted);
+    Polygon polygon2;
+    visit(reader, polygon2);
+    TEST_EQ(reader.Errors().substr(0, 5), "Error");
+
+    std::vector<uint8_t> continued(msg.size(), 0xff);
+    traverse::BufferDeserialize reader2(continued);
+    visit(reader2, polygon2);
+    TEST_EQ(reader2.Errors().substr(0, 5), "Error");
+  }
+
+  {
+    std::cout << "__ Serialized message too short __" << std::endl;
+    for (size_t length = 0; length < msg.size(); length++) {
+      traverse::BufferDeserialize reader(data, length);
+      Polygon polygon2;
+      visit(reader, polygon2);
+      TEST_EQ_QUIET(reader.Errors().substr(0, 5), "Error");
+    }
+  }
+
+  {
+    std::cout << "__ Error code, offset, and field path __" << std::endl;
+    traverse::BufferDeserialize reader(data, msg.size() - 1);
+    Polygon polygon2;
+    visit(reader, polygon2);
+    TEST_EQ(reader.errors.code == traverse::ErrorCode::END_OF_INPUT, true);
+    TEST_EQ(reader.errors.offset, msg.size() - 1);
+    TEST_EQ(reader.errors.field_path(), "points.y");
+    TEST_EQ(reader.errors.summary(), "end of input at byte " + std::to_string(msg.size() - 1) + " in points.y");
+    TEST_EQ(reader.Errors(), "Error: not enough data in buffer to read number\n");
+
+    std::stringbuf buf(msg.substr(0, msg.size() - 1));
+    traverse::BinaryDeserialize reader2(buf);
+    visit(reader2, polygon2);
+    TEST_EQ(reader2.errors.summary(), reader.errors.summary());
+    TEST_EQ(reader2.Errors(), reader.Errors());
+
+    traverse::BufferDeserialize reader3(data, msg.size());
+    reader3.max_elements = 2;
+    visit(reader3, polygon2);
+    TEST_EQ(reader3.errors.code == traverse::ErrorCode::SIZE_LIMIT, true);
+    TEST_EQ(reader3.errors.field_path(), "points");
+
+    reader3.errors.clear();
+    TEST_EQ(reader3.errors.failed(), false);
+    TEST_EQ(reader3.Errors(), "");
+  }
+
+  {
+    std::cout << "__ Stop at the first error __" << std::endl;
+    const std::vector<Polygon> polygons(1000, polygon);
+    const std::string many_msg = streambuf_bytes(polygons);
+    const uint8_t* many_data = reinterpret_cast<const uint8_t*>(many_msg.data());
+    const uint64_t limit = polygons.size() * sizeof(Polygon) + 500;
+
+    // Without fail_fast, every polygon after the limit is an error
+    traverse::BufferDeserialize reader1(many_data, many_msg.size());
+    reader1.max_bytes = limit;
+    std::vector<Polygon> polygons1;
+    visit(reader1, polygons1);
+    TEST_EQ(reader1.remaining(), 0u);
+
+    traverse::BufferDeserialize reader2(many_data, many_msg.size());
+    reader2.max_bytes = limit;
+    reader2.fail_fast = true;
+    std::vector<Polygon> polygons2;
+    visit(reader2, polygons2);
+    TEST_EQ(reader2.errors.summary(), reader1.errors.summary());
+    TEST_EQ(std::count(reader1.errors.str().begin(), reader1.errors.str().end(), '\n') > 100, true);
+    TEST_EQ(std::count(reader2.errors.str().begin(), reader2.errors.str().end(), '\n'), 1);
+    TEST_EQ(reader2.remaining() > many_msg.size() / 2, true);
+    TEST_EQ(polygons2.size() < 100, true);
+
+    // Later visits are skipped too
+    int after = 42;
+    visit(reader2, after);
+    TEST_EQ(after, 42);
+
+    std::stringbuf buf(many_msg);
+    traverse::BinaryDeserialize reader3(buf);
+    reader3.max_bytes = limit;
+    reader3.fail_fast = true;
+    std::vector<Polygon> polygons3;
+    visit(reader3, polygons3);
+    TEST_EQ(reader3.Errors(), reader2.Errors());
+    TEST_EQ(polygons3.size(), polygons2.size());
+    TEST_EQ(buf.in_avail() > std::streamsize(many_msg.size() / 2), true);
+  }
+
+  {
+    std::cout << "__ Serialized message too long __" << std::endl;
+    std::string longer = msg + "12345";
+    traverse::BufferDeserialize reader(reinterpret_cast<const uint8_t*>(longer.data()), longer.size());
+    Polygon polygon2;
+    visit(reader, polygon2);
+    TEST_EQ(reader.Errors(), "");
+    TEST_EQ(reader.remaining(), 5u);
+  }
+
+  {
+    std::cout << "__ Deserialize string_view __" << std::endl;
+    const std::vector<std::string> names = {"UFO\"1942\"", "", std::string(300, 'x')};
+    const std::string names_msg = streambuf_bytes(names);
+    const uint8_t* names_data = reinterpret_cast<const uint8_t*>(names_msg.data());
+    traverse::BufferDeserialize reader(names_data, names_msg.size());
+    std::vector<std::string_view> views;
+    visit(reader, views);
+    TEST_EQ(reader.Errors(), "");
+    TEST_EQ(views.size(), 3u);
+    TEST_EQ(views[0], names[0]);
+    TEST_EQ(views[2], names[2]);
+    TEST_EQ((const void*) views[0].data(), (const void*) (names_data + 2));
+    TEST_EQ(streambuf_bytes(views), names_msg);
+    TEST_EQ(buffer_bytes(views), names_msg);
+
+    std::stringstream out1, out2;
+    traverse::CoutWriter writer1(out1), writer2(out2);
+    visit(writer1, names);
+    visit(writer2, views);
+    TEST_EQ(out1.str(), out2.str());
+  }
+
+  {
+    std::cout << "__ Limits on untrusted sizes __" << std::endl;
+    traverse::BufferDeserialize reader1(data, msg.size());
+    reader1.max_elements = 2;
+    Polygon polygon2;
+    visit(reader1, polygon2);
+    TEST_EQ(reader1.Errors().substr(0, 5), "Error");
+    TEST_EQ(polygon2.points.size(), 0u);
+
+    traverse::BufferDeserialize reader2(data, msg.size());
+    reader2.max_bytes = 4;
+    visit(reader2, polygon2);
+    TEST_EQ(reader2.Errors().substr(0, 5), "Error");
+    TEST_EQ(polygon2.name, "");
+
+    traverse::BufferDeserialize reader3(data, msg.size());
+    reader3.max_elements = 3;
+    reader3.max_bytes = polygon.name.size() + 3 * sizeof(Point);
+    visit(reader3, polygon2);
+    TEST_EQ(reader3.Errors(), "");
+  }
+
+  {
+    std::cout << "__ Huge vector size with little data __" << std::endl;
+    std::vector<uint8_t> bytes;
+    {
+      traverse::BufferSerialize serialize(bytes);
+      visit(serialize, uint64_t(1) << 60);
+      visit(serialize, 7);
+    }
+    traverse::BufferDeserialize reader(bytes);
+    std::vector<int> v;
+    visit(reader, v);
+    TEST_EQ(v.size(), 1u);
+    TEST_EQ(reader.Errors().substr(0, 5), "Error");
+  }
+}
@@ -0,0 +1,165 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#include "traverse.h"
+#include "traverse-compress.h"
+#include <iostream>
+#include "test.h"
+
+
+std::vector<Polygon> make_polygons(int count) {
+  std::vector<Polygon> polygons;
+  for (int i = 0; i < count; i++) {
+    polygons.push_back(make_polygon("polygon " + std::to_string(i % 10), 20, [i](int j) { return Point{j * 10, i % 7}; }));
+  }
+  return polygons;
+}
+
+template<typename Compressor, typename Decompressor>
+void test_round_trip(size_t block_size) {
+  std::vector<Polygon> polygons = make_polygons(1000);
+  std::stringbuf uncompressed;
+  traverse::BinarySerialize plain_writer(uncompressed);
+  visit(plain_writer, polygons);
+
+  std::stringbuf buf;
+  {
+    traverse::CompressStreambuf<Compressor> compressed(buf, Compressor(), block_size);
+    traverse::BinarySerialize writer(compressed);
+    visit(writer, polygons);
+    TEST_EQ_QUIET(uint64_t(compressed.pubseekoff(0, std::ios::cur, std::ios::out)), uncompressed.str().size());
+    TEST_EQ_QUIET(compressed.Finish(), true);
+    TEST_EQ_QUIET(compressed.Errors(), "");
+  }
+  // LZ4 compresses each small block on its own
+  if (block_size == traverse::CompressStreambuf<Compressor>::default_block_size) {
+    TEST_EQ_QUIET(buf.str().size() * 4 < uncompressed.str().size(), true);
+  }
+
+  traverse::DecompressStreambuf<Decompressor> decompressed(buf, Decompressor(), block_size);
+  traverse::BinaryDeserialize reader(decompressed);
+  std::vector<Polygon> polygons2;
+  visit(reader, polygons2);
+  TEST_EQ_QUIET(reader.Errors(), "");
+  TEST_EQ_QUIET(decompressed.Errors(), "");
+  TEST_EQ_QUIET(to_string(polygons2), to_string(polygons));
+  TEST_EQ_QUIET(traverse::input_offset(reader), uncompressed.str().size());
+  TEST_EQ_QUIET(decompressed.sgetc() == std::char_traits<char>::eof(), true);
+  TEST_EQ_QUIET(decompressed.Errors(), "");
+}
+
+template<typename Compressor, typename Decompressor>
+void test_flush() {
+  // After pubsync(), what was written so far can be decompressed
+  std::stringbuf buf;
+  traverse::CompressStreambuf<Compressor> compressed(buf);
+  traverse::BinarySerialize writer(compressed);
+  visit(writer, Point{3, 4});
+  TEST_EQ(compressed.pubsync(), 0);
+  std::stringbuf partial(buf.str());
+  traverse::DecompressStreambuf<Decompressor> decompressed(partial);
+  traverse::BinaryDeserialize reader(decompressed);
+  Point point;
+  visit(reader, point);
+  TEST_EQ(reader.Errors(), "");
+  TEST_EQ(to_string(point), "Point{x:3, y:4}");
+  // but the frame hasn't ended
+  TEST_EQ(decompressed.sgetc() == std::char_traits<char>::eof(), true);
+  TEST_EQ(decompressed.errors.code == traverse::ErrorCode::BAD_FRAMING, true);
+}
+
+template<typename Compressor, typename Decompressor>
+void test_bad_input() {
+  std::stringbuf buf;
+  {
+    traverse::CompressStreambuf<Compressor> compressed(buf);
+    traverse::BinarySerialize writer(compressed);
+    visit(writer, make_polygons(10));
+  }
+  std::string bytes = buf.str();
+
+  // Cut off
+  std::stringbuf truncated(bytes.substr(0, bytes.size() / 2));
+  traverse::DecompressStreambuf<Decompressor> decompressed(truncated);
+  traverse::BinaryDeserialize reader(decompressed);
+  std::vector<Polygon> polygons;
+  visit(reader, polygons);
+  TEST_EQ(reader.Errors().empty(), false);
+  TEST_EQ(decompressed.Errors().find("Error: compressed input ended in the middle of a frame") == 0, true);
+
+  // Not compressed at all
+  std::stringbuf garbage(std::string(100, 'x'));
+  traverse::DecompressStreambuf<Decompressor> garbage_decompressed(garbage);
+  traverse::BinaryDeserialize garbage_reader(garbage_decompressed);
+  visit(garbage_reader, polygons);
+  TEST_EQ(garbage_decompressed.errors.code == traverse::ErrorCode::BAD_FRAMING, true);
+  TEST_EQ(garbage_decompressed.Errors().find("Error: compressed input is invalid at byte 0") == 0, true);
+
+  // Nothing at all is no frames, and no error
+  std::stringbuf empty;
+  traverse::DecompressStreambuf<Decompressor> empty_decompressed(empty);
+  TEST_EQ(empty_decompressed.sgetc() == std::char_traits<char>::eof(), true);
+  TEST_EQ(empty_decompressed.Errors(), "");
+}
+
+void test_lz4() {
+  std::cout << "__ LZ4 frames __" << std::endl;
+  test_round_trip<traverse::Lz4Compressor, traverse::Lz4Decompressor>(traverse::Lz4CompressStreambuf::default_block_size);
+  test_round_trip<traverse::Lz4Compressor, traverse::Lz4Decompressor>(100);
+  test_flush<traverse::Lz4Compressor, traverse::Lz4Decompressor>();
+  test_bad_input<traverse::Lz4Compressor, traverse::Lz4Decompressor>();
+}
+
+void test_zstd() {
+  std::cout << "__ zstd frames __" << std::endl;
+  test_round_trip<traverse::ZstdCompressor, traverse::ZstdDecompressor>(traverse::ZstdCompressStreambuf::default_block_size);
+  test_round_trip<traverse::ZstdCompressor, traverse::ZstdDecompressor>(100);
+  test_flush<traverse::ZstdCompressor, traverse::ZstdDecompressor>();
+  test_bad_input<traverse::ZstdCompressor, traverse::ZstdDecompressor>();
+}
+
+std::string compress_with(const Polygon& message, std::string_view dictionary) {
+  std::stringbuf buf;
+  traverse::ZstdCompressStreambuf compressed(buf, traverse::ZstdCompressor(3, dictionary));
+  traverse::BinarySerialize writer(compressed);
+  visit(writer, message);
+  compressed.Finish();
+  return buf.str();
+}
+
+void test_dictionary() {
+  std::cout << "__ zstd dictionary for small messages __" << std::endl;
+  std::vector<Polygon> samples = make_polygons(1000);
+  std::string dictionary = traverse::zstd_train_dictionary_on(samples, 4096);
+  TEST_EQ(dictionary.empty(), false);
+  TEST_EQ(traverse::zstd_train_dictionary({"too", "few"}), "");
+
+  Polygon message = samples[0];
+  message.points[5].y = 17;
+  std::string with = compress_with(message, dictionary);
+  std::string without = compress_with(message, "");
+  TEST_EQ(with.size() < without.size(), true);
+
+  std::stringbuf buf(with);
+  traverse::ZstdDecompressStreambuf decompressed(buf, traverse::ZstdDecompressor(dictionary));
+  traverse::BinaryDeserialize reader(decompressed);
+  Polygon message2;
+  visit(reader, message2);
+  TEST_EQ(reader.Errors(), "");
+  TEST_EQ(to_string(message2), to_string(message));
+
+  // Without the dictionary, it can't be decompressed
+  std::stringbuf buf2(with);
+  traverse::ZstdDecompressStreambuf no_dictionary(buf2);
+  traverse::BinaryDeserialize reader2(no_dictionary);
+  visit(reader2, message2);
+  TEST_EQ(no_dictionary.errors.code == traverse::ErrorCode::BAD_FRAMING, true);
+}
+
+
+int main() {
+  test_lz4();
+  test_zstd();
+  test_dictionary();
+}
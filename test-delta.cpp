@@ -0,0 +1,172 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#include "traverse.h"
+#include "traverse-delta.h"
+#include <iostream>
+#include "test.h"
+
+
+template<typename T>
+std::string to_bytes(const T& obj) {
+  std::stringstream out;
+  for (auto c : obj) {
+    out << int(uint8_t(c)) << ' ';
+  }
+  return out.str();
+}
+
+template<typename T>
+std::vector<uint8_t> delta(const T& current, const T& baseline) {
+  std::vector<uint8_t> bytes;
+  traverse::DeltaSerialize writer(bytes);
+  write_delta(writer, current, baseline);
+  writer.Finish();
+  return bytes;
+}
+
+// Applying the delta to the baseline should give back the current value
+template<typename T>
+void test_apply(const T& current, const T& baseline) {
+  std::vector<uint8_t> bytes = delta(current, baseline);
+  T state = baseline;
+  traverse::DeltaDeserialize reader(bytes);
+  read_delta(reader, state);
+  TEST_EQ_QUIET(reader.Errors(), "");
+  TEST_EQ_QUIET(reader.remaining(), 0u);
+  TEST_EQ_QUIET(to_string(state), to_string(current));
+}
+
+
+const Polygon baseline = {BLUE, Mood::SAD, Charred::START, "square", {{0, 0}, {1, 0}, {1, 1}, {0, 1}}};
+
+void test_struct() {
+  std::cout << "__ Changed fields of a struct __" << std::endl;
+  TEST_EQ(to_bytes(delta(baseline, baseline)), "0 ");
+
+  Polygon renamed = baseline;
+  renamed.name = "box";
+  TEST_EQ(to_bytes(delta(renamed, baseline)), "8 3 98 111 120 ");
+  test_apply(renamed, baseline);
+
+  Polygon moved = baseline;
+  moved.mood = Mood::HULK_SMASH;
+  moved.points[2].y = 2;
+  // mood and points changed; points[2] is index 2 + 1, then only y changed
+  TEST_EQ(to_bytes(delta(moved, baseline)), "18 2 4 3 2 4 0 ");
+  test_apply(moved, baseline);
+
+  Point point = {3, 4};
+  TEST_EQ(to_bytes(delta(point, Point{3, 5})), "2 8 ");
+  test_apply(point, Point{3, 5});
+}
+
+void test_vector() {
+  std::cout << "__ Changed elements of a vector __" << std::endl;
+  Polygon grown = baseline;
+  grown.points.push_back({5, 5});
+  // points changed; 5 elements, no changed indices, then the new one
+  TEST_EQ(to_bytes(delta(grown, baseline)), "16 5 0 10 10 ");
+  test_apply(grown, baseline);
+
+  Polygon shrunk = baseline;
+  shrunk.points.pop_back();
+  shrunk.points[0].x = -1;
+  test_apply(shrunk, baseline);
+  test_apply(baseline, shrunk);
+
+  Polygon empty = baseline;
+  empty.points.clear();
+  test_apply(empty, baseline);
+  test_apply(baseline, empty);
+
+  std::vector<int> numbers(1000, 7), numbers2 = numbers;
+  numbers2[10] = 8;
+  numbers2[999] = 9;
+  TEST_EQ(to_bytes(delta(numbers2, numbers)), "232 7 11 16 221 7 18 0 ");
+  test_apply(numbers2, numbers);
+
+  std::vector<Polygon> polygons(100, baseline), polygons2 = polygons;
+  polygons2[50].points[3].x = 1;
+  polygons2.push_back(grown);
+  test_apply(polygons2, polygons);
+  TEST_EQ(delta(polygons2, polygons).size() < 40u, true);
+}
+
+void test_other_types() {
+  std::cout << "__ Types without operator == __" << std::endl;
+  std::optional<Point> none, some = Point{1, 2};
+  test_apply(some, none);
+  test_apply(none, some);
+  TEST_EQ(to_bytes(delta(some, some)), "1 2 4 ");
+}
+
+// Fields that aren't members have no baseline at the same offset
+struct Boxed {
+  int id;
+  std::unique_ptr<Polygon> shape;
+  std::unique_ptr<std::vector<int>> numbers;
+  std::string tag;
+};
+TRAVERSE_STRUCT(Boxed, FIELD(id) .field("shape", *obj.shape) .field("numbers", *obj.numbers) FIELD(tag))
+
+Boxed copy(const Boxed& boxed) {
+  return Boxed{boxed.id, std::make_unique<Polygon>(*boxed.shape),
+               std::make_unique<std::vector<int>>(*boxed.numbers), boxed.tag};
+}
+
+void test_non_members() {
+  std::cout << "__ Fields that aren't members __" << std::endl;
+  Boxed before{1, std::make_unique<Polygon>(baseline), std::make_unique<std::vector<int>>(std::vector<int>{1, 2, 3}), "before"};
+  Boxed after = copy(before);
+  after.shape->name = "box";
+  after.numbers->assign({1, 2, 4, 5});
+  after.tag = "after";
+  Boxed same = copy(before);
+
+  for (auto [current, base] : {std::pair{&after, &before}, {&before, &after}, {&same, &before}}) {
+    std::vector<uint8_t> bytes = delta(*current, *base);
+    Boxed state = copy(*base);
+    traverse::DeltaDeserialize reader(bytes);
+    read_delta(reader, state);
+    TEST_EQ(reader.Errors(), "");
+    TEST_EQ(reader.remaining(), 0u);
+    TEST_EQ(to_string(state), to_string(*current));
+  }
+}
+
+void test_errors() {
+  std::cout << "__ Bad deltas __" << std::endl;
+  std::vector<uint8_t> bytes = delta(baseline, baseline);
+  for (size_t length = 0; length < bytes.size(); length++) {
+    Polygon state = baseline;
+    traverse::DeltaDeserialize reader(bytes.data(), length);
+    read_delta(reader, state);
+    TEST_EQ_QUIET(reader.in.errors.code == traverse::ErrorCode::END_OF_INPUT, true);
+  }
+
+  // Index 4 of a vector that had 4 elements
+  std::vector<uint8_t> bad = {16, 4, 5, 3, 0, 0};
+  Polygon state = baseline;
+  traverse::DeltaDeserialize reader(bad);
+  read_delta(reader, state);
+  TEST_EQ(reader.Errors(), "Error: changed index 4 is past the 4 elements shared with the baseline\n");
+  TEST_EQ(reader.in.errors.field_path(), "points");
+
+  // A vector that claims to grow by more than the input has
+  std::vector<uint8_t> huge = {16, 255, 255, 255, 255, 15, 0};
+  traverse::DeltaDeserialize huge_reader(huge);
+  read_delta(huge_reader, state);
+  TEST_EQ(huge_reader.in.errors.code == traverse::ErrorCode::END_OF_INPUT, true);
+  TEST_EQ(state.points.size(), 4u);
+}
+
+
+int main() {
+  test_struct();
+  test_vector();
+  test_other_types();
+  test_non_members();
+  test_errors();
+}
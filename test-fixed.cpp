@@ -0,0 +1,263 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#include "traverse.h"
+#include "traverse-fixed.h"
+#include <cmath>
+#include <iostream>
+#include "test.h"
+
+
+// A struct with no padding can be bulk copied
+struct Vec3 {
+  float x, y, z;
+};
+TRAVERSE_STRUCT(Vec3, FIELD(x) FIELD(y) FIELD(z))
+static_assert(sizeof(Vec3) == 3 * sizeof(float));
+template<> struct traverse::is_bulk_copyable<Vec3> : std::true_type {};
+
+bool operator == (const Vec3& a, const Vec3& b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+struct Mesh {
+  std::string name;
+  std::vector<Vec3> vertices;
+  std::vector<float> weights;
+  std::vector<double> times;
+  std::vector<uint16_t> indices;
+};
+TRAVERSE_STRUCT(Mesh, FIELD(name) FIELD(vertices) FIELD(weights) FIELD(times) FIELD(indices))
+
+bool operator == (const Mesh& a, const Mesh& b) {
+  return a.name == b.name && a.vertices == b.vertices && a.weights == b.weights
+    && a.times == b.times && a.indices == b.indices;
+}
+
+// Same format as Mesh, but pointing into the serialized bytes
+struct MeshView {
+  std::string_view name;
+  std::span<const Vec3> vertices;
+  std::span<const float> weights;
+  std::span<const double> times;
+  std::span<const uint16_t> indices;
+};
+TRAVERSE_STRUCT(MeshView, FIELD(name) FIELD(vertices) FIELD(weights) FIELD(times) FIELD(indices))
+
+template<typename T, typename U>
+bool same_elements(std::span<T> a, const std::vector<U>& b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end());
+}
+
+
+template<typename T>
+std::string fixed_bytes(const T& obj) {
+  std::stringbuf buf;
+  traverse::FixedBinarySerialize serialize(buf);
+  visit(serialize, obj);
+  return buf.str();
+}
+
+template<typename T>
+void test_roundtrip(const T& obj) {
+  std::stringbuf buf(fixed_bytes(obj));
+  traverse::FixedBinaryDeserialize reader(buf);
+  T obj2{};
+  visit(reader, obj2);
+  TEST_EQ_QUIET(obj2 == obj, true);
+  TEST_EQ_QUIET(reader.Errors(), "");
+  TEST_EQ_QUIET(buf.in_avail(), 0);
+}
+
+
+void test_layout() {
+  std::cout << "__ Test layout __" << std::endl;
+  TEST_EQ(fixed_bytes(uint32_t(0x01020304)), std::string("\x04\x03\x02\x01", 4));
+  TEST_EQ(fixed_bytes(int16_t(-2)), std::string("\xfe\xff", 2));
+  TEST_EQ(fixed_bytes(1.5f), std::string("\x00\x00\xc0\x3f", 4));
+  TEST_EQ(fixed_bytes(true), std::string("\x01", 1));
+  TEST_EQ(fixed_bytes(Charred::END), std::string("\x01", 1));
+  TEST_EQ(fixed_bytes(Mood::SAD), std::string("\x01\x00\x00\x00", 4));
+  TEST_EQ(fixed_bytes(std::string("ab")), std::string("\x02\0\0\0\0\0\0\0ab", 10));
+  TEST_EQ(fixed_bytes(std::vector<int16_t>{1, 2}),
+          std::string("\x02\0\0\0\0\0\0\0\x01\0\x02\0", 12));
+
+  // The bulk copy should give the same bytes as writing each element
+  std::vector<Vec3> vertices = {{1.0f, 2.0f, 3.0f}, {-0.5f, 1e30f, 0.0f}};
+  TEST_EQ(fixed_bytes(vertices),
+          fixed_bytes(uint64_t(2)) + fixed_bytes(vertices[0]) + fixed_bytes(vertices[1]));
+}
+
+
+void test_numbers() {
+  std::cout << "__ Test numbers __" << std::endl;
+  for (uint64_t x = 1; x != 0; x <<= 1) {
+    for (uint64_t y : {x-1, x, x+1}) {
+      test_roundtrip(y);
+      test_roundtrip(int64_t(y));
+      test_roundtrip(int64_t(0 - y));
+      test_roundtrip(uint32_t(y));
+      test_roundtrip(int8_t(y));
+    }
+  }
+  // Floating point numbers keep all their bits
+  for (double d : {0.0, -0.0, 0.1, -1e300, 3.14159265358979, 5e-324}) {
+    test_roundtrip(d);
+    test_roundtrip(float(d));
+  }
+  test_roundtrip(std::nextafter(1.0, 2.0));
+  test_roundtrip(false);
+  test_roundtrip(true);
+  test_roundtrip(Signed::NEGATIVE);
+  test_roundtrip(std::string("UFO\"1942\""));
+  test_roundtrip(std::string(100000, 'x'));
+}
+
+
+void test_mesh() {
+  std::cout << "__ Test mesh __" << std::endl;
+  Mesh mesh;
+  mesh.name = "teapot";
+  for (int i = 0; i < 30000; i++) {
+    mesh.vertices.push_back(Vec3{i * 0.25f, -i * 0.125f, 1.0f / (i + 1)});
+    mesh.weights.push_back(1.0f / (i + 3));
+    mesh.times.push_back(i * 0.001);
+    mesh.indices.push_back(uint16_t(i * 7));
+  }
+  test_roundtrip(mesh);
+  test_roundtrip(std::vector<Mesh>{mesh, Mesh{}, mesh});
+
+  const std::string msg = fixed_bytes(mesh);
+  for (size_t length : {size_t(0), size_t(5), size_t(100), msg.size() / 2, msg.size() - 1}) {
+    std::stringbuf buf(msg.substr(0, length));
+    traverse::FixedBinaryDeserialize reader(buf);
+    Mesh mesh2;
+    visit(reader, mesh2);
+    TEST_EQ_QUIET(reader.Errors().substr(0, 5), "Error");
+  }
+}
+
+
+void test_views() {
+  std::cout << "__ Test views __" << std::endl;
+  Mesh mesh;
+  mesh.name = "teapot!!";
+  for (int i = 0; i < 1000; i++) {
+    mesh.vertices.push_back(Vec3{i * 0.25f, -i * 0.125f, 1.0f / (i + 1)});
+    mesh.weights.push_back(1.0f / (i + 3));
+    mesh.times.push_back(i * 0.001);
+    mesh.indices.push_back(uint16_t(i * 7));
+  }
+  const std::string msg = fixed_bytes(mesh);
+  const std::vector<uint8_t> bytes(msg.begin(), msg.end());
+
+  {
+    traverse::FixedBufferDeserialize reader(bytes);
+    MeshView view;
+    visit(reader, view);
+    TEST_EQ(reader.Errors(), "");
+    TEST_EQ(reader.remaining(), 0u);
+    TEST_EQ(view.name, "teapot!!");
+    TEST_EQ(same_elements(view.vertices, mesh.vertices), true);
+    TEST_EQ(same_elements(view.weights, mesh.weights), true);
+    TEST_EQ(same_elements(view.times, mesh.times), true);
+    TEST_EQ(same_elements(view.indices, mesh.indices), true);
+    // The views point into the buffer, not into a copy
+    TEST_EQ((const void*) view.name.data(), (const void*) (bytes.data() + 8));
+    // Writing the views gives back the same bytes, in both formats
+    TEST_EQ(fixed_bytes(view), msg);
+    std::stringbuf buf1, buf2;
+    traverse::BinarySerialize writer1(buf1), writer2(buf2);
+    visit(writer1, mesh.name);
+    visit(writer1, mesh.indices);
+    visit(writer2, view.name);
+    visit(writer2, view.indices);
+    TEST_EQ(buf1.str(), buf2.str());
+  }
+
+  {
+    // Owning types can be read from the same buffer
+    traverse::FixedBufferDeserialize reader(bytes);
+    Mesh mesh2;
+    visit(reader, mesh2);
+    TEST_EQ(reader.Errors(), "");
+    TEST_EQ(mesh2 == mesh, true);
+  }
+
+  {
+    // The doubles will start at an odd address
+    struct Misaligned { std::string_view name; std::span<const double> times; };
+    std::vector<uint8_t> odd;
+    for (char c : fixed_bytes(std::string("x")) + fixed_bytes(mesh.times)) {
+      odd.push_back(uint8_t(c));
+    }
+    traverse::FixedBufferDeserialize reader(odd);
+    Misaligned view;
+    visit(reader, view.name);
+    visit(reader, view.times);
+    TEST_EQ(reader.Errors().substr(0, 5), "Error");
+    TEST_EQ(view.times.size(), 0u);
+    TEST_EQ(reader.remaining(), 0u);
+  }
+
+  for (size_t length = 0; length < 100; length++) {
+    traverse::FixedBufferDeserialize reader(bytes.data(), length);
+    MeshView view;
+    visit(reader, view);
+    TEST_EQ_QUIET(reader.Errors().substr(0, 5), "Error");
+    TEST_EQ_QUIET(view.name.size() <= length, true);
+  }
+}
+
+
+int main() {
+  test_layout();
+  test_numbers();
+  test_mesh();
+  test_views();
+
+  const Polygon polygon = {BLUE, Mood::HULK_SMASH, Charred::END, "UFO\"1942\"", {{3, 5}, {4, 6}, {5, 7}}};
+  const std::string msg = fixed_bytes(polygon);
+
+  {
+    std::cout << "__ Deserialize __" << std::endl;
+    std::stringbuf buf(msg);
+    traverse::FixedBinaryDeserialize reader(buf);
+    Polygon polygon2;
+    visit(reader, polygon2);
+    std::stringstream out1, out2;
+    out1 << polygon;
+    out2 << polygon2;
+    TEST_EQ(out1.str(), out2.str());
+    TEST_EQ(reader.Errors(), "");
+  }
+
+  {
+    std::cout << "__ Serialized message too short __" << std::endl;
+    for (size_t length = 0; length < msg.size(); length++) {
+      std::stringbuf buf(msg.substr(0, length));
+      traverse::FixedBinaryDeserialize reader(buf);
+      Polygon polygon2;
+      visit(reader, polygon2);
+      TEST_EQ_QUIET(reader.Errors().substr(0, 5), "Error");
+    }
+  }
+
+  {
+    std::cout << "__ Huge vector size with little data __" << std::endl;
+    std::stringbuf buf(fixed_bytes(uint64_t(1) << 60) + fixed_bytes(1.0f) + fixed_bytes(2.0f));
+    traverse::FixedBinaryDeserialize reader(buf);
+    std::vector<float> v;
+    visit(reader, v);
+    TEST_EQ(v.size(), 2u);
+    TEST_EQ(reader.Errors().substr(0, 5), "Error");
+
+    std::stringbuf buf2(fixed_bytes(uint64_t(1) << 60) + "abc");
+    traverse::FixedBinaryDeserialize reader2(buf2);
+    std::string s;
+    visit(reader2, s);
+    TEST_EQ(s, "abc");
+    TEST_EQ(reader2.Errors().substr(0, 5), "Error");
+  }
+}
@@ -0,0 +1,126 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#include "traverse.h"
+#include "traverse-hash.h"
+#include <iostream>
+#include "test.h"
+
+
+template<typename T>
+uint64_t hash_of_bytes(const T& obj) {
+  std::stringbuf buf;
+  traverse::BinarySerialize serialize(buf);
+  visit(serialize, obj);
+  std::string bytes = buf.str();
+  return traverse::hash_bytes(bytes.data(), bytes.size());
+}
+
+// Hashing the object should be the same as hashing its bytes
+template<typename T>
+void test_same_hash(const T& obj) {
+  TEST_EQ_QUIET(traverse::hash_value(obj), hash_of_bytes(obj));
+}
+
+const Polygon polygon = {BLUE, Mood::HULK_SMASH, Charred::END, "UFO\"1942\"", {{3, 5}, {4, 6}, {5, 7}}};
+
+void test_bytes() {
+  std::cout << "__ Hash of the binary format __" << std::endl;
+  test_same_hash(0);
+  test_same_hash(-1000000);
+  test_same_hash('\xff');
+  test_same_hash(Mood::SAD);
+  test_same_hash(std::string());
+  test_same_hash(std::string(100, 'x'));
+  test_same_hash(polygon);
+  test_same_hash(std::vector<Polygon>(10, polygon));
+  test_same_hash(std::optional<Point>(Point{1, 2}));
+  test_same_hash(std::map<std::string, int>{{"a", 1}, {"bc", 2}});
+  test_same_hash(std::variant<int, Point>(Point{-1, -2}));
+
+  // Vectors of integers are encoded a block at a time
+  for (size_t size : {0, 1, 7, 8, 9, 100, 1000}) {
+    std::vector<int64_t> numbers(size);
+    std::vector<char> chars(size);
+    for (size_t i = 0; i < size; i++) {
+      numbers[i] = int64_t(i * i * i) - 50000;
+      chars[i] = char(i);
+    }
+    test_same_hash(numbers);
+    test_same_hash(chars);
+  }
+
+  // Bytes added in pieces give the same hash as all at once
+  std::string text = "the quick brown fox jumps over the lazy dog";
+  for (size_t split = 0; split <= text.size(); split++) {
+    traverse::HashVisitor hasher;
+    hasher.add(reinterpret_cast<const uint8_t*>(text.data()), split);
+    hasher.add(reinterpret_cast<const uint8_t*>(text.data()) + split, text.size() - split);
+    TEST_EQ_QUIET(hasher.hash(), traverse::hash_bytes(text.data(), text.size()));
+  }
+}
+
+void test_changes() {
+  std::cout << "__ Different values, different hashes __" << std::endl;
+  Polygon polygon2 = polygon;
+  polygon2.points[2].y = 8;
+  TEST_EQ(traverse::hash_value(polygon) != traverse::hash_value(polygon2), true);
+  TEST_EQ(traverse::hash_value(std::string("")) != traverse::hash_value(std::string("\0", 1)), true);
+  TEST_EQ(traverse::hash_value(std::vector<int>{}) != traverse::hash_value(std::vector<int>{0}), true);
+}
+
+
+void test_cache() {
+  std::cout << "__ Cached hashes of Versioned values __" << std::endl;
+  Scene scene{"scene", std::vector<traverse::Versioned<Polygon>>(5, polygon)};
+  uint64_t uncached = traverse::hash_value(scene);
+
+  traverse::HashCache cache;
+  traverse::HashVisitor hasher{&cache};
+  visit(hasher, scene);
+  TEST_EQ(hasher.hash(), uncached);
+  TEST_EQ(cache.hits, 4u); // the copies share a version
+
+  traverse::HashVisitor hasher2{&cache};
+  visit(hasher2, scene);
+  TEST_EQ(hasher2.hash(), uncached);
+  TEST_EQ(cache.hits, 9u);
+
+  // Changing a value gives it a new version, so it's hashed again
+  scene.shapes[3].modify().name = "changed";
+  traverse::HashVisitor hasher3{&cache};
+  visit(hasher3, scene);
+  TEST_EQ(hasher3.hash(), traverse::hash_value(scene));
+  TEST_EQ(hasher3.hash() != uncached, true);
+  TEST_EQ(cache.hits, 13u);
+
+  // The hashes depend on the seed, so a different seed starts over
+  traverse::HashVisitor seeded{nullptr, 7};
+  visit(seeded, scene);
+  traverse::HashVisitor seeded2{&cache, 7};
+  visit(seeded2, scene);
+  TEST_EQ(seeded2.hash(), seeded.hash());
+  TEST_EQ(cache.hits, 16u);
+  traverse::HashVisitor unseeded{&cache};
+  visit(unseeded, scene);
+  TEST_EQ(unseeded.hash(), hasher3.hash());
+
+  // Reading into a Versioned value changes its version
+  uint64_t version = scene.shapes[0].version();
+  std::stringbuf buf;
+  traverse::BinarySerialize serialize(buf);
+  visit(serialize, scene);
+  traverse::BinaryDeserialize deserialize(buf);
+  visit(deserialize, scene);
+  TEST_EQ(deserialize.Errors(), "");
+  TEST_EQ(scene.shapes[0].version() != version, true);
+  TEST_EQ(scene.shapes[3].get().name, "changed");
+}
+
+
+int main() {
+  test_bytes();
+  test_changes();
+  test_cache();
+}
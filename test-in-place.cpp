@@ -0,0 +1,117 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#include "traverse.h"
+#include "traverse-buffer.h"
+#include <iostream>
+#include "test.h"
+#include "test-alloc.h"
+
+
+struct Layer {
+  std::string name;
+  std::vector<Polygon> polygons;
+  std::vector<std::string> tags;
+};
+TRAVERSE_STRUCT(Layer, FIELD(name) FIELD(polygons) FIELD(tags))
+
+// Names are longer than the small string buffer, so they're on the heap
+Layer make_layer(int tick, int polygons) {
+  Layer layer;
+  layer.name = "layer at tick number " + std::to_string(tick);
+  for (int i = 0; i < polygons; i++) {
+    Polygon polygon{Color(i % 2), Mood::SAD, Charred::START,
+                    "polygon with a long name " + std::to_string(i + tick), {}};
+    for (int j = 0; j < i + 3; j++) {
+      polygon.points.push_back(Point{i * tick, j});
+    }
+    layer.polygons.push_back(polygon);
+  }
+  layer.tags = {"a tag that's long enough to allocate", "another one that also allocates"};
+  return layer;
+}
+
+
+void test_streambuf() {
+  std::cout << "__ Update in place from streambuf __" << std::endl;
+  std::stringbuf tick1(streambuf_bytes(make_layer(1, 10))), tick2(streambuf_bytes(make_layer(2, 10)));
+  Layer layer;
+  {
+    traverse::BinaryDeserialize reader(tick1);
+    reader.update_in_place = true;
+    visit(reader, layer);
+  }
+  for (int repeat = 0; repeat < 3; repeat++) {
+    for (std::stringbuf* buf : {&tick2, &tick1}) {
+      buf->pubseekpos(0, std::ios::in);
+      size_t allocations = count_allocations([&]() {
+        traverse::BinaryDeserialize reader(*buf);
+        reader.update_in_place = true;
+        visit(reader, layer);
+      });
+      TEST_EQ(allocations, 0u);
+    }
+  }
+  TEST_EQ(to_string(layer), to_string(make_layer(1, 10)));
+
+  // Without update_in_place, the nested strings are reallocated
+  tick2.pubseekpos(0, std::ios::in);
+  size_t allocations = count_allocations([&]() {
+    traverse::BinaryDeserialize reader(tick2);
+    visit(reader, layer);
+  });
+  TEST_EQ(allocations > 10, true);
+  TEST_EQ(to_string(layer), to_string(make_layer(2, 10)));
+}
+
+
+void test_buffer() {
+  std::cout << "__ Update in place from buffer __" << std::endl;
+  std::string tick1 = streambuf_bytes(make_layer(1, 10)), tick2 = streambuf_bytes(make_layer(2, 10));
+  Layer layer;
+  for (int repeat = 0; repeat < 3; repeat++) {
+    for (const std::string* msg : {&tick1, &tick2}) {
+      size_t allocations = count_allocations([&]() {
+        traverse::BufferDeserialize reader(reinterpret_cast<const uint8_t*>(msg->data()), msg->size());
+        reader.update_in_place = true;
+        visit(reader, layer);
+      });
+      // Only the first message allocates
+      TEST_EQ_QUIET(allocations == 0, repeat > 0 || msg == &tick2);
+    }
+  }
+  TEST_EQ(to_string(layer), to_string(make_layer(2, 10)));
+}
+
+
+void test_resize() {
+  std::cout << "__ Update in place to a different size __" << std::endl;
+  for (int before : {0, 3, 10}) {
+    for (int after : {0, 3, 10}) {
+      std::stringbuf buf1(streambuf_bytes(make_layer(1, before))), buf2(streambuf_bytes(make_layer(2, after)));
+      Layer layer;
+      traverse::BinaryDeserialize reader1(buf1), reader2(buf2);
+      reader1.update_in_place = reader2.update_in_place = true;
+      visit(reader1, layer);
+      visit(reader2, layer);
+      TEST_EQ_QUIET(to_string(layer), to_string(make_layer(2, after)));
+      TEST_EQ_QUIET(reader2.Errors(), "");
+
+      std::string msg = streambuf_bytes(make_layer(2, after));
+      traverse::BufferDeserialize reader3(reinterpret_cast<const uint8_t*>(msg.data()), msg.size());
+      reader3.update_in_place = true;
+      layer = make_layer(1, before);
+      visit(reader3, layer);
+      TEST_EQ_QUIET(to_string(layer), to_string(make_layer(2, after)));
+      TEST_EQ_QUIET(reader3.Errors(), "");
+    }
+  }
+}
+
+
+int main() {
+  test_streambuf();
+  test_buffer();
+  test_resize();
+}
@@ -0,0 +1,174 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#include "traverse.h"
+#include "traverse-incremental.h"
+#include <iostream>
+#include "test.h"
+
+
+struct Message {
+  int64_t id;
+  std::optional<std::string> title;
+  std::vector<Polygon> polygons;
+  std::vector<int> numbers;
+  std::map<std::string, int> counts;
+};
+TRAVERSE_STRUCT(Message, FIELD(id) FIELD(title) FIELD(polygons) FIELD(numbers) FIELD(counts))
+
+template<typename T>
+std::vector<uint8_t> to_bytes(const T& obj) {
+  std::string bytes = streambuf_bytes(obj);
+  return std::vector<uint8_t>(bytes.begin(), bytes.end());
+}
+
+Message make_message() {
+  Message message{-42, "hello", {}, {}, {{"a", 1}, {"bc", -2}}};
+  for (int i = 0; i < 20; i++) {
+    message.polygons.push_back(make_polygon("polygon " + std::to_string(i), {{i, -i}, {1000 * i, 5}}));
+  }
+  for (int i = 0; i < 1000; i++) {
+    message.numbers.push_back(i * i - 70000);
+  }
+  return message;
+}
+
+// Feeding the bytes in chunks of any size should give the same object
+template<typename T>
+void test_chunks(const T& obj, size_t chunk_size) {
+  std::vector<uint8_t> bytes = to_bytes(obj);
+  traverse::IncrementalDeserialize reader;
+  T obj2{};
+  traverse::DecodeStatus status = traverse::DecodeStatus::NEED_MORE_DATA;
+  size_t fed = 0;
+  bool early = false;
+  while (fed < bytes.size()) {
+    size_t size = std::min(chunk_size, bytes.size() - fed);
+    status = reader.feed(obj2, bytes.data() + fed, size);
+    fed += size;
+    if (status != traverse::DecodeStatus::NEED_MORE_DATA && fed != bytes.size()) { early = true; }
+  }
+  TEST_EQ_QUIET(early, false);
+  TEST_EQ_QUIET(status == traverse::DecodeStatus::DONE, true);
+  TEST_EQ_QUIET(reader.Errors(), "");
+  TEST_EQ_QUIET(reader.remaining(), 0u);
+  TEST_EQ_QUIET(to_string(obj2), to_string(obj));
+}
+
+void test_feed() {
+  std::cout << "__ Feed the input a chunk at a time __" << std::endl;
+  Message message = make_message();
+  for (size_t chunk_size : {1, 2, 3, 7, 64, 1000, 100000}) {
+    test_chunks(message, chunk_size);
+  }
+  test_chunks(int64_t(-1000000), 1);
+  test_chunks(std::string("hello"), 2);
+  test_chunks(std::vector<std::vector<int>>{{1, 2}, {}, {300, 400, 500}}, 1);
+}
+
+void test_progress() {
+  std::cout << "__ Keep what was decoded between chunks __" << std::endl;
+  Message message = make_message();
+  std::vector<uint8_t> bytes = to_bytes(message);
+  traverse::IncrementalDeserialize reader;
+  Message message2;
+  size_t half = bytes.size() / 2;
+  TEST_EQ(reader.feed(message2, bytes.data(), half) == traverse::DecodeStatus::NEED_MORE_DATA, true);
+  TEST_EQ(message2.id, -42);
+  TEST_EQ(message2.polygons.size(), 20u);
+  TEST_EQ(message2.numbers.size() > 0u, true);
+  TEST_EQ(reader.remaining() < 10u, true); // only a partial number is kept
+  TEST_EQ(reader.feed(message2, bytes.data() + half, bytes.size() - half) == traverse::DecodeStatus::DONE, true);
+  TEST_EQ(message2.numbers.size(), 1000u);
+  TEST_EQ(to_string(message2.counts), to_string(message.counts));
+}
+
+void test_next_object() {
+  std::cout << "__ Bytes after the object are for the next one __" << std::endl;
+  std::vector<uint8_t> bytes = to_bytes(Point{1, 2});
+  std::vector<uint8_t> second = to_bytes(Point{3, 4});
+  bytes.insert(bytes.end(), second.begin(), second.end());
+
+  traverse::IncrementalDeserialize reader;
+  Point point;
+  TEST_EQ(reader.feed(point, bytes) == traverse::DecodeStatus::DONE, true);
+  TEST_EQ(to_string(point), "Point{x:1, y:2}");
+  TEST_EQ(reader.remaining(), 2u);
+  reader.reset();
+  TEST_EQ(reader.feed(point, nullptr, 0) == traverse::DecodeStatus::DONE, true);
+  TEST_EQ(to_string(point), "Point{x:3, y:4}");
+  TEST_EQ(reader.remaining(), 0u);
+}
+
+void test_errors() {
+  std::cout << "__ Errors in incremental input __" << std::endl;
+  std::vector<uint8_t> bytes = to_bytes(make_message());
+  traverse::IncrementalDeserialize reader;
+  Message message;
+  TEST_EQ(reader.feed(message, bytes.data(), 100) == traverse::DecodeStatus::NEED_MORE_DATA, true);
+  TEST_EQ(reader.close() == traverse::DecodeStatus::FAILED, true);
+  TEST_EQ(reader.errors.code == traverse::ErrorCode::END_OF_INPUT, true);
+  TEST_EQ(reader.Errors(), "Error: input ended after 100 bytes, before the object was complete\n");
+
+  traverse::IncrementalDeserialize limited;
+  limited.max_elements = 100;
+  TEST_EQ(limited.feed(message, bytes) == traverse::DecodeStatus::FAILED, true);
+  TEST_EQ(limited.errors.code == traverse::ErrorCode::SIZE_LIMIT, true);
+  TEST_EQ(limited.errors.field_path(), "numbers");
+
+  std::vector<uint8_t> bad_variant = {5};
+  traverse::IncrementalDeserialize variant_reader;
+  std::variant<int, Point> variant;
+  TEST_EQ(variant_reader.feed(variant, bad_variant) == traverse::DecodeStatus::FAILED, true);
+  TEST_EQ(variant_reader.errors.code == traverse::ErrorCode::BAD_VALUE, true);
+
+}
+
+// Over-long encodings are accepted, as with BufferDeserialize, however
+// the input is split up
+template<typename T>
+void test_long_encoding(const std::vector<uint8_t>& bytes, const T& expected) {
+  traverse::BufferDeserialize buffer_reader(bytes);
+  T buffer_value{};
+  visit(buffer_reader, buffer_value);
+  TEST_EQ(buffer_reader.Errors(), "");
+  TEST_EQ(to_string(buffer_value), to_string(expected));
+
+  traverse::IncrementalDeserialize whole_reader;
+  T whole_value{};
+  TEST_EQ(whole_reader.feed(whole_value, bytes) == traverse::DecodeStatus::DONE, true);
+  TEST_EQ(to_string(whole_value), to_string(expected));
+
+  traverse::IncrementalDeserialize byte_reader;
+  T byte_value{};
+  traverse::DecodeStatus status = traverse::DecodeStatus::NEED_MORE_DATA;
+  for (size_t i = 0; i < bytes.size() && status == traverse::DecodeStatus::NEED_MORE_DATA; i++) {
+    status = byte_reader.feed(byte_value, bytes.data() + i, 1);
+  }
+  TEST_EQ(byte_reader.Errors(), "");
+  TEST_EQ(status == traverse::DecodeStatus::DONE, true);
+  TEST_EQ(to_string(byte_value), to_string(expected));
+}
+
+void test_long_encodings() {
+  std::cout << "__ Numbers with more bytes than they need __" << std::endl;
+  // A vector size of 1 in 12 bytes, then the number 2
+  std::vector<uint8_t> long_size = {0x81, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00, 4};
+  test_long_encoding(long_size, std::vector<int>{2});
+  std::vector<uint8_t> long_size_point = long_size;
+  long_size_point.push_back(6);
+  test_long_encoding(long_size_point, std::vector<Point>{{2, 3}});
+  // An element of 2 in 12 bytes
+  std::vector<uint8_t> long_element = {2, 0x84, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00, 6};
+  test_long_encoding(long_element, std::vector<int>{2, 3});
+}
+
+
+int main() {
+  test_feed();
+  test_progress();
+  test_next_object();
+  test_errors();
+  test_long_encodings();
+}
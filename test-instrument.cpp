@@ -0,0 +1,139 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+// The instrumentation has to be on before any TRAVERSE_STRUCT
+#ifndef TRAVERSE_INSTRUMENT
+#define TRAVERSE_INSTRUMENT
+#endif
+
+#include "traverse.h"
+#include "traverse-buffer.h"
+#include "traverse-instrument.h"
+#include <iostream>
+#include "test.h"
+
+
+const Polygon polygon = {BLUE, Mood::HULK_SMASH, Charred::END, "UFO\"1942\"", {{3, 5}, {4, 6}, {500, 7}}};
+
+void test_binary_counts() {
+  std::cout << "__ Counts per struct and field __" << std::endl;
+  std::stringbuf buf;
+  traverse::BinarySerialize writer(buf);
+  traverse::Profile profile;
+  traverse::visit_profiled(profile, writer, polygon);
+  uint64_t size = buf.str().size();
+
+  TEST_EQ(profile.get("Polygon").calls, 1u);
+  TEST_EQ(profile.get("Polygon").bytes, size);
+  TEST_EQ(profile.get("Polygon", "name").bytes, 10u); // the size and 9 characters
+  TEST_EQ(profile.get("Polygon", "points").bytes, 8u);
+  TEST_EQ(profile.get("Point").calls, 3u);
+  TEST_EQ(profile.get("Point", "x").calls, 3u);
+  TEST_EQ(profile.get("Point", "x").bytes, 4u); // 500 takes two bytes
+  TEST_EQ(profile.get("Point", "y").bytes, 3u);
+  TEST_EQ(profile.get("Point", "z").calls, 0u);
+
+  // Reading counts the bytes consumed
+  traverse::BinaryDeserialize reader(buf);
+  traverse::Profile read_profile;
+  Polygon polygon2;
+  traverse::visit_profiled(read_profile, reader, polygon2);
+  TEST_EQ(reader.Errors(), "");
+  TEST_EQ(read_profile.get("Polygon").bytes, size);
+  TEST_EQ(read_profile.get("Point", "x").bytes, 4u);
+
+  // Without an active Profile, nothing is counted
+  visit(writer, polygon);
+  TEST_EQ(profile.get("Polygon").calls, 1u);
+}
+
+void test_buffer_counts() {
+  std::cout << "__ Counts with the fixed and columnar paths __" << std::endl;
+  std::vector<Point> points = polygon.points;
+
+  // Structs of numbers are counted a field at a time
+  std::vector<uint8_t> bytes;
+  {
+    traverse::BufferSerialize writer(bytes);
+    traverse::Profile profile;
+    traverse::visit_profiled(profile, writer, points);
+    TEST_EQ(profile.get("Point").calls, 3u);
+    TEST_EQ(profile.get("Point", "x").bytes, 4u);
+  }
+  traverse::BufferDeserialize reader(bytes);
+  traverse::Profile read_profile;
+  std::vector<Point> points2;
+  traverse::visit_profiled(read_profile, reader, points2);
+  TEST_EQ(reader.Errors(), "");
+  TEST_EQ(read_profile.get("Point", "y").bytes, 3u);
+  TEST_EQ(points2.size(), 3u);
+
+  // In columnar mode, each field is one column
+  std::vector<uint8_t> column_bytes;
+  traverse::Profile column_profile;
+  {
+    traverse::BufferSerialize writer(column_bytes);
+    writer.columnar = true;
+    traverse::visit_profiled(column_profile, writer, points);
+  }
+  TEST_EQ(column_profile.get("Point", "x").calls, 1u);
+  TEST_EQ(column_profile.get("Point", "x").bytes, 4u); // deltas 3, 1, 496
+  TEST_EQ(column_profile.get("Point", "y").bytes, 3u);
+}
+
+void test_reports() {
+  std::cout << "__ Text and JSON reports __" << std::endl;
+  traverse::SizeCounter counter;
+  traverse::Profile profile;
+  traverse::visit_profiled(profile, counter, polygon);
+  TEST_EQ(profile.get("Polygon").bytes, counter.size);
+
+  std::vector<traverse::Profile::Line> lines = profile.lines();
+  TEST_EQ(lines.size(), 9u);
+  TEST_EQ(lines[0].type, "Polygon"); // the most bytes
+  TEST_EQ(lines[0].field, "");
+  TEST_EQ(lines[1].field, "name");
+  TEST_EQ(lines[6].type, "Point");
+
+  std::string report = profile.report();
+  TEST_EQ(report.find("struct.field") == 0, true);
+  TEST_EQ(report.find("\nPolygon ") != std::string::npos, true);
+  TEST_EQ(report.find("\n  .points ") != std::string::npos, true);
+
+  std::string json = profile.json();
+  TEST_EQ(json.find("[{\"struct\":\"Polygon\",\"field\":\"\",\"calls\":1,\"bytes\":") == 0, true);
+  TEST_EQ(json.find("{\"struct\":\"Point\",\"field\":\"y\",\"calls\":3,\"bytes\":3}") != std::string::npos, true);
+
+  // With timing, there are times too
+  traverse::Profile timed;
+  timed.timing = true;
+  traverse::visit_profiled(timed, counter, polygon);
+  TEST_EQ(timed.get("Polygon").time > 0, true);
+  TEST_EQ(timed.report().find(traverse::profile_time_unit) != std::string::npos, true);
+  TEST_EQ(timed.json().find(std::string("\"") + traverse::profile_time_unit + "\":") != std::string::npos, true);
+}
+
+void test_nested_profiles() {
+  std::cout << "__ Nested Profiling __" << std::endl;
+  traverse::SizeCounter counter;
+  traverse::Profile outer, inner;
+  Point point{1, 2};
+  {
+    traverse::Profiling profiling(outer);
+    visit(counter, point);
+    traverse::visit_profiled(inner, counter, point);
+    visit(counter, point);
+  }
+  visit(counter, point);
+  TEST_EQ(outer.get("Point").calls, 2u);
+  TEST_EQ(inner.get("Point").calls, 1u);
+}
+
+
+int main() {
+  test_binary_counts();
+  test_buffer_counts();
+  test_reports();
+  test_nested_profiles();
+}
@@ -6,6 +6,7 @@
 // signed integers are represented.
 
 #include "traverse.h"
+#include "traverse-buffer.h"
 #include <iostream>
 #include "test.h"
 
@@ -36,16 +37,36 @@ void show_s(int64_t x) {
   std::cout << "]" << std::endl;
 }
 
+// The contiguous memory decoders have a fast path when there's
+// enough room to read 8 bytes at once, and a slow path near the end
+// of the buffer; test both, and also the bulk decoder
+bool buffer_decodes_to(const std::string& bytes, uint64_t x) {
+  bool ok = true;
+  for (size_t padding : {0, 16}) {
+    std::string padded = bytes + std::string(padding, '\xff');
+    const uint8_t* start = reinterpret_cast<const uint8_t*>(padded.data());
+    const uint8_t* end = start + padded.size();
+    uint64_t y = 0, z = 0;
+    const uint8_t* next = traverse::read_unsigned_int(start, end, y);
+    ok = ok && next == start + bytes.size() && x == y;
+    const uint8_t* in = start;
+    ok = ok && traverse::decode_varints(in, end, &z, 1) == 1 && in == next && x == z;
+  }
+  return ok;
+}
+
 void test_roundtrip_u(uint64_t x, bool quiet=false) {
   std::stringbuf msg;
   traverse::write_unsigned_int(msg, x);
+  bool buffer_ok = buffer_decodes_to(msg.str(), x);
   
   uint64_t y;
   if (traverse::read_unsigned_int(msg, y)) {
-    if (quiet && x == y) return;
+    if (quiet && x == y && buffer_ok) return;
   }
   show_u(x);
   TEST_EQ(x, y);
+  TEST_EQ(buffer_ok, true);
 }
 
 void test_roundtrip_s(int64_t x, bool quiet=false) {
@@ -98,4 +119,68 @@ int main() {
   for (int64_t x = -1000000; x < 1000000; x++) {
     test_roundtrip_s(x, true);
   }
+
+  // A run of numbers of different lengths, decoded in bulk, with
+  // the last one cut short
+  {
+    std::stringbuf msg;
+    std::vector<uint64_t> numbers;
+    for (uint64_t x = 1; x != 0; x <<= 3) {
+      numbers.push_back(x);
+      traverse::write_unsigned_int(msg, x);
+    }
+    std::string bytes = msg.str();
+    const uint8_t* start = reinterpret_cast<const uint8_t*>(bytes.data());
+    const uint8_t* end = start + bytes.size();
+    std::vector<uint64_t> decoded(numbers.size());
+    const uint8_t* in = start;
+    TEST_EQ(traverse::decode_varints(in, end, decoded.data(), decoded.size()), numbers.size());
+    TEST_EQ(in == end, true);
+    TEST_EQ(decoded == numbers, true);
+
+    in = start;
+    TEST_EQ(traverse::decode_varints(in, end - 1, decoded.data(), decoded.size()), numbers.size() - 1);
+    TEST_EQ(in == end - traverse::max_varint_size, true);
+  }
+
+  // The bulk decoder reads 8 bytes at a time when built with BMI2;
+  // it should agree with decoding one number at a time wherever the
+  // numbers fall in those 8 bytes
+  {
+    std::stringbuf msg;
+    for (uint64_t x = 0; x < 3000; x++) {
+      traverse::write_unsigned_int(msg, (x * x * 2654435761u) >> (x % 64));
+    }
+    std::string bytes = msg.str();
+    for (size_t skip = 0; skip < 8; skip++) {
+      const uint8_t* start = reinterpret_cast<const uint8_t*>(bytes.data());
+      const uint8_t* end = start + bytes.size();
+      std::vector<uint64_t> expected;
+      for (size_t i = 0; i < skip; i++) {
+        uint64_t x = 0;
+        start = traverse::read_unsigned_int(start, end, x);
+      }
+      for (const uint8_t* p = start; p != end; ) {
+        uint64_t x = 0;
+        p = traverse::read_unsigned_int(p, end, x);
+        expected.push_back(x);
+      }
+      std::vector<uint64_t> decoded(expected.size());
+      const uint8_t* in = start;
+      TEST_EQ(traverse::decode_varints(in, end, decoded.data(), decoded.size()), expected.size());
+      TEST_EQ(in == end, true);
+      TEST_EQ(decoded == expected, true);
+    }
+  }
+
+  // Encodings longer than 10 bytes are malformed, but the streambuf
+  // and memory decoders should still agree on them
+  for (size_t length = 10; length < 14; length++) {
+    std::string bytes(length - 1, '\x80');
+    bytes += '\x7f';
+    std::stringbuf msg(bytes);
+    uint64_t x = 0;
+    TEST_EQ(traverse::read_unsigned_int(msg, x), true);
+    TEST_EQ(buffer_decodes_to(bytes, x), true);
+  }
 }
@@ -36,6 +36,24 @@ void writer_unit_tests() {
   TEST_EQ(lua_repr(L, -1), "{charred = 1, color = 1, mood = 2, name = \"UFO\\\"1942\\\"\", points = {{x = 3, y = 5}, {x = 4, y = 6}, {x = 5, y = 7}}}");
   lua_pop(L, 1);
 
+  // The second struct of a type uses the field names cached in the registry
+  visit(writer, Point{1, 2});
+  visit(writer, Point{3, 4});
+  TEST_EQ(lua_repr(L, -1), "{x = 3, y = 4}");
+  TEST_EQ(lua_repr(L, -2), "{x = 1, y = 2}");
+  lua_pop(L, 2);
+
+  // Optionals, arrays, maps
+  visit(writer, std::optional<int>());
+  TEST_EQ(lua_repr(L, -1), "nil");
+  lua_pop(L, 1);
+  visit(writer, std::array<int, 2>{3, 4});
+  TEST_EQ(lua_repr(L, -1), "{3, 4}");
+  lua_pop(L, 1);
+  visit(writer, std::map<std::string, int>{{"a", 1}});
+  TEST_EQ(lua_repr(L, -1), "{a = 1}");
+  lua_pop(L, 1);
+
   // Each test should leave the stack alone
   TEST_EQ(lua_gettop(L), 0);
   lua_close(L);
@@ -76,6 +94,133 @@ void reader_unit_tests() {
   s1 << p1; s2 << p2;
   TEST_EQ(s1.str(), s2.str());
 
+  // Optionals, arrays, maps
+  std::optional<int> o = 3;
+  lua_eval(L, "nil");
+  visit(reader, o);
+  TEST_EQ(o.has_value(), false);
+  std::array<int, 2> a;
+  lua_eval(L, "{3, 4}");
+  visit(reader, a);
+  TEST_EQ(a[1], 4);
+  std::map<std::string, int> m;
+  lua_eval(L, "{a = 1, b = 2}");
+  visit(reader, m);
+  TEST_EQ(m["b"], 2);
+
+  // Extra keys are reported by name
+  std::stringstream errors;
+  traverse::LuaReader reader2{L, errors};
+  Point p3;
+  lua_eval(L, "{x = 3, y = 4, z = 5}");
+  visit(reader2, p3);
+  TEST_EQ(p3.y, 4);
+  TEST_EQ(errors.str(), "Error: Lua object contains extra keys: z \n");
+
+  // Each test should leave the stack alone
+  TEST_EQ(lua_gettop(L), 0);
+  lua_close(L);
+}
+
+
+// A struct directly inside a struct, so that both keep their field
+// names on the Lua stack at the same time
+struct Segment {
+  Point from;
+  Point to;
+  std::string label;
+};
+TRAVERSE_STRUCT(Segment, FIELD(from) FIELD(to) FIELD(label))
+
+/** Test nested structs, which use the cached field names at each level */
+void nested_struct_unit_tests() {
+  lua_State* L = luaL_newstate();
+  luaL_openlibs(L);
+
+  traverse::LuaWriter writer{L};
+  std::stringstream errors;
+  traverse::LuaReader reader{L, errors};
+  visit(writer, Segment{{1, 2}, {3, 4}, "first"});
+  visit(writer, std::vector<Segment>{{{5, 6}, {7, 8}, "second"}, {{9, 10}, {11, 12}, "third"}});
+  TEST_EQ(lua_gettop(L), 2);
+  TEST_EQ(lua_repr(L, -1), "{{from = {x = 5, y = 6}, label = \"second\", to = {x = 7, y = 8}}, "
+          "{from = {x = 9, y = 10}, label = \"third\", to = {x = 11, y = 12}}}");
+  std::vector<Segment> segments;
+  visit(reader, segments);
+  TEST_EQ(segments.size(), 2u);
+  TEST_EQ(segments[1].to.y, 12);
+  TEST_EQ(segments[1].label, "third");
+
+  TEST_EQ(lua_repr(L, -1), "{from = {x = 1, y = 2}, label = \"first\", to = {x = 3, y = 4}}");
+  Segment segment;
+  visit(reader, segment);
+  TEST_EQ(segment.from.x, 1);
+  TEST_EQ(segment.to.y, 4);
+  TEST_EQ(segment.label, "first");
+  TEST_EQ(errors.str(), "");
+
+  // Extra and missing keys are reported at each level, and the fields
+  // after them are still read
+  lua_eval(L, "{from = {x = 1, y = 2, z = 3}, to = {y = 4}, label = \"s\", extra = true}");
+  visit(reader, segment);
+  TEST_EQ(segment.from.y, 2);
+  TEST_EQ(segment.to.y, 4);
+  TEST_EQ(segment.label, "s");
+  TEST_EQ(errors.str(), "Error: Lua object contains extra keys: z \n"
+                        "Error: Lua object missing field x\n"
+                        "Error: Lua object contains extra keys: extra \n");
+
+  // Each test should leave the stack alone
+  TEST_EQ(lua_gettop(L), 0);
+  lua_close(L);
+}
+
+
+/** Test that the std containers come back the same from Lua */
+template<typename T>
+void test_round_trip(lua_State* L, const T& value, const std::string& lua) {
+  traverse::LuaWriter writer{L};
+  visit(writer, value);
+  TEST_EQ(lua_repr(L, -1), lua);
+  std::stringstream errors;
+  traverse::LuaReader reader{L, errors};
+  T value2{};
+  visit(reader, value2);
+  TEST_EQ_QUIET(value2 == value, true);
+  TEST_EQ_QUIET(errors.str(), "");
+}
+
+void container_unit_tests() {
+  lua_State* L = luaL_newstate();
+  luaL_openlibs(L);
+
+  test_round_trip(L, std::optional<int>(7), "7");
+  test_round_trip(L, std::optional<int>(), "nil");
+  test_round_trip(L, std::array<std::string, 2>{"a", "b"}, "{\"a\", \"b\"}");
+  test_round_trip(L, std::map<int, std::string>{{1, "a"}, {3, "c"}}, "{\"a\", [3] = \"c\"}");
+  test_round_trip(L, std::map<std::string, std::vector<int>>{{"a", {1, 2}}, {"b", {}}}, "{a = {1, 2}, b = {}}");
+  test_round_trip(L, std::variant<int, std::string>("UFO"), "{data = \"UFO\", which = 1}");
+  test_round_trip(L, std::variant<int, std::string>(-5), "{data = -5, which = 0}");
+
+  // A pointer is read into a new object
+  traverse::LuaWriter writer{L};
+  std::stringstream errors;
+  traverse::LuaReader reader{L, errors};
+  visit(writer, std::make_unique<Point>(Point{1, 2}));
+  TEST_EQ(lua_repr(L, -1), "{x = 1, y = 2}");
+  std::unique_ptr<Point> pointer;
+  visit(reader, pointer);
+  TEST_EQ(pointer != nullptr && pointer->x == 1 && pointer->y == 2, true);
+  lua_eval(L, "nil");
+  visit(reader, pointer);
+  TEST_EQ(pointer == nullptr, true);
+
+  // A variant with a type that isn't there
+  std::variant<int, std::string> variant;
+  lua_eval(L, "{which = 2, data = 3}");
+  visit(reader, variant);
+  TEST_EQ(errors.str(), "Error: tried to read variant 2 but there were only 2 types.\n");
+
   // Each test should leave the stack alone
   TEST_EQ(lua_gettop(L), 0);
   lua_close(L);
@@ -197,6 +342,8 @@ void ignore_flag_unit_tests() {
 int main() {
   writer_unit_tests();
   reader_unit_tests();
+  nested_struct_unit_tests();
+  container_unit_tests();
   mismatch_unit_tests();
   ignore_flag_unit_tests();
 }
@@ -0,0 +1,113 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#include "traverse.h"
+#include "traverse-mmap.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "test.h"
+
+
+struct Asset {
+  std::string_view name;
+  std::vector<Polygon> polygons;
+};
+TRAVERSE_STRUCT(Asset, FIELD(name) FIELD(polygons))
+
+const Polygon polygon = {BLUE, Mood::HULK_SMASH, Charred::END, "UFO\"1942\"", {{3, 5}, {4, 6}, {5, 7}}};
+
+std::string temp_path(const char* name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+void test_read_file() {
+  std::cout << "__ Read a mapped file __" << std::endl;
+  std::string path = temp_path("test-traverse-mmap.bin");
+  Asset asset{"spaceship", std::vector<Polygon>(100, polygon)};
+  {
+    std::filebuf file;
+    file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    traverse::BinarySerialize writer(file);
+    visit(writer, asset);
+  }
+
+  traverse::MappedBinaryDeserialize reader(path);
+  Asset asset2;
+  visit(reader.in, asset2);
+  TEST_EQ(reader.Errors(), "");
+  TEST_EQ(reader.remaining(), 0u);
+  TEST_EQ_QUIET(to_string(asset2), to_string(asset));
+  TEST_EQ(reader.file.size(), size_t(std::filesystem::file_size(path)));
+
+  // The string_view points into the mapped file
+  const char* mapped = reinterpret_cast<const char*>(reader.file.data());
+  TEST_EQ(asset2.name.data() >= mapped && asset2.name.data() < mapped + reader.file.size(), true);
+
+  std::filesystem::remove(path);
+}
+
+void test_batch() {
+  std::cout << "__ Records of a batch in a mapped file __" << std::endl;
+  std::string path = temp_path("test-traverse-mmap-batch.bin");
+  {
+    std::filebuf file;
+    file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    traverse::BatchWriter writer(file);
+    for (int i = 0; i < 10; i++) {
+      Polygon message = polygon;
+      message.name = "message " + std::to_string(i);
+      writer.add(message);
+    }
+  }
+
+  traverse::MappedBinaryDeserialize reader(path, traverse::MappedAccess::RANDOM);
+  reader.in.max_elements = 2;
+  traverse::BatchReader batch = reader.batch();
+  TEST_EQ(batch.Errors(), "");
+  TEST_EQ(batch.size(), 10u);
+  Polygon message;
+  TEST_EQ(batch.read(7, message), false); // 3 points is over max_elements
+  batch.max_elements = 0;
+  batch.errors.clear();
+  TEST_EQ(batch.read(7, message), true);
+  TEST_EQ(message.name, "message 7");
+  TEST_EQ(batch.read(2, message), true);
+  TEST_EQ(message.name, "message 2");
+
+  std::filesystem::remove(path);
+}
+
+void test_errors() {
+  std::cout << "__ Files that can't be mapped __" << std::endl;
+  std::string path = temp_path("test-traverse-mmap-missing.bin");
+  std::filesystem::remove(path);
+  traverse::MappedBinaryDeserialize missing(path);
+  TEST_EQ(missing.in.errors.code == traverse::ErrorCode::FILE_ERROR, true);
+  TEST_EQ(missing.Errors().find("Error: can't open") == 0, true);
+  TEST_EQ(missing.batch().errors.code == traverse::ErrorCode::FILE_ERROR, true);
+  Point point;
+  visit(missing.in, point);
+  TEST_EQ(missing.in.errors.code == traverse::ErrorCode::FILE_ERROR, true);
+
+  traverse::MappedFile directory(std::filesystem::temp_directory_path().string());
+  TEST_EQ(directory.errors.code == traverse::ErrorCode::FILE_ERROR, true);
+  TEST_EQ(directory.data() == nullptr, true);
+
+  // An empty file has nothing to map, but isn't an error
+  path = temp_path("test-traverse-mmap-empty.bin");
+  std::ofstream(path, std::ios::binary | std::ios::trunc).close();
+  traverse::MappedBinaryDeserialize empty(path);
+  TEST_EQ(empty.Errors(), "");
+  TEST_EQ(empty.remaining(), 0u);
+  TEST_EQ(empty.batch().Errors(), "Error: batch header is incomplete\n");
+  std::filesystem::remove(path);
+}
+
+
+int main() {
+  test_read_file();
+  test_batch();
+  test_errors();
+}
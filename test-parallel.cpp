@@ -0,0 +1,119 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#include "traverse.h"
+#include "traverse-parallel.h"
+#include <iostream>
+#include "test.h"
+
+
+Polygon make_message(int i) {
+  return make_message_polygon(i, i % 50);
+}
+
+std::vector<uint8_t> make_batch(int count) {
+  std::stringbuf buf;
+  traverse::BatchWriter writer(buf);
+  for (int i = 0; i < count; i++) {
+    if (i % 1000 == 999) {
+      writer.add(std::string("not a polygon"));
+    } else {
+      writer.add(make_message(i));
+    }
+  }
+  writer.Finish();
+  const std::string bytes = buf.str();
+  return std::vector<uint8_t>(bytes.begin(), bytes.end());
+}
+
+
+void test_same_as_serial() {
+  std::cout << "__ Parallel matches serial __" << std::endl;
+  const std::vector<uint8_t> bytes = make_batch(5000);
+
+  traverse::BatchReader serial(bytes);
+  std::vector<Polygon> expected(serial.size());
+  for (size_t i = 0; i < serial.size(); i++) {
+    serial.read(i, expected[i]);
+  }
+  TEST_EQ(serial.Errors().empty(), false);
+
+  for (unsigned threads : {1u, 2u, 4u, 0u}) {
+    traverse::BatchReader batch(bytes);
+    std::vector<Polygon> messages;
+    TEST_EQ(traverse::parallel_deserialize(batch, messages, threads, 64), false);
+    TEST_EQ(messages.size(), 5000u);
+    TEST_EQ(streambuf_bytes(messages) == streambuf_bytes(expected), true);
+    // Errors are in record order no matter which thread found them
+    TEST_EQ(batch.Errors(), serial.Errors());
+  }
+  TEST_EQ(serial.Errors().substr(0, 11), "Record 999:");
+}
+
+
+void test_edges() {
+  std::cout << "__ Parallel edge cases __" << std::endl;
+  {
+    const std::vector<uint8_t> bytes = make_batch(0);
+    traverse::BatchReader batch(bytes);
+    std::vector<Polygon> messages(3);
+    TEST_EQ(traverse::parallel_deserialize(batch, messages, 4), true);
+    TEST_EQ(messages.size(), 0u);
+  }
+  {
+    // More threads than chunks
+    const std::vector<uint8_t> bytes = make_batch(10);
+    traverse::BatchReader batch(bytes);
+    std::vector<Polygon> messages;
+    TEST_EQ(traverse::parallel_deserialize(batch, messages, 8, 1000), true);
+    TEST_EQ(batch.Errors(), "");
+    TEST_EQ(messages.size(), 10u);
+    TEST_EQ(streambuf_bytes(messages[7]), streambuf_bytes(make_message(7)));
+  }
+  {
+    // update_in_place keeps the elements that are already there
+    const std::vector<uint8_t> bytes = make_batch(100);
+    traverse::BatchReader batch(bytes);
+    batch.update_in_place = true;
+    std::vector<Polygon> messages;
+    traverse::parallel_deserialize(batch, messages, 2, 8);
+    const Point* points = messages[42].points.data();
+    traverse::parallel_deserialize(batch, messages, 2, 8);
+    TEST_EQ(messages[42].points.data() == points, true);
+    TEST_EQ(streambuf_bytes(messages[42]), streambuf_bytes(make_message(42)));
+  }
+}
+
+void test_text_dump() {
+  std::cout << "__ Parallel text dump __" << std::endl;
+  for (size_t count : {0, 1, 5, 100, 1000}) {
+    std::vector<Polygon> messages;
+    for (size_t i = 0; i < count; i++) {
+      messages.push_back(make_message(int(i)));
+    }
+    for (unsigned threads : {1, 3, 8}) {
+      for (size_t chunk_size : {1, 7, 256}) {
+        std::stringstream out;
+        traverse::parallel_text_dump(out, messages, threads, chunk_size);
+        TEST_EQ_QUIET(out.str(), traverse::to_text(messages));
+      }
+    }
+  }
+
+  // Any format, here one element per line
+  std::stringstream lines;
+  traverse::parallel_write(lines, 30, [](size_t i, std::string& text) { text += std::to_string(i * i); }, "\n", 4, 4);
+  std::string expected;
+  for (size_t i = 0; i < 30; i++) {
+    expected += (i == 0 ? "" : "\n") + std::to_string(i * i);
+  }
+  TEST_EQ(lines.str(), expected);
+}
+
+
+int main() {
+  test_same_as_serial();
+  test_edges();
+  test_text_dump();
+}
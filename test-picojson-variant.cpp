@@ -75,7 +75,37 @@ void test_serialization() {
     TEST_EQ(before.str(), after.str());
   }
 
-  // TODO: test handling of corrupted json
+  // std::variant is written the same way
+  {
+    std::cout << "__ std::variant to PicoJSON and back __ " << std::endl;
+    std::vector<std::variant<Create, Move, Quit>> std_queue{Move{1, 2}, Create{42, -10, -10}};
+    picojson::value json;
+    traverse::PicoJsonWriter jsonwriter{json};
+    visit(jsonwriter, std_queue);
+    TEST_EQ(json.serialize(), JSON_DATA);
+
+    std::stringstream errors;
+    traverse::PicoJsonReader jsonreader{json, errors};
+    std_queue.clear();
+    visit(jsonreader, std_queue);
+    TEST_EQ(errors.str(), "");
+    TEST_EQ(std_queue.size(), 2u);
+    TEST_EQ(std::get<Create>(std_queue[1]).id, 42);
+  }
+
+  {
+    std::cout << "__ Corrupted JSON variants __ " << std::endl;
+    picojson::value json;
+    picojson::parse(json, "[{\"data\":{\"time\":5},\"which\":3}, 7, {\"data\":{}}]");
+    traverse::ErrorLog errors;
+    traverse::PicoJsonReader jsonreader{json, errors};
+    MessageQueue queue3;
+    visit(jsonreader, queue3);
+    TEST_EQ(errors.str(), "Error: tried to read variant 3 but there were only 3 types.\n"
+            "Warning: expected JSON object for variant; skipping\n"
+            "Error: JSON object missing field 'which'\n");
+    TEST_EQ(errors.code == traverse::ErrorCode::BAD_VALUE, true);
+  }
 }
 
 
@@ -6,10 +6,45 @@
 #include "traverse-picojson.h"
 #include <iostream>
 #include "test.h"
+#include "test-alloc.h"
 
 // TODO: there should be a lot more tests here, more like test-lua.cpp 
 
+// Write the value to JSON, then read it back
+template<typename T>
+void test_same_value(const T& native_value, std::string json_value) {
+  picojson::value json;
+  traverse::PicoJsonWriter jsonwriter{json};
+  visit(jsonwriter, native_value);
+  TEST_EQ(json.serialize(), json_value);
+  std::stringstream errors;
+  traverse::PicoJsonReader jsonreader{json, errors};
+  T output{};
+  visit(jsonreader, output);
+  TEST_EQ_QUIET(output == native_value, true);
+  TEST_EQ_QUIET(errors.str(), "");
+}
+
 int main() {
+  {
+    std::cout << "__ Std containers __ " << std::endl;
+    test_same_value(std::optional<int>(), "null");
+    test_same_value(std::optional<int>(3), "3");
+    test_same_value(std::array<int, 3>{1, -2, 3}, "[1,-2,3]");
+    test_same_value(std::map<std::string, int>{{"a", 1}, {"b", 2}}, "{\"a\":1,\"b\":2}");
+    test_same_value(std::map<int, std::string>{{1, "a"}, {-2, "b"}}, "[[-2,\"b\"],[1,\"a\"]]");
+
+    picojson::value json;
+    picojson::parse(json, "[1,2]");
+    std::stringstream errors;
+    traverse::PicoJsonReader jsonreader{json, errors};
+    std::array<int, 3> array{};
+    visit(jsonreader, array);
+    TEST_EQ(array[1], 2);
+    TEST_EQ(errors.str(), "Warning: expected JSON array of size 3 but found 2\n");
+  }
+
+
   const Polygon polygon = {BLUE, Mood::HULK_SMASH, Charred::END, "UFO\"1942\"", {{3, 5}, {4, 6}, {5, 7}}};
   
   {
@@ -41,4 +76,23 @@ int main() {
     TEST_EQ(out.str(), "Polygon{color:0, mood:0, charred:0, name:\"\", points:[Point{x:3, y:5}, Point{x:4, y:6}, Point{x:0, y:7}, Point{x:0, y:0}]}");
     TEST_EQ(errors.str().substr(0, 7), "Warning");
   }
+
+  {
+    std::cout << "__ Serialize to JSON without copies __ " << std::endl;
+    // The writer should allocate only what the finished value holds,
+    // which is the same as what it takes to copy that value
+    std::vector<Polygon> polygons(20, polygon);
+    polygons[0].name = "a name long enough to need an allocation of its own";
+    picojson::value json3;
+    size_t allocations = count_allocations([&]() {
+      traverse::PicoJsonWriter jsonwriter{json3};
+      visit(jsonwriter, polygons);
+    });
+    picojson::value copy;
+    size_t copy_allocations = count_allocations([&]() {
+      copy = json3;
+    });
+    TEST_EQ(allocations, copy_allocations);
+    TEST_EQ(copy.serialize(), json3.serialize());
+  }
 }
@@ -0,0 +1,177 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#include "traverse.h"
+#include "traverse-buffer.h"
+#include "traverse-fixed.h"
+#include <iostream>
+#include "test.h"
+
+
+struct Route {
+  std::pmr::string name;
+  std::pmr::vector<Point> points;
+  std::pmr::vector<std::pmr::string> stops;
+};
+TRAVERSE_STRUCT(Route, FIELD(name) FIELD(points) FIELD(stops))
+
+// Same format as Route, with the default allocator
+struct PlainRoute {
+  std::string name;
+  std::vector<Point> points;
+  std::vector<std::string> stops;
+};
+TRAVERSE_STRUCT(PlainRoute, FIELD(name) FIELD(points) FIELD(stops))
+
+PlainRoute make_route() {
+  PlainRoute route;
+  route.name = "a route with a name that doesn't fit in a small string";
+  for (int i = 0; i < 50; i++) {
+    route.points.push_back(Point{i, -i});
+  }
+  route.stops = {"first stop, long enough to need an allocation", "", "last stop"};
+  return route;
+}
+
+// Every container in the route came from this resource
+bool uses_resource(const Route& route, std::pmr::memory_resource* resource) {
+  bool ok = route.name.get_allocator().resource() == resource
+    && route.points.get_allocator().resource() == resource
+    && route.stops.get_allocator().resource() == resource;
+  for (const auto& stop : route.stops) {
+    ok = ok && stop.get_allocator().resource() == resource;
+  }
+  return ok;
+}
+
+// An allocator that isn't pmr, to check that the visitors accept any allocator
+template<typename T>
+struct CountingAllocator {
+  using value_type = T;
+  static inline size_t count = 0;
+  CountingAllocator() = default;
+  template<typename U> CountingAllocator(const CountingAllocator<U>&) {}
+  T* allocate(size_t n) { ++count; return std::allocator<T>().allocate(n); }
+  void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+  template<typename U> bool operator == (const CountingAllocator<U>&) const { return true; }
+};
+
+
+void test_streambuf() {
+  std::cout << "__ Read pmr containers from streambuf __" << std::endl;
+  const std::string msg = streambuf_bytes(make_route());
+  std::pmr::monotonic_buffer_resource arena;
+  std::stringbuf buf(msg);
+  traverse::BinaryDeserialize reader(buf);
+  reader.resource = &arena;
+  Route route;
+  visit(reader, route);
+  TEST_EQ(reader.Errors(), "");
+  TEST_EQ(uses_resource(route, &arena), true);
+  TEST_EQ(streambuf_bytes(route), msg);
+  // Debug output is the same except for the struct name
+  TEST_EQ("Plain" + to_string(route), to_string(make_route()));
+
+  traverse::SizeCounter counter;
+  visit(counter, route);
+  TEST_EQ(counter.size, msg.size());
+
+  // Without a resource, the containers keep the allocator they have
+  buf.pubseekpos(0, std::ios::in);
+  traverse::BinaryDeserialize reader2(buf);
+  Route route2;
+  visit(reader2, route2);
+  TEST_EQ(uses_resource(route2, std::pmr::get_default_resource()), true);
+  TEST_EQ(streambuf_bytes(route2), streambuf_bytes(make_route()));
+}
+
+
+void test_buffer() {
+  std::cout << "__ Read pmr containers from buffer __" << std::endl;
+  std::pmr::monotonic_buffer_resource arena;
+  const std::string msg = streambuf_bytes(std::vector<PlainRoute>{make_route(), make_route()});
+  traverse::BufferDeserialize reader(reinterpret_cast<const uint8_t*>(msg.data()), msg.size());
+  reader.resource = &arena;
+  std::pmr::vector<Route> routes;
+  visit(reader, routes);
+  TEST_EQ(reader.Errors(), "");
+  TEST_EQ(routes.size(), 2u);
+  TEST_EQ(routes.get_allocator().resource() == &arena, true);
+  for (const auto& route : routes) {
+    TEST_EQ(uses_resource(route, &arena), true);
+    TEST_EQ(streambuf_bytes(route), streambuf_bytes(make_route()));
+  }
+
+  // A route that was allocated elsewhere is moved to the arena
+  const std::string msg2 = streambuf_bytes(make_route());
+  traverse::BufferDeserialize reader2(reinterpret_cast<const uint8_t*>(msg2.data()), msg2.size());
+  reader2.resource = &arena;
+  std::vector<Route> other(1);
+  other[0].name = "allocated with the default resource";
+  visit(reader2, other[0]);
+  TEST_EQ(reader2.Errors(), "");
+  TEST_EQ(uses_resource(other[0], &arena), true);
+  TEST_EQ(streambuf_bytes(other[0]), streambuf_bytes(make_route()));
+}
+
+
+void test_fixed() {
+  std::cout << "__ Read pmr containers in fixed-width format __" << std::endl;
+  std::stringbuf out;
+  traverse::FixedBinarySerialize writer(out);
+  visit(writer, make_route());
+  const std::string msg = out.str();
+
+  std::pmr::monotonic_buffer_resource arena;
+  std::stringbuf buf(msg);
+  traverse::FixedBinaryDeserialize reader(buf);
+  reader.resource = &arena;
+  Route route;
+  visit(reader, route);
+  TEST_EQ(reader.Errors(), "");
+  TEST_EQ(uses_resource(route, &arena), true);
+  TEST_EQ(streambuf_bytes(route), streambuf_bytes(make_route()));
+
+  const std::vector<uint8_t> bytes(msg.begin(), msg.end());
+  traverse::FixedBufferDeserialize reader2(bytes);
+  reader2.resource = &arena;
+  Route route2;
+  visit(reader2, route2);
+  TEST_EQ(reader2.Errors(), "");
+  TEST_EQ(uses_resource(route2, &arena), true);
+  TEST_EQ(streambuf_bytes(route2), streambuf_bytes(make_route()));
+}
+
+
+void test_custom_allocator() {
+  std::cout << "__ Read containers with a custom allocator __" << std::endl;
+  using String = std::basic_string<char, std::char_traits<char>, CountingAllocator<char>>;
+  std::vector<std::string> plain = {"abc", std::string(100, 'x')};
+  std::vector<String, CountingAllocator<String>> custom;
+  const std::string msg = streambuf_bytes(plain);
+
+  std::stringbuf buf(msg);
+  traverse::BinaryDeserialize reader(buf);
+  visit(reader, custom);
+  TEST_EQ(reader.Errors(), "");
+  TEST_EQ(custom.size(), 2u);
+  TEST_EQ(custom[1].size(), 100u);
+  TEST_EQ(CountingAllocator<char>::count > 0, true);
+  TEST_EQ(streambuf_bytes(custom), msg);
+  TEST_EQ(to_string(custom), to_string(plain));
+
+  traverse::BufferDeserialize reader2(reinterpret_cast<const uint8_t*>(msg.data()), msg.size());
+  custom.clear();
+  visit(reader2, custom);
+  TEST_EQ(reader2.Errors(), "");
+  TEST_EQ(streambuf_bytes(custom), msg);
+}
+
+
+int main() {
+  test_streambuf();
+  test_buffer();
+  test_fixed();
+  test_custom_allocator();
+}
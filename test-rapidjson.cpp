@@ -6,6 +6,7 @@
 #include "traverse-rapidjson.h"
 #include <iostream>
 #include "test.h"
+#include "test-alloc.h"
 
 using std::string;
 
@@ -27,6 +28,14 @@ void test_deserialize(string from_json, T to_value) {
   visit(jsonreader, output);
   TEST_EQ(output, to_value);
   TEST_EQ_QUIET(errors.str(), "");
+
+  rapidjson::StringStream stream(from_json.c_str());
+  std::stringstream sax_errors;
+  traverse::RapidJsonSaxReader saxreader{stream, sax_errors};
+  T sax_output;
+  visit(saxreader, sax_output);
+  TEST_EQ_QUIET(sax_output, to_value);
+  TEST_EQ_QUIET(sax_errors.str(), "");
 }
 
 template<typename T>
@@ -38,6 +47,13 @@ void test_deserialize_fail(string from_json) {
   T output;
   visit(jsonreader, output);
   TEST_EQ(errors.str().substr(0, 7), "Warning");
+
+  // Invalid JSON is an Error instead of a Warning when streaming
+  rapidjson::StringStream stream(from_json.c_str());
+  std::stringstream sax_errors;
+  traverse::RapidJsonSaxReader saxreader{stream, sax_errors};
+  visit(saxreader, output);
+  TEST_EQ_QUIET(sax_errors.str().empty(), false);
 }
 
 template<typename T>
@@ -101,12 +117,265 @@ void test_doubles() {
   test_deserialize_fail<double>("\"string\"");
   test_deserialize_fail<double>("{\"object\"}");
   test_deserialize_fail<double>("[\"array\"]");
+
+  // float is written as a double, and read back from any number
+  test_both(2.0f, "2.0");
+  test_both(-0.25f, "-0.25");
+  test_both(1e30f, "1.0000000150474662e30");
+  test_deserialize("3", 3.0f);
+  test_deserialize_fail<float>("\"string\"");
+}
+
+// Write the value to JSON, then read it back with both readers
+template<typename T>
+void test_same_value(const T& native_value, string json_value) {
+  test_serialize(native_value, json_value);
+  rapidjson::Document json;
+  std::stringstream errors;
+  json.Parse(json_value);
+  traverse::RapidJsonReader jsonreader{json, errors};
+  T output{};
+  visit(jsonreader, output);
+  TEST_EQ_QUIET(output == native_value, true);
+  TEST_EQ_QUIET(errors.str(), "");
+
+  rapidjson::StringStream stream(json_value.c_str());
+  std::stringstream sax_errors;
+  traverse::RapidJsonSaxReader saxreader{stream, sax_errors};
+  T sax_output{};
+  visit(saxreader, sax_output);
+  TEST_EQ_QUIET(sax_output == native_value, true);
+  TEST_EQ_QUIET(sax_errors.str(), "");
+}
+
+void test_std_containers() {
+  std::cout << "__ Test std containers __\n";
+  test_same_value(std::optional<int>(), "null");
+  test_same_value(std::optional<int>(3), "3");
+  test_same_value(std::array<int, 3>{1, -2, 3}, "[1,-2,3]");
+  test_same_value(std::map<std::string, int>{{"a", 1}, {"b", 2}}, "{\"a\":1,\"b\":2}");
+  test_same_value(std::map<int, std::string>{{1, "a"}, {-2, "b"}}, "[[-2,\"b\"],[1,\"a\"]]");
+  test_same_value(std::variant<int, std::string>("UFO"), "{\"which\":1,\"data\":\"UFO\"}");
+  test_serialize(std::unique_ptr<int>(), "null");
+  test_deserialize_fail<std::array<int, 3>>("[1,2]");
+  test_deserialize_fail<std::map<int, int>>("[[1,2,3]]");
+}
+
+void test_serialization_cache() {
+  std::cout << "__ Serialization cache __\n";
+  Scene scene{"scene", std::vector<traverse::Versioned<Polygon>>(2, make_polygon("x", {{1, 2}}))};
+  const string expected = "{\"name\":\"scene\",\"shapes\":[{\"color\":1,\"mood\":1,\"charred\":0,\"name\":\"x\",\"points\":[{\"x\":1,\"y\":2}]},"
+    "{\"color\":1,\"mood\":1,\"charred\":0,\"name\":\"x\",\"points\":[{\"x\":1,\"y\":2}]}]}";
+  test_serialize(scene, expected);
+
+  traverse::SerializationCache cache;
+  for (int i = 0; i < 2; i++) {
+    rapidjson::StringBuffer json;
+    traverse::RapidJsonWriter jsonwriter{json};
+    jsonwriter.cache = &cache;
+    visit(jsonwriter, scene);
+    TEST_EQ(string(json.GetString()), expected);
+  }
+  TEST_EQ(cache.hits, 3u);
+
+  // Reading back gives new versions
+  rapidjson::StringStream stream(expected.c_str());
+  std::stringstream errors;
+  traverse::RapidJsonSaxReader reader{stream, errors};
+  uint64_t version = scene.shapes[0].version();
+  visit(reader, scene);
+  TEST_EQ(errors.str(), "");
+  TEST_EQ(scene.shapes[0].version() != version, true);
+}
+
+void test_output_streams() {
+  std::cout << "__ Write JSON to other output streams __\n";
+  const Polygon polygon = {BLUE, Mood::HULK_SMASH, Charred::END, "UFO", {{3, 5}, {4, 6}}};
+  const string expected = "{\"color\":1,\"mood\":2,\"charred\":1,\"name\":\"UFO\",\"points\":[{\"x\":3,\"y\":5},{\"x\":4,\"y\":6}]}";
+
+  {
+    char buffer[200];
+    traverse::JsonBufferStream output(buffer, sizeof(buffer));
+    traverse::BasicRapidJsonWriter<traverse::JsonBufferStream> jsonwriter{output};
+    visit(jsonwriter, polygon);
+    TEST_EQ(output.overflow, false);
+    TEST_EQ(string(buffer, output.size()), expected);
+  }
+
+  {
+    // Writing stops at the end of the buffer
+    char buffer[20];
+    traverse::JsonBufferStream output(buffer, sizeof(buffer));
+    traverse::BasicRapidJsonWriter<traverse::JsonBufferStream> jsonwriter{output};
+    visit(jsonwriter, polygon);
+    TEST_EQ(output.overflow, true);
+    TEST_EQ(string(buffer, output.size()), expected.substr(0, sizeof(buffer)));
+  }
+
+  {
+    std::stringbuf buf;
+    traverse::JsonStreambufStream output(buf);
+    traverse::BasicRapidJsonWriter<traverse::JsonStreambufStream> jsonwriter{output};
+    visit(jsonwriter, polygon);
+    TEST_EQ(output.failed, false);
+    TEST_EQ(buf.str(), expected);
+  }
+
+  {
+    traverse::JsonChunkStream output(16);
+    traverse::BasicRapidJsonWriter<traverse::JsonChunkStream> jsonwriter{output};
+    visit(jsonwriter, polygon);
+    TEST_EQ(output.size(), expected.size());
+    string joined;
+    for (auto chunk : output.chunks()) {
+      TEST_EQ_QUIET(chunk.size() <= 16, true);
+      joined += chunk;
+    }
+    TEST_EQ(output.chunks().size(), (expected.size() + 15) / 16);
+    TEST_EQ(joined, expected);
+
+    output.clear();
+    TEST_EQ(output.size(), 0u);
+    traverse::BasicRapidJsonWriter<traverse::JsonChunkStream> jsonwriter2{output};
+    visit(jsonwriter2, Point{1, 2});
+    TEST_EQ(string(output.chunks().at(0)), "{\"x\":1,\"y\":2}");
+  }
+
+  {
+    rapidjson::StringBuffer json;
+    traverse::RapidJsonPrettyWriter<rapidjson::StringBuffer> jsonwriter{json};
+    visit(jsonwriter, std::vector<Point>{{3, 5}});
+    TEST_EQ(string(json.GetString()), "[\n    {\n        \"x\": 3,\n        \"y\": 5\n    }\n]");
+  }
+
+  test_serialize(2.5f, "2.5");
+}
+
+void test_sax() {
+  std::cout << "__ Test streaming reader __\n";
+  const string text = "{\"color\":1,\"mood\":2,\"charred\":1,\"name\":\"UFO\\\"1942\\\"\",\"points\":[{\"x\":3,\"y\":5},{\"x\":4,\"y\":6},{\"x\":5,\"y\":7}]}";
+  const Polygon polygon = {BLUE, Mood::HULK_SMASH, Charred::END, "UFO\"1942\"", {{3, 5}, {4, 6}, {5, 7}}};
+  std::stringstream expected;
+  expected << polygon;
+  
+  {
+    rapidjson::StringStream stream(text.c_str());
+    std::stringstream errors;
+    traverse::RapidJsonSaxReader reader{stream, errors};
+    Polygon polygon2;
+    visit(reader, polygon2);
+    std::stringstream out;
+    out << polygon2;
+    TEST_EQ(out.str(), expected.str());
+    TEST_EQ(errors.str(), "");
+  }
+
+  {
+    rapidjson::StringBuffer json;
+    rapidjson::StringStream stream("{\"points\":[{\"UNUSED\":{\"a\":[1,{\"b\":2}]},\"x\":3,\"y\":5},{\"y\":6,\"x\":4},{\"y\":7},{\"x\":\"WRONGTYPE\"}],"
+                                   "\"mood\":[3,4],\"name\":\"square\"}");
+    std::stringstream errors;
+    traverse::RapidJsonSaxReader reader{stream, errors};
+    Polygon polygon2{};
+    visit(reader, polygon2);
+    std::stringstream out;
+    out << polygon2;
+    TEST_EQ(out.str(), "Polygon{color:0, mood:0, charred:0, name:\"square\", points:[Point{x:3, y:5}, Point{x:4, y:6}, Point{x:0, y:7}, Point{x:0, y:0}]}");
+    TEST_EQ(errors.str().substr(0, 7), "Warning");
+    TEST_EQ(errors.str().find("Error"), string::npos);
+  }
+
+  // Truncated text is an error, and the fields read so far are kept
+  for (size_t length = 0; length < text.size(); length++) {
+    string truncated = text.substr(0, length);
+    rapidjson::StringStream stream(truncated.c_str());
+    std::stringstream errors;
+    traverse::RapidJsonSaxReader reader{stream, errors};
+    Polygon polygon2;
+    visit(reader, polygon2);
+    TEST_EQ_QUIET(errors.str().substr(0, 5), "Error");
+  }
+
+  {
+    // An ErrorLog instead of a stream records where the first error was
+    rapidjson::StringStream stream("{\"name\":\"square\",\"points\":[{\"x\":3,\"y\":5},{\"x\":\"WRONGTYPE\",\"y\":6}]}");
+    traverse::ErrorLog errors;
+    traverse::RapidJsonSaxReader reader{stream, errors};
+    Polygon polygon2{};
+    visit(reader, polygon2);
+    TEST_EQ(errors.code == traverse::ErrorCode::TYPE_MISMATCH, true);
+    TEST_EQ(errors.field_path(), "points.x");
+    TEST_EQ(polygon2.points.size(), 2u);
+    TEST_EQ(polygon2.points[1].y, 6);
+  }
+
+  {
+    // Text after the value is an error
+    rapidjson::StringStream stream("[1, 2] 3");
+    std::stringstream errors;
+    traverse::RapidJsonSaxReader reader{stream, errors};
+    std::vector<int> numbers;
+    visit(reader, numbers);
+    TEST_EQ(numbers.size(), 2u);
+    TEST_EQ(errors.str().substr(0, 5), "Error");
+  }
+
+  {
+    std::cout << "__ Stream JSON in place __\n";
+    const string text2 = "[" + text + "," + text + "]";
+    std::vector<Polygon> polygons;
+    std::stringstream errors;
+    rapidjson::StringStream stream(text2.c_str());
+    traverse::RapidJsonSaxReader reader{stream, errors};
+    reader.update_in_place = true;
+    visit(reader, polygons);
+    TEST_EQ(polygons.size(), 2u);
+    size_t allocations = count_allocations([&]() {
+      rapidjson::StringStream stream2(text2.c_str());
+      traverse::RapidJsonSaxReader reader2{stream2, errors};
+      reader2.update_in_place = true;
+      visit(reader2, polygons);
+    });
+    // rapidjson's parser allocates its stack with malloc, not new
+    TEST_EQ(allocations, 0u);
+    TEST_EQ(errors.str(), "");
+    std::stringstream out;
+    out << polygons[1];
+    TEST_EQ(out.str(), expected.str());
+  }
+
+  {
+    // rapidjson's String() and Key() point into the parser's stack,
+    // which the next token reuses, and which grows past 256 bytes
+    const string long_name(1000, 'n');
+    const string text3 = "{\"" + long_name + "\":{\"" + long_name + "\":[1]},\"name\":\"" + long_name
+      + "\",\"points\":[" + string(40, '[') + string(40, ']') + "]}";
+    rapidjson::StringStream stream(text3.c_str());
+    std::stringstream errors;
+    traverse::RapidJsonSaxReader reader{stream, errors};
+    Polygon polygon2{};
+    visit(reader, polygon2);
+    TEST_EQ(polygon2.name, long_name);
+    TEST_EQ(polygon2.points.size(), 1u);
+    TEST_EQ(errors.str().find("Error"), string::npos);
+
+    std::map<string, string> map;
+    rapidjson::StringStream stream2("{\"a\":\"b\",\"cc\":\"\",\"\":\"dd\"}");
+    traverse::RapidJsonSaxReader reader2{stream2, errors};
+    visit(reader2, map);
+    TEST_EQ(map == (std::map<string, string>{{"a", "b"}, {"cc", ""}, {"", "dd"}}), true);
+    TEST_EQ(errors.str().find("Error"), string::npos);
+  }
 }
 
 int main() {
   test_bools();
   test_ints();
   test_doubles();
+  test_std_containers();
+  test_serialization_cache();
+  test_output_streams();
+  test_sax();
   
   const Polygon polygon = {BLUE, Mood::HULK_SMASH, Charred::END, "UFO\"1942\"", {{3, 5}, {4, 6}, {5, 7}}};
   
@@ -118,6 +387,20 @@ int main() {
     TEST_EQ(string(json.GetString()), string("{\"color\":1,\"mood\":2,\"charred\":1,\"name\":\"UFO\\\"1942\\\"\",\"points\":[{\"x\":3,\"y\":5},{\"x\":4,\"y\":6},{\"x\":5,\"y\":7}]}"));
   }
 
+  {
+    std::cout << "__ Serialize to JSON without copies __\n";
+    std::vector<Polygon> polygons(20, polygon);
+    polygons[0].name = "a name long enough to need an allocation of its own";
+    rapidjson::StringBuffer json;
+    traverse::RapidJsonWriter jsonwriter{json};
+    size_t allocations = count_allocations([&]() {
+      visit(jsonwriter, polygons);
+    });
+    // rapidjson's buffers are allocated with malloc, not new
+    TEST_EQ(allocations, 0u);
+    TEST_EQ(string(json.GetString()).substr(0, 10), "[{\"color\":");
+  }
+
   // Intentionally make the JSON mismatch the C++ data structure, to make sure it flags warnings.
   rapidjson::Document json2;
   {
@@ -139,4 +422,25 @@ int main() {
     TEST_EQ(out.str(), "Polygon{color:0, mood:0, charred:0, name:\"\", points:[Point{x:3, y:5}, Point{x:4, y:6}, Point{x:0, y:7}, Point{x:0, y:0}]}");
     TEST_EQ(errors.str().substr(0, 7), "Warning");
   }
+
+  {
+    std::cout << "__ Deserialize JSON in place __\n";
+    rapidjson::Document json3;
+    json3.Parse("[{\"color\":1,\"mood\":2,\"charred\":1,\"name\":\"a name long enough to allocate\",\"points\":[{\"x\":3,\"y\":5},{\"x\":4,\"y\":6}]},"
+                "{\"color\":0,\"mood\":1,\"charred\":0,\"name\":\"another name that allocates\",\"points\":[{\"x\":7,\"y\":8}]}]");
+    TEST_EQ(json3.HasParseError(), false);
+    std::stringstream errors;
+    std::vector<Polygon> polygons;
+    traverse::RapidJsonReader jsonreader{json3, errors, true};
+    visit(jsonreader, polygons);
+    size_t allocations = count_allocations([&]() {
+      traverse::RapidJsonReader jsonreader2{json3, errors, true};
+      visit(jsonreader2, polygons);
+    });
+    TEST_EQ(allocations, 0u);
+    TEST_EQ(errors.str(), "");
+    TEST_EQ(polygons.size(), 2u);
+    TEST_EQ(polygons[1].name, "another name that allocates");
+    TEST_EQ(polygons[0].points.size(), 2u);
+  }
 }
@@ -0,0 +1,105 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+#include "traverse.h"
+#include "traverse-text.h"
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include "test.h"
+
+
+struct Everything {
+  bool flag;
+  char letter;
+  signed char small;
+  unsigned char byte;
+  int64_t big;
+  uint64_t huge;
+  float ratio;
+  double precise;
+  Signed sign;
+  std::string_view view;
+  std::optional<Point> maybe;
+  std::optional<Point> nothing;
+  std::unique_ptr<int> pointer;
+  std::array<int, 3> triple;
+  std::map<std::string, std::vector<int>> lists;
+  std::variant<int, std::string, Point> choice;
+};
+TRAVERSE_STRUCT(Everything, FIELD(flag) FIELD(letter) FIELD(small) FIELD(byte) FIELD(big) FIELD(huge) FIELD(ratio) FIELD(precise) FIELD(sign) FIELD(view) FIELD(maybe) FIELD(nothing) FIELD(pointer) FIELD(triple) FIELD(lists) FIELD(choice))
+
+template<typename T>
+std::string cout_text(const T& obj) {
+  std::stringstream out;
+  traverse::CoutWriter writer(out);
+  visit(writer, obj);
+  return out.str();
+}
+
+// The TextWriter should write the same text as the CoutWriter
+template<typename T>
+void test_same_text(const T& obj) {
+  TEST_EQ(traverse::to_text(obj), cout_text(obj));
+}
+
+void test_same_as_cout() {
+  std::cout << "__ TextWriter writes what CoutWriter does __" << std::endl;
+  test_same_text(0);
+  test_same_text(-1234567);
+  test_same_text(std::numeric_limits<int64_t>::min());
+  test_same_text(std::numeric_limits<uint64_t>::max());
+  test_same_text(true);
+  test_same_text('x');
+  test_same_text(Mood::HULK_SMASH);
+  test_same_text(Signed::NEGATIVE);
+  for (double value : {0.0, -0.0, 1.0, 0.1, 1.0 / 3.0, 123456.0, 1234567.0, 1e-5, 1e100, -2.5e-300,
+                       std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+                       std::numeric_limits<double>::quiet_NaN()}) {
+    test_same_text(value);
+    test_same_text(float(value));
+  }
+  test_same_text(std::string(""));
+  test_same_text(std::string("plain"));
+  test_same_text(std::string("quote \" and backslash \\ and \"\\\" at the end\\"));
+  test_same_text(Polygon{BLUE, Mood::SAD, Charred::END, "UFO\"1942\"", {{3, 5}, {-4, 6}}});
+  test_same_text(std::vector<Polygon>(3, Polygon{RED, Mood::HAPPY, Charred::START, "", {}}));
+
+  Everything everything{true, 'q', -3, 200, -(int64_t(1) << 40), ~uint64_t(0), 3.25f, 1.0 / 7.0, Signed::ONE,
+                        "a view", Point{1, 2}, std::nullopt, std::make_unique<int>(42), {7, 8, 9},
+                        {{"a", {1, 2}}, {"b", {}}}, Point{5, 6}};
+  test_same_text(everything);
+  everything.pointer.reset();
+  everything.choice = "text";
+  test_same_text(everything);
+}
+
+void test_stream() {
+  std::cout << "__ TextWriter to a stream __" << std::endl;
+  std::vector<Polygon> polygons;
+  for (int i = 0; i < 2000; i++) {
+    polygons.push_back(make_polygon("polygon " + std::to_string(i), {{i, -i}, {2 * i, 3}}));
+  }
+  std::stringstream out;
+  {
+    traverse::TextWriter writer(out);
+    visit(writer, polygons);
+    TEST_EQ(writer.buffer.size() < traverse::TextWriter::flush_size, true);
+    TEST_EQ(out.str().empty(), false); // some has been written already
+  }
+  TEST_EQ(out.str(), cout_text(polygons));
+
+  std::stringstream out2;
+  traverse::TextWriter writer2(out2);
+  visit(writer2, Point{1, 2});
+  writer2.Flush();
+  TEST_EQ(out2.str(), "Point{x:1, y:2}");
+  TEST_EQ(writer2.buffer, "");
+}
+
+
+int main() {
+  test_same_as_cout();
+  test_stream();
+}
@@ -20,6 +20,17 @@ std::string to_bytes(const T& obj) {
   return out.str();
 }
 
+// The size counter should agree with the serializer
+template<typename T>
+void test_size(const T& obj) {
+  std::stringbuf buf;
+  traverse::BinarySerialize serialize(buf);
+  visit(serialize, obj);
+  traverse::SizeCounter counter;
+  visit(counter, obj);
+  TEST_EQ_QUIET(counter.size, buf.str().size());
+}
+
 // char is allowed to be signed or unsigned; test that
 // traverse encodes them the same way.
 template<typename CharIn, typename CharOut> void test_char_compatibility() {
@@ -54,6 +65,236 @@ void test_enum() {
   TEST_EQ(to_bytes(Signed::ONE), "2 ");
 }
 
+
+void test_size_counter() {
+  for (uint64_t x = 1; x != 0; x <<= 1) {
+    for (uint64_t y : {x-1, x, x+1}) {
+      test_size(y);
+      test_size(int64_t(y));
+      test_size(int64_t(0 - y));
+      test_size(int16_t(y));
+      test_size(uint8_t(y));
+    }
+  }
+  test_size('\xff');
+  test_size((signed char)'\xff');
+  test_size(Signed::NEGATIVE);
+  test_size(std::string());
+  test_size(std::string(200, 'x'));
+  test_size(std::vector<int>(1000, -1000));
+}
+
+
+// A visitor that checks the field table matches the field() calls
+namespace traverse {
+  struct FieldChecker {
+    int structs_with_table = 0;
+    int fields_checked = 0;
+  };
+
+  template<typename T>
+  std::enable_if_t<!std::is_class_v<T>, void>
+  visit(FieldChecker&, const T&) {}
+
+  inline void visit(FieldChecker&, const std::string&) {}
+
+  template<typename Element>
+  void visit(FieldChecker& checker, const std::vector<Element>& vector) {
+    for (auto& element : vector) {
+      visit(checker, element);
+    }
+  }
+
+  template<>
+  struct StructVisitor<FieldChecker> {
+    FieldChecker& checker;
+    const FieldTable& fields;
+    size_t next_field = 0;
+
+    StructVisitor(const char*, FieldChecker& checker_, const FieldTable& fields_)
+      : checker(checker_), fields(fields_) {
+      ++checker.structs_with_table;
+    }
+
+    ~StructVisitor() {
+      TEST_EQ_QUIET(next_field, fields.size());
+    }
+
+    template<typename T>
+    StructVisitor& field(const char* label, const T& value) {
+      TEST_EQ_QUIET(fields.names[next_field], std::string_view(label));
+      TEST_EQ_QUIET(fields.find(label), next_field);
+      ++next_field;
+      ++checker.fields_checked;
+      visit(checker, value);
+      return *this;
+    }
+  };
+}
+
+
+void test_field_table() {
+  const Polygon polygon = {BLUE, Mood::HULK_SMASH, Charred::END, "name", {{3, 5}, {4, 6}}};
+  const traverse::FieldTable& fields = traverse::StructFields<Polygon>::table(polygon);
+  TEST_EQ(fields.size(), 5u);
+  TEST_EQ(fields.names[0], "color");
+  TEST_EQ(fields.names[4], "points");
+  TEST_EQ(fields.find("charred"), 2u);
+  TEST_EQ(fields.find("mood"), 1u);
+  TEST_EQ(fields.find("points"), 4u);
+  TEST_EQ(fields.find("point"), traverse::FieldTable::npos);
+  TEST_EQ(fields.find("pointsx"), traverse::FieldTable::npos);
+  TEST_EQ(fields.find(""), traverse::FieldTable::npos);
+  // The table is built once per type
+  TEST_EQ(&traverse::StructFields<Polygon>::table(Polygon{}), &fields);
+
+  traverse::FieldChecker checker;
+  visit(checker, polygon);
+  TEST_EQ(checker.structs_with_table, 3);
+  TEST_EQ(checker.fields_checked, 5 + 2 * 2);
+}
+
+
+void test_std_variant() {
+  std::cout << "__ std::variant __" << std::endl;
+  using Shape = std::variant<Point, Polygon, int, int>;
+  std::vector<Shape> shapes = {Point{3, -5}, Polygon{BLUE, Mood::SAD, Charred::START, "x", {{1, 2}}},
+                               Shape(std::in_place_index<2>, 7), Shape(std::in_place_index<3>, -7)};
+  Shape point = Point{3, 5}; // not const, to check that std::visit isn't picked
+  TEST_EQ(to_bytes(point), "0 6 10 ");
+  TEST_EQ(to_bytes(shapes[3]), "3 13 ");
+  test_size(point);
+  test_size(shapes);
+
+  std::stringstream out;
+  traverse::CoutWriter cout_writer(out);
+  visit(cout_writer, point);
+  TEST_EQ(out.str(), "Point{x:3, y:5}");
+
+  std::stringbuf buf;
+  traverse::BinarySerialize serialize(buf);
+  visit(serialize, shapes);
+  std::vector<Shape> shapes2;
+  traverse::BinaryDeserialize deserialize(buf);
+  visit(deserialize, shapes2);
+  TEST_EQ(deserialize.Errors(), "");
+  TEST_EQ(shapes2.size(), 4u);
+  TEST_EQ(shapes2[2].index(), 2u);
+  TEST_EQ(shapes2[3].index(), 3u);
+  TEST_EQ(std::get<3>(shapes2[3]), -7);
+  TEST_EQ(to_bytes(shapes2), to_bytes(shapes));
+
+  std::stringbuf bad_buf(std::string("\x04\x01"));
+  traverse::BinaryDeserialize bad_deserialize(bad_buf);
+  visit(bad_deserialize, point);
+  TEST_EQ(bad_deserialize.Errors(), "Error: tried to deserialize variant 4 but there were only 4 types.\n");
+  TEST_EQ(bad_deserialize.errors.code == traverse::ErrorCode::BAD_VALUE, true);
+}
+
+void test_std_containers() {
+  std::cout << "__ std::optional, std::array, std::map, std::unique_ptr __" << std::endl;
+  std::optional<int> none, some = -3;
+  std::array<Point, 2> points = {Point{1, 2}, Point{3, 4}};
+  std::map<std::string, int> scores = {{"a", 1}, {"b", -1}};
+  std::unordered_map<int, std::string> names = {{5, "x"}};
+  std::unique_ptr<Point> null_point, point = std::make_unique<Point>(Point{-1, 1});
+  TEST_EQ(to_bytes(none), "0 ");
+  TEST_EQ(to_bytes(some), "1 5 ");
+  TEST_EQ(to_bytes(points), "2 4 6 8 ");
+  TEST_EQ(to_bytes(scores), "2 1 97 2 1 98 1 ");
+  TEST_EQ(to_bytes(names), "1 10 1 120 ");
+  TEST_EQ(to_bytes(null_point), "0 ");
+  TEST_EQ(to_bytes(point), "1 1 2 ");
+  test_size(some);
+  test_size(points);
+  test_size(scores);
+  test_size(names);
+  test_size(point);
+
+  std::stringstream out;
+  traverse::CoutWriter cout_writer(out);
+  visit(cout_writer, scores);
+  out << ' ';
+  visit(cout_writer, none);
+  out << ' ';
+  visit(cout_writer, points);
+  TEST_EQ(out.str(), "{\"a\": 1, \"b\": -1} null [Point{x:1, y:2}, Point{x:3, y:4}]");
+
+  std::stringbuf buf;
+  traverse::BinarySerialize serialize(buf);
+  visit(serialize, none);
+  visit(serialize, some);
+  visit(serialize, points);
+  visit(serialize, scores);
+  visit(serialize, names);
+  visit(serialize, null_point);
+  visit(serialize, point);
+  std::optional<int> none2 = 7, some2;
+  std::array<Point, 2> points2;
+  std::map<std::string, int> scores2 = {{"c", 3}};
+  std::unordered_map<int, std::string> names2;
+  std::unique_ptr<Point> null_point2 = std::make_unique<Point>(), point2;
+  traverse::BinaryDeserialize deserialize(buf);
+  visit(deserialize, none2);
+  visit(deserialize, some2);
+  visit(deserialize, points2);
+  visit(deserialize, scores2);
+  visit(deserialize, names2);
+  visit(deserialize, null_point2);
+  visit(deserialize, point2);
+  TEST_EQ(deserialize.Errors(), "");
+  TEST_EQ(none2.has_value(), false);
+  TEST_EQ(*some2, -3);
+  TEST_EQ(to_bytes(points2), to_bytes(points));
+  TEST_EQ(scores2 == scores, true);
+  TEST_EQ(names2 == names, true);
+  TEST_EQ(null_point2 == nullptr, true);
+  TEST_EQ(to_bytes(point2), to_bytes(point));
+
+  std::stringbuf bad_tag(std::string("\x02\x01"));
+  traverse::BinaryDeserialize bad_tag_deserialize(bad_tag);
+  visit(bad_tag_deserialize, some2);
+  TEST_EQ(bad_tag_deserialize.Errors(), "Error: expected 0 or 1 before an optional value, found 2\n");
+
+  std::stringbuf duplicate(std::string("\x02\x01" "a" "\x02\x01" "a" "\x04", 7));
+  traverse::BinaryDeserialize duplicate_deserialize(duplicate);
+  visit(duplicate_deserialize, scores2);
+  TEST_EQ(duplicate_deserialize.Errors(), "Error: duplicate key in map\n");
+  TEST_EQ(duplicate_deserialize.errors.code == traverse::ErrorCode::BAD_VALUE, true);
+}
+
+void test_serialization_cache() {
+  std::cout << "__ Serialization cache __" << std::endl;
+  const Polygon polygon = {BLUE, Mood::HULK_SMASH, Charred::END, "UFO", {{3, 5}, {4, 6}}};
+  Scene scene{"scene", std::vector<traverse::Versioned<Polygon>>(3, polygon)};
+  auto encode = [&](traverse::SerializationCache* cache) {
+    std::stringbuf buf;
+    traverse::BinarySerialize serialize(buf);
+    serialize.cache = cache;
+    visit(serialize, scene);
+    return buf.str();
+  };
+  std::string uncached = encode(nullptr);
+
+  // The copies share a version, so only the first one is encoded
+  traverse::SerializationCache cache;
+  TEST_EQ(encode(&cache), uncached);
+  TEST_EQ(encode(&cache), uncached);
+  TEST_EQ(cache.hits, 5u);
+  TEST_EQ(cache.fragments.size(), 1u);
+
+  scene.shapes[1].modify().name = "changed";
+  TEST_EQ(encode(&cache), encode(nullptr));
+  TEST_EQ(encode(&cache) != uncached, true);
+  TEST_EQ(cache.fragments.size(), 2u);
+
+  // Over max_bytes, the old entries are dropped
+  traverse::SerializationCache small_cache;
+  small_cache.max_bytes = 1;
+  TEST_EQ(encode(&small_cache), encode(nullptr));
+  TEST_EQ(small_cache.fragments.size(), 1u);
+}
+
   
 int main() {
   test_char_compatibility<char, signed char>();
@@ -64,6 +305,11 @@ int main() {
   test_char_compatibility<signed char, unsigned char>();
   test_int();
   test_enum();
+  test_size_counter();
+  test_field_table();
+  test_std_variant();
+  test_std_containers();
+  test_serialization_cache();
     
   traverse::CoutWriter writer;
   const Polygon polygon = {BLUE, Mood::HULK_SMASH, Charred::END, "UFO\"1942\"", {{3, 5}, {4, 6}, {5, 7}}};
@@ -83,6 +329,11 @@ int main() {
     std::cout << "__ Serialize to bytes __ " << std::endl;
     TEST_EQ(to_bytes(polygon), "1 2 1 9 85 70 79 34 49 57 52 50 34 3 6 10 8 12 10 14 ");
 
+    std::cout << "__ Count bytes __ " << std::endl;
+    traverse::SizeCounter counter;
+    visit(counter, polygon);
+    TEST_EQ(counter.size, buf.str().size());
+
     std::cout << "__ Deserialize from bytes __ " << std::endl;
     std::stringstream out1, out2;
     traverse::BinaryDeserialize reader(buf);
@@ -144,6 +395,57 @@ int main() {
     TEST_EQ(reader.Errors().substr(0, 5), "Error");
   }
 
+  {
+    std::cout << "__ Limits on untrusted sizes __ " << std::endl;
+    std::stringbuf buf1(buf.str());
+    traverse::BinaryDeserialize reader1(buf1);
+    reader1.max_elements = 2;
+    Polygon polygon2;
+    visit(reader1, polygon2);
+    TEST_EQ(reader1.Errors().substr(0, 5), "Error");
+    TEST_EQ(polygon2.points.size(), 0u);
+
+    std::stringbuf buf2(buf.str());
+    traverse::BinaryDeserialize reader2(buf2);
+    reader2.max_bytes = polygon.name.size() + 2 * sizeof(Point);
+    visit(reader2, polygon2);
+    TEST_EQ(reader2.Errors().substr(0, 5), "Error");
+    TEST_EQ(polygon2.name, polygon.name);
+
+    std::stringbuf buf3(buf.str());
+    traverse::BinaryDeserialize reader3(buf3);
+    reader3.max_elements = 3;
+    reader3.max_bytes = polygon.name.size() + 3 * sizeof(Point);
+    visit(reader3, polygon2);
+    TEST_EQ(reader3.Errors(), "");
+  }
+
+  {
+    std::cout << "__ Reserve vector capacity __ " << std::endl;
+    std::vector<int> numbers(100000, 7);
+    std::stringbuf numbers_buf;
+    traverse::BinarySerialize numbers_writer(numbers_buf);
+    visit(numbers_writer, numbers);
+    std::stringbuf input_buf(numbers_buf.str());
+    traverse::BinaryDeserialize reader(input_buf);
+    std::vector<int> numbers2;
+    visit(reader, numbers2);
+    TEST_EQ(numbers2 == numbers, true);
+    TEST_EQ(numbers2.capacity(), numbers.size());
+
+    // A huge size with little data shouldn't reserve much
+    std::stringbuf huge_buf;
+    traverse::BinarySerialize huge_writer(huge_buf);
+    visit(huge_writer, uint64_t(1) << 60);
+    visit(huge_writer, 7);
+    traverse::BinaryDeserialize huge_reader(huge_buf);
+    std::vector<int> numbers3;
+    visit(huge_reader, numbers3);
+    TEST_EQ(numbers3.size(), 1u);
+    TEST_EQ(numbers3.capacity() < 100u, true);
+    TEST_EQ(huge_reader.Errors().substr(0, 5), "Error");
+  }
+
   // Extra bytes are not an error but can be detected by examining the streambuf
   {
     std::cout << "__ Serialized message too long __ " << std::endl;
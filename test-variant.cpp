@@ -86,6 +86,10 @@ void test_serialization() {
     visit(write_before, queue);
     visit(write_after, queue);
     TEST_EQ(before.str(), after.str());
+
+    traverse::SizeCounter counter;
+    visit(counter, queue);
+    TEST_EQ(counter.size, buf.str().size());
   }
   
   // Test corrupting the data
@@ -107,6 +111,31 @@ void test_serialization() {
     traverse::BinaryDeserialize invalid_type(corrupted_buf2);
     visit(invalid_type, m);
     TEST_EQ(wrong_variant.Errors().size() != 0, true);
+
+    msg[0] = 3;
+    std::stringbuf corrupted_buf3(msg);
+    traverse::BinaryDeserialize past_end(corrupted_buf3);
+    visit(past_end, m);
+    TEST_EQ(past_end.Errors(), "Error: tried to deserialize variant 3 but there were only 3 types.\n");
+  }
+
+  // std::variant uses the same format
+  {
+    using StdMessage = std::variant<Create, Move, Quit>;
+    std::vector<StdMessage> std_queue{Move{1, 2}, Create{42, -10, -10}};
+    std::stringbuf buf1, buf2;
+    traverse::BinarySerialize serialize1(buf1), serialize2(buf2);
+    visit(serialize1, queue);
+    visit(serialize2, std_queue);
+    TEST_EQ(buf1.str(), buf2.str());
+
+    MessageQueue another_queue;
+    traverse::BinaryDeserialize deserialize(buf2);
+    visit(deserialize, another_queue);
+    TEST_EQ(deserialize.Errors(), "");
+    TEST_EQ(another_queue.size(), 2u);
+    TEST_EQ(another_queue[0].is<Move>(), true);
+    TEST_EQ(another_queue[1].get<Create>().id, 42);
   }
 }
 
@@ -7,6 +7,7 @@
 
 #include "traverse.h"
 #include <iostream>
+#include <sstream>
 
 // Helper function for the unit tests. It's verbose.
 
@@ -47,6 +48,53 @@ struct Polygon {
 };
 TRAVERSE_STRUCT(Polygon, FIELD(color) FIELD(mood) FIELD(charred) FIELD(name) FIELD(points))
 
+// Shapes that are kept in Versioned, for caching
+struct Scene {
+  std::string name;
+  std::vector<traverse::Versioned<Polygon>> shapes;
+};
+TRAVERSE_STRUCT(Scene, FIELD(name) FIELD(shapes))
+
+
+// Helpers for comparing values in the tests
+
+// The text that CoutWriter writes
+template<typename T>
+std::string to_string(const T& obj) {
+  std::stringstream out;
+  traverse::CoutWriter writer(out);
+  visit(writer, obj);
+  return out.str();
+}
+
+// The bytes that BinarySerialize writes
+template<typename T>
+std::string streambuf_bytes(const T& obj) {
+  std::stringbuf buf;
+  traverse::BinarySerialize serialize(buf);
+  visit(serialize, obj);
+  return buf.str();
+}
+
+// A blue, sad polygon; the tests only vary the name and points
+inline Polygon make_polygon(const std::string& name, std::vector<Point> points) {
+  return Polygon{BLUE, Mood::SAD, Charred::START, name, std::move(points)};
+}
+
+// The same, with the points point(0), point(1), ... point(count - 1)
+template<typename PointFunction>
+Polygon make_polygon(const std::string& name, int count, PointFunction point) {
+  std::vector<Point> points;
+  for (int j = 0; j < count; j++) {
+    points.push_back(point(j));
+  }
+  return make_polygon(name, std::move(points));
+}
+
+// "message i", with count points, as the batch tests write
+inline Polygon make_message_polygon(int i, int count) {
+  return make_polygon("message " + std::to_string(i), count, [i](int j) { return Point{i, -j}; });
+}
 
 
 #endif
@@ -0,0 +1,233 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+/**
+ * Framing for many messages in one stream or packet, so that the
+ * receiver can find each message without decoding the ones before it.
+ * Each message (record) is in the BinarySerialize format.
+ *
+ * There are two framings:
+ *
+ * RECORDS: each record is its size in bytes, as a variable length
+ * integer, followed by the record. RecordWriter writes this as it
+ * goes, so it's good for a stream with no end.
+ *
+ * INDEXED: a header with the number of records and the size of each
+ * record, followed by the records with no size in front of them.
+ * BatchWriter holds on to the records until Finish() so that it can
+ * write the header first. The receiver knows where every record is
+ * as soon as it has read the header.
+ *
+ * Example usage for C++ to bytes:
+ *
+ *     std::stringbuf buf;
+ *     traverse::BatchWriter writer(buf);
+ *     for (auto& message : messages) { writer.add(message); }
+ *     writer.Finish(); // or let writer go out of scope
+ *
+ * Example usage for bytes to C++:
+ *
+ *     traverse::BatchReader reader(data, size); // or (data, size, traverse::BatchFormat::RECORDS)
+ *     if (!reader.Errors().empty()) { throw "bad framing"; }
+ *     for (size_t i = 0; i < reader.size(); ++i) {
+ *       if (!interesting(i)) continue; // skipped, not decoded
+ *       Message message;
+ *       if (!reader.read(i, message)) { throw reader.Errors(); }
+ *     }
+ */
+
+#ifndef TRAVERSE_BATCH_H
+#define TRAVERSE_BATCH_H
+
+#include "traverse.h"
+#include "traverse-buffer.h"
+
+namespace traverse {
+
+  enum class BatchFormat { RECORDS, INDEXED };
+
+  /** The RecordWriter writes each record with its size in front. It
+   *  visits each record twice, once with SizeCounter to get the size
+   *  and once with BinarySerialize to write it.
+   */
+  struct RecordWriter {
+    std::streambuf& out;
+    RecordWriter(std::streambuf& out_): out(out_) {}
+
+    template<typename T>
+    void add(const T& obj) {
+      SizeCounter counter;
+      visit(counter, obj);
+      write_unsigned_int(out, counter.size);
+      BinarySerialize writer(out);
+      visit(writer, obj);
+    }
+  };
+
+  /** The BatchWriter collects records, and Finish() writes them to
+   *  the streambuf as one INDEXED batch. After Finish() it's empty
+   *  and can be used for the next batch. The destructor finishes a
+   *  batch that has any records in it.
+   */
+  struct BatchWriter {
+    std::streambuf& out;
+    std::vector<uint8_t> records;
+    BufferSerialize writer{records};
+    std::vector<uint64_t> sizes;
+
+    BatchWriter(std::streambuf& out_): out(out_) {}
+    BatchWriter(const BatchWriter&) = delete;
+    BatchWriter& operator = (const BatchWriter&) = delete;
+    ~BatchWriter() { if (!sizes.empty()) { Finish(); } }
+
+    size_t size() const { return sizes.size(); }
+
+    template<typename T>
+    void add(const T& obj) {
+      size_t before = writer.size();
+      visit(writer, obj);
+      sizes.push_back(writer.size() - before);
+    }
+
+    void Finish() {
+      write_unsigned_int(out, sizes.size());
+      for (uint64_t size : sizes) {
+        write_unsigned_int(out, size);
+      }
+      out.sputn(reinterpret_cast<const char*>(writer.start), std::streamsize(writer.size()));
+      // Keep the memory for the next batch
+      writer.pos = writer.start;
+      sizes.clear();
+    }
+  };
+
+
+  /** The BatchReader finds the records in a block of memory, in
+   *  either format, without decoding them. The memory must stay
+   *  alive while the reader is in use. Framing problems (a size that
+   *  goes past the end of the input) are reported in Errors() by the
+   *  constructor; the records before the problem can still be read.
+   *
+   *  read(i, obj) decodes record i with a BufferDeserialize, using
+   *  the max_elements, max_bytes, update_in_place, fail_fast,
+   *  columnar and resource set on the BatchReader. It returns false, and adds to Errors(), if
+   *  the record had errors or had bytes left over.
+   */
+  struct BatchReader {
+    std::vector<std::span<const uint8_t>> records;
+    size_t used_bytes = 0;
+    ErrorLog errors;
+    uint64_t max_elements = 0;
+    uint64_t max_bytes = 0;
+    bool update_in_place = false;
+    bool fail_fast = false;
+    bool columnar = false;
+    std::pmr::memory_resource* resource = nullptr;
+
+    BatchReader(const uint8_t* data, size_t size, BatchFormat format = BatchFormat::INDEXED) {
+      if (format == BatchFormat::INDEXED) {
+        ReadIndex(data, data + size);
+      } else {
+        ScanRecords(data, data + size);
+      }
+    }
+    BatchReader(const std::vector<uint8_t>& data, BatchFormat format = BatchFormat::INDEXED)
+      : BatchReader(data.data(), data.size(), format) {}
+
+    std::string Errors() { return errors.str(); }
+
+    size_t size() const { return records.size(); }
+
+    // Bytes used by the batch; any input after that is not part of it
+    size_t used() const { return used_bytes; }
+
+    std::span<const uint8_t> record(size_t i) const { return records[i]; }
+
+    template<typename T>
+    bool read(size_t i, T& obj) {
+      if (i >= size()) {
+        errors.error(ErrorCode::BAD_VALUE) << "Error: record " << i << " not in batch of " << size() << " records\n";
+        return false;
+      }
+      ErrorLog record_errors = decode(i, obj);
+      if (!record_errors.empty()) {
+        errors.append(record_errors, "Record " + std::to_string(i) + ": ");
+        return false;
+      }
+      return true;
+    }
+
+    // Same as read() but returns the errors instead of keeping them,
+    // so that several threads can decode records at the same time.
+    // The error offset is from the start of the record.
+    template<typename T>
+    ErrorLog decode(size_t i, T& obj) const {
+      BufferDeserialize reader(records[i].data(), records[i].size());
+      reader.max_elements = max_elements;
+      reader.max_bytes = max_bytes;
+      reader.update_in_place = update_in_place;
+      reader.fail_fast = fail_fast;
+      reader.columnar = columnar;
+      reader.resource = resource;
+      visit(reader, obj);
+      if (reader.errors.empty() && reader.remaining() != 0) {
+        fail(reader, ErrorCode::BAD_FRAMING) << "Error: " << reader.remaining() << " bytes left over\n";
+      }
+      return std::move(reader.errors);
+    }
+
+  private:
+    void ReadIndex(const uint8_t* start, const uint8_t* end) {
+      const uint8_t* pos = start;
+      uint64_t count = 0;
+      pos = read_unsigned_int(pos, end, count);
+      if (!pos) {
+        errors.error(ErrorCode::BAD_FRAMING) << "Error: batch header is incomplete\n";
+        return;
+      }
+      // Every size takes at least one byte, so this limits what a
+      // corrupt count can allocate
+      if (count > uint64_t(end - pos)) {
+        errors.error(ErrorCode::BAD_FRAMING) << "Error: batch claims " << count << " records but has only "
+               << (end - pos) << " bytes\n";
+        return;
+      }
+      std::vector<uint64_t> sizes(count);
+      if (decode_varints(pos, end, sizes.data(), sizes.size()) != count) {
+        errors.error(ErrorCode::BAD_FRAMING) << "Error: batch header is incomplete\n";
+        return;
+      }
+      records.reserve(count);
+      for (uint64_t i = 0; i < count; ++i) {
+        if (sizes[i] > uint64_t(end - pos)) {
+          errors.error(ErrorCode::BAD_FRAMING, pos - start) << "Error: record " << i << " of size " << sizes[i]
+                 << " goes past the end of the batch\n";
+          break;
+        }
+        records.emplace_back(pos, sizes[i]);
+        pos += sizes[i];
+      }
+      used_bytes = pos - start;
+    }
+
+    void ScanRecords(const uint8_t* start, const uint8_t* end) {
+      const uint8_t* pos = start;
+      while (pos != end) {
+        uint64_t size = 0;
+        const uint8_t* next = read_unsigned_int(pos, end, size);
+        if (!next || size > uint64_t(end - next)) {
+          errors.error(ErrorCode::BAD_FRAMING, pos - start) << "Error: record " << records.size()
+                 << " goes past the end of the input\n";
+          break;
+        }
+        records.emplace_back(next, size);
+        pos = next + size;
+      }
+      used_bytes = pos - start;
+    }
+  };
+}
+
+
+#endif
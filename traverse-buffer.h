@@ -0,0 +1,1023 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+/**
+ * Binary serialization to and from a contiguous block of memory.
+ *
+ * BufferSerialize and BufferDeserialize use the same format as
+ * BinarySerialize and BinaryDeserialize in traverse.h, so either
+ * side can be swapped for the other. The streambuf versions make a
+ * virtual call per byte; these versions check bounds once per value
+ * and then read or write memory directly.
+ *
+ * Example usage for C++ to bytes:
+ *
+ *     std::vector<uint8_t> bytes;
+ *     traverse::BufferSerialize writer(bytes);
+ *     visit(writer, yourobject);
+ *     writer.Finish(); // or let writer go out of scope
+ *     // bytes contains the serialized data
+ *
+ * Example usage for bytes to C++:
+ *
+ *     traverse::BufferDeserialize reader(bytes.data(), bytes.size());
+ *     visit(reader, yourobject);
+ *     if (!reader.Errors().empty()) { throw "read error"; }
+ *     if (reader.remaining() != 0) { throw "not all bytes processed"; }
+ */
+
+#ifndef TRAVERSE_BUFFER_H
+#define TRAVERSE_BUFFER_H
+
+#include "traverse.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+/* Variable length integers, same encoding as in traverse.h, but
+ * reading from and writing to memory. The caller is responsible for
+ * making sure there is room for max_varint_size bytes when writing.
+ */
+
+namespace traverse {
+
+  const size_t max_varint_size = 10;
+
+  inline uint8_t* write_unsigned_int(uint8_t* out, uint64_t value) {
+    while (value >= 0x80) {
+      *out++ = uint8_t(value) | 0x80;
+      value >>= 7;
+    }
+    *out++ = uint8_t(value);
+    return out;
+  }
+
+  inline uint8_t* write_signed_int(uint8_t* out, int64_t value) {
+    return write_unsigned_int(out,
+                              (value < 0)
+                              ? ((uint64_t(-(value+1)) << 1) | 1)
+                              : (value << 1));
+  }
+
+  /* Returns a pointer just past the number, or nullptr if the input
+   * ends before the number does. Encodings longer than 64 bits are
+   * consumed but the extra bits are dropped.
+   */
+  inline const uint8_t* read_unsigned_int(const uint8_t* in, const uint8_t* end, uint64_t& value) {
+    uint64_t result = 0;
+    int byte = 0;
+    if (end - in >= ptrdiff_t(max_varint_size)) {
+      // Fast path: the longest valid encoding fits, so no bounds checks
+      for (; byte < int(max_varint_size); ++byte) {
+        uint8_t c = *in++;
+        result |= uint64_t(c & 0x7f) << (byte * 7);
+        if ((c & 0x80) == 0) {
+          value = result;
+          return in;
+        }
+      }
+      // Over-long encoding; skip the rest of it below
+    }
+    for (; ; ++byte) {
+      if (in == end) {
+        return nullptr;
+      }
+      uint8_t c = *in++;
+      if (byte * 7 < 64) {
+        result |= uint64_t(c & 0x7f) << (byte * 7);
+      }
+      if ((c & 0x80) == 0) {
+        break;
+      }
+    }
+    value = result;
+    return in;
+  }
+
+  /* Reads up to count numbers into out[], and returns how many were
+   * read. The input pointer is moved past them. If the input ends in
+   * the middle of a number, the return value is less than count, and
+   * the input pointer is left at the start of the incomplete number.
+   *
+   * When compiled with BMI2 (-mbmi2 or -march=native on most x86-64),
+   * this loads 8 bytes at a time and decodes every number that ends
+   * in those 8 bytes: the continue bits show where each number ends,
+   * and pext packs the 7-bit groups together. The next load only
+   * depends on where the last number ended, not on decoding each
+   * number. (Some older AMD processors have a slow pext, so BMI2 is
+   * not detected at run time.) Otherwise it decodes one byte at a
+   * time, which is usually as fast as any portable bit trick.
+   */
+  inline size_t decode_varints(const uint8_t*& in, const uint8_t* end,
+                               uint64_t* out, size_t count) {
+    size_t i = 0;
+    const uint8_t* p = in;
+#if defined(__BMI2__)
+    while (count - i >= 8 && end - p >= 8) {
+      uint64_t word;
+      std::memcpy(&word, p, sizeof(word));
+      if constexpr (std::endian::native == std::endian::big) {
+        word = __builtin_bswap64(word);
+      }
+      uint64_t stops = ~word & 0x8080808080808080ull;
+      if (stops == 0) {
+        // This number is 2^56 or larger, and doesn't fit in 8 bytes
+        const uint8_t* next = read_unsigned_int(p, end, out[i]);
+        if (!next) { break; }
+        p = next;
+        ++i;
+        continue;
+      }
+      p += (64 - std::countl_zero(stops)) / 8;
+      uint64_t done = 0;
+      do {
+        // All the bits up to and including this number's stop bit
+        uint64_t upto = stops ^ (stops - 1);
+        out[i++] = _pext_u64(word, upto & ~done & 0x7f7f7f7f7f7f7f7full);
+        done = upto;
+        stops &= stops - 1;
+      } while (stops);
+    }
+#endif
+    for (; i < count; ++i) {
+      const uint8_t* next = read_unsigned_int(p, end, out[i]);
+      if (!next) { break; }
+      p = next;
+    }
+    in = p;
+    return i;
+  }
+
+  inline const uint8_t* read_signed_int(const uint8_t* in, const uint8_t* end, int64_t& value) {
+    uint64_t decoded = 0;
+    in = read_unsigned_int(in, end, decoded);
+    if (decoded & 1) {
+      value = -int64_t(decoded >> 1)-1;
+    } else {
+      value = decoded >> 1;
+    }
+    return in;
+  }
+
+}
+
+
+namespace traverse {
+
+  /** The BufferSerialize writes to a std::vector<uint8_t>, growing
+   *  it as needed, or to a fixed block of memory supplied by the
+   *  caller. With a std::vector, bytes are appended to whatever is
+   *  already there, and the vector has its final size after Finish()
+   *  or when the writer is destroyed. With a fixed block, writing
+   *  stops when the block is full, and overflow is set to true.
+   *
+   *  With columnar set, vectors of structs are written a field at a
+   *  time instead of an element at a time; see write_columns(). The
+   *  reader has to have columnar set too.
+   */
+  struct BufferSerialize {
+    std::vector<uint8_t>* vector;
+    uint8_t* start;
+    uint8_t* pos;
+    uint8_t* end;
+    bool overflow = false;
+    bool columnar = false;
+    SerializationCache* cache = nullptr;
+
+    BufferSerialize(std::vector<uint8_t>& out)
+      : vector(&out) {
+      size_t used = out.size();
+      out.resize(std::max(out.capacity(), used + 64));
+      start = out.data();
+      pos = start + used;
+      end = start + out.size();
+    }
+
+    BufferSerialize(uint8_t* data, size_t size)
+      : vector(nullptr), start(data), pos(data), end(data + size) {}
+
+    BufferSerialize(const BufferSerialize&) = delete;
+    BufferSerialize& operator = (const BufferSerialize&) = delete;
+
+    ~BufferSerialize() { Finish(); }
+
+    size_t size() const { return pos - start; }
+
+    void Finish() {
+      if (vector) { vector->resize(size()); end = pos; }
+    }
+
+    // Returns where to write the next n bytes, or nullptr if there's no room
+    uint8_t* Reserve(size_t n) {
+      if (size_t(end - pos) >= n) { return pos; }
+      return Grow(n);
+    }
+
+    uint8_t* Grow(size_t n) {
+      if (!vector) {
+        overflow = true;
+        end = pos;
+        return nullptr;
+      }
+      size_t used = size();
+      vector->resize(std::max(vector->size() * 2, used + n));
+      start = vector->data();
+      pos = start + used;
+      end = start + vector->size();
+      return pos;
+    }
+  };
+
+  inline uint64_t output_offset(BufferSerialize& writer) {
+    return writer.size();
+  }
+
+  template<typename Element, typename Allocator>
+  void write_columns(BufferSerialize& writer, const std::vector<Element, Allocator>& vector);
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T> && !std::is_signed_v<T>>
+  visit(BufferSerialize& writer, const T& value) {
+    if (uint8_t* p = writer.Reserve(max_varint_size)) {
+      writer.pos = write_unsigned_int(p, uint64_t(value));
+    }
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T> && std::is_signed_v<T>>
+  visit(BufferSerialize& writer, const T& value) {
+    if (uint8_t* p = writer.Reserve(max_varint_size)) {
+      writer.pos = write_signed_int(p, value);
+    }
+  }
+
+  // Always treat char as unsigned
+  inline void visit(BufferSerialize& writer, const char& value) {
+    visit(writer, static_cast<unsigned char>(value));
+  }
+  inline void visit(BufferSerialize& writer, const signed char& value) {
+    visit(writer, static_cast<unsigned char>(value));
+  }
+
+  template <typename T>
+  inline std::enable_if_t<std::is_enum_v<T>>
+  visit(BufferSerialize& writer, const T& value) {
+    visit(writer, std::underlying_type_t<T>(value));
+  }
+
+  inline void visit(BufferSerialize& writer, const std::string_view& string) {
+    size_t size = string.size();
+    if (uint8_t* p = writer.Reserve(max_varint_size + size)) {
+      p = write_unsigned_int(p, size);
+      std::memcpy(p, string.data(), size);
+      writer.pos = p + size;
+    }
+  }
+
+  template<typename Allocator>
+  void visit(BufferSerialize& writer, const std::basic_string<char, std::char_traits<char>, Allocator>& string) {
+    visit(writer, std::string_view(string));
+  }
+
+  template<typename Element, typename Allocator>
+  void visit(BufferSerialize& writer, const std::vector<Element, Allocator>& vector) {
+    if constexpr (has_struct_fields_v<Element>) {
+      if (writer.columnar) {
+        write_columns(writer, vector);
+        return;
+      }
+    }
+    uint64_t size = vector.size();
+    visit(writer, size);
+    for (auto& element : vector) {
+      visit(writer, element);
+    }
+  }
+
+  template<typename Element>
+  void visit(BufferSerialize& writer, const std::span<Element>& span) {
+    uint64_t size = span.size();
+    visit(writer, size);
+    for (auto& element : span) {
+      visit(writer, element);
+    }
+  }
+
+  template<typename T>
+  void visit(BufferSerialize& writer, const std::optional<T>& value) {
+    visit(writer, value.has_value());
+    if (value) { visit(writer, *value); }
+  }
+
+  template<typename T>
+  void visit(BufferSerialize& writer, const std::unique_ptr<T>& pointer) {
+    visit(writer, pointer != nullptr);
+    if (pointer) { visit(writer, *pointer); }
+  }
+
+  template<typename Element, size_t N>
+  void visit(BufferSerialize& writer, const std::array<Element, N>& array) {
+    for (const auto& element : array) {
+      visit(writer, element);
+    }
+  }
+
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map>>
+  visit(BufferSerialize& writer, const Map& map) {
+    visit(writer, uint64_t(map.size()));
+    for (const auto& [key, value] : map) {
+      visit(writer, key);
+      visit(writer, value);
+    }
+  }
+
+  template<typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType>>
+  visit(BufferSerialize& writer, VariantType& value) {
+    using Traits = VariantTraits<std::remove_const_t<VariantType>>;
+    visit(writer, uint64_t(Traits::index(value)));
+    Traits::apply([&](const auto& alternative) { visit(writer, alternative); }, value);
+  }
+
+  // With a cache, a Versioned value is encoded once per version; the
+  // first time, it's encoded in place and then copied into the cache
+  template<typename T>
+  void visit(BufferSerialize& writer, const Versioned<T>& versioned) {
+    if (writer.cache == nullptr) {
+      visit(writer, versioned.get());
+      return;
+    }
+    // Columnar vectors inside the value are laid out differently
+    SerializationCache::Format format = writer.columnar ? SerializationCache::BINARY_COLUMNAR : SerializationCache::BINARY;
+    const std::string* fragment = writer.cache->find(versioned.version(), format);
+    if (fragment == nullptr) {
+      size_t before = writer.size();
+      visit(writer, versioned.get());
+      if (!writer.overflow) {
+        writer.cache->insert(versioned.version(), format,
+                             std::string(reinterpret_cast<const char*>(writer.start) + before, writer.size() - before));
+      }
+      return;
+    }
+    if (uint8_t* p = writer.Reserve(fragment->size())) {
+      std::memcpy(p, fragment->data(), fragment->size());
+      writer.pos = p + fragment->size();
+    }
+  }
+
+
+  /* Serialize into a new vector with one allocation, by counting the
+   * size first. The bytes are the same as from BinarySerialize.
+   *
+   * BufferSerialize checks for room for the largest possible number
+   * or string size, so writing into a fixed block needs
+   * max_varint_size bytes more than the SizeCounter's count. The
+   * vector is shrunk afterwards, which doesn't reallocate.
+   */
+  template<typename T>
+  std::vector<uint8_t> serialize_to_vector(const T& obj) {
+    SizeCounter counter;
+    visit(counter, obj);
+    std::vector<uint8_t> bytes(counter.size + max_varint_size);
+    BufferSerialize writer(bytes.data(), bytes.size());
+    visit(writer, obj);
+    bytes.resize(writer.size());
+    return bytes;
+  }
+
+  /** The BufferDeserialize reads from a block of memory, which must
+   *  stay alive while the reader is in use. Check reader.Errors() to
+   *  see if anything went wrong. It will be empty on success.
+   *
+   *  max_elements, max_bytes, update_in_place, fail_fast and resource
+   *  work the same way as in BinaryDeserialize. There's no reserve_limit, because the
+   *  reader knows how much input there is. Set columnar to read what
+   *  a BufferSerialize with columnar set wrote.
+   */
+  struct BufferDeserialize {
+    const uint8_t* start;
+    const uint8_t* pos;
+    const uint8_t* end;
+    ErrorLog errors;
+    uint64_t max_elements = 0;
+    uint64_t max_bytes = 0;
+    uint64_t bytes_used = 0;
+    bool update_in_place = false;
+    bool fail_fast = false;
+    bool columnar = false;
+    std::pmr::memory_resource* resource = nullptr;
+    BufferDeserialize(const uint8_t* data, size_t size): start(data), pos(data), end(data + size) {}
+    BufferDeserialize(const std::vector<uint8_t>& data): BufferDeserialize(data.data(), data.size()) {}
+    std::string Errors() { return errors.str(); }
+    size_t remaining() const { return end - pos; }
+  };
+
+  inline uint64_t input_offset(BufferDeserialize& reader) {
+    return reader.pos - reader.start;
+  }
+
+  template<typename Element, typename Allocator>
+  void read_columns(BufferDeserialize& reader, std::vector<Element, Allocator>& vector);
+
+  inline bool read_unsigned_int(BufferDeserialize& reader, uint64_t& value) {
+    const uint8_t* next = read_unsigned_int(reader.pos, reader.end, value);
+    reader.pos = next ? next : reader.end;
+    return next != nullptr;
+  }
+
+  inline bool at_end(BufferDeserialize& reader) {
+    return reader.pos == reader.end;
+  }
+
+  // Each element takes at least one byte, so the remaining input
+  // limits how much to reserve for an untrusted size
+  inline uint64_t reserve_size(BufferDeserialize& reader, uint64_t size) {
+    return std::min(size, uint64_t(reader.remaining()));
+  }
+
+  inline bool read_signed_int(BufferDeserialize& reader, int64_t& value) {
+    const uint8_t* next = read_signed_int(reader.pos, reader.end, value);
+    reader.pos = next ? next : reader.end;
+    return next != nullptr;
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T> && !std::is_signed_v<T>>
+  visit(BufferDeserialize& reader, T& value) {
+    if (stopped(reader)) { return; }
+    uint64_t wide_value = 0;
+    if (!read_unsigned_int(reader, wide_value)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read number\n";
+    }
+    value = static_cast<T>(wide_value);
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T> && std::is_signed_v<T>>
+  visit(BufferDeserialize& reader, T& value) {
+    if (stopped(reader)) { return; }
+    int64_t wide_value = 0;
+    if (!read_signed_int(reader, wide_value)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read number\n";
+    }
+    value = static_cast<T>(wide_value);
+  }
+
+  // Always treat char as unsigned
+  inline void visit(BufferDeserialize& reader, char& value) {
+    if (stopped(reader)) { return; }
+    unsigned char u;
+    visit(reader, u);
+    value = static_cast<char>(u);
+  }
+  inline void visit(BufferDeserialize& reader, signed char& value) {
+    if (stopped(reader)) { return; }
+    unsigned char u;
+    visit(reader, u);
+    value = static_cast<signed char>(u);
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_enum_v<T>>
+  visit(BufferDeserialize& reader, T& value) {
+    if (stopped(reader)) { return; }
+    std::underlying_type_t<T> v;
+    visit(reader, v);
+    value = static_cast<T>(v);
+  }
+
+  // Read a size and that many bytes, returning false if there's no size
+  inline bool read_string_view(BufferDeserialize& reader, std::string_view& string) {
+    if (stopped(reader)) { return false; }
+    uint64_t size = 0;
+    if (!read_unsigned_int(reader, size)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read string size\n";
+      return false;
+    }
+
+    // Unlike the streambuf version, we know how much input there is,
+    // so the untrusted size can be checked before allocating
+    if (size > reader.remaining()) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: expected " << size
+                    << " bytes in string but only found "
+                    << reader.remaining() << "\n";
+      string = std::string_view(reinterpret_cast<const char*>(reader.pos), reader.remaining());
+      reader.pos = reader.end;
+      return true;
+    }
+    string = std::string_view(reinterpret_cast<const char*>(reader.pos), size);
+    reader.pos += size;
+    return true;
+  }
+
+  template<typename Allocator>
+  void visit(BufferDeserialize& reader, std::basic_string<char, std::char_traits<char>, Allocator>& string) {
+    std::string_view view;
+    if (read_string_view(reader, view)) {
+      use_resource(string, reader.resource);
+      if (check_bytes_limit(reader, view.size(), 1, "string")) {
+        string.assign(view);
+      } else {
+        string.clear();
+      }
+    }
+  }
+
+  /* A string_view points into the reader's buffer, so it's only
+   * valid as long as the buffer is. */
+  inline void visit(BufferDeserialize& reader, std::string_view& string) {
+    read_string_view(reader, string);
+  }
+
+  // A number from decode_varints() as the element type of a vector
+  template<typename Element>
+  Element integer_from_varint(uint64_t bits) {
+    if constexpr (std::is_signed_v<Element>
+                  && !std::is_same_v<Element, char>
+                  && !std::is_same_v<Element, signed char>) {
+      return static_cast<Element>(int64_t(bits >> 1) ^ -int64_t(bits & 1));
+    } else {
+      return static_cast<Element>(bits);
+    }
+  }
+
+  /* Vectors of integers are decoded in blocks with decode_varints(),
+   * straight into the vector's storage, with the same results as
+   * visiting each element. Returns the number of elements read.
+   */
+  template<typename Element, typename Allocator>
+  uint64_t read_integers(BufferDeserialize& reader, std::vector<Element, Allocator>& vector, uint64_t size) {
+    const size_t blocksize = 256;
+    uint64_t block[blocksize];
+    // Each number takes at least one byte
+    vector.resize(size_t(std::min(size, uint64_t(reader.remaining()))));
+    Element* out = vector.data();
+    uint64_t i = 0;
+    while (i < size && reader.pos != reader.end) {
+      size_t wanted = size_t(std::min(size - i, uint64_t(blocksize)));
+      size_t found = decode_varints(reader.pos, reader.end, block, wanted);
+      for (size_t j = 0; j < found; ++j) {
+        out[i + j] = integer_from_varint<Element>(block[j]);
+      }
+      i += found;
+      if (found < wanted) {
+        // Same as what visit() does on an incomplete number
+        if (reader.pos != reader.end) {
+          fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read number\n";
+          reader.pos = reader.end;
+          out[i++] = Element();
+        }
+        break;
+      }
+    }
+    vector.resize(i);
+    return i;
+  }
+
+  template<typename Element, typename Allocator>
+  void visit(BufferDeserialize& reader, std::vector<Element, Allocator>& vector) {
+    if (stopped(reader)) { return; }
+    if constexpr (has_struct_fields_v<Element>) {
+      if (reader.columnar) {
+        read_columns(reader, vector);
+        return;
+      }
+    }
+    uint64_t i = 0, size = 0;
+    if (!read_unsigned_int(reader, size)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read vector size\n";
+      return;
+    }
+    use_resource(vector, reader.resource);
+    if (!reader.update_in_place) {
+      vector.clear();
+    }
+    if (!check_vector_limits(reader, size, sizeof(Element))) {
+      vector.clear();
+      return;
+    }
+    if constexpr (std::is_integral_v<Element>) {
+      i = read_integers(reader, vector, size);
+    } else {
+      // The size is untrusted, but each element takes at least one
+      // byte, so the remaining input limits how much to reserve
+      vector.reserve(std::min(size, uint64_t(reader.remaining())));
+      for (; i < size && reader.pos != reader.end; ++i) {
+        if (i == vector.size()) {
+          vector.emplace_back();
+        }
+        visit(reader, vector[i]);
+        if (stopped(reader)) { ++i; break; }
+      }
+      vector.erase(vector.begin() + i, vector.end());
+    }
+    if (i != size && !stopped(reader)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: expected " << size
+                    << " elements in vector but only found "
+                    << i << "\n";
+    }
+  }
+
+  template<typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType> && !std::is_const_v<VariantType>>
+  visit(BufferDeserialize& reader, VariantType& value) {
+    read_variant(reader, value);
+  }
+
+  template<typename T>
+  void visit(BufferDeserialize& reader, std::optional<T>& value) {
+    read_optional(reader, value);
+  }
+
+  template<typename T>
+  void visit(BufferDeserialize& reader, std::unique_ptr<T>& pointer) {
+    read_pointer(reader, pointer);
+  }
+
+  template<typename Element, size_t N>
+  void visit(BufferDeserialize& reader, std::array<Element, N>& array) {
+    for (auto& element : array) {
+      visit(reader, element);
+    }
+  }
+
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map> && !std::is_const_v<Map>>
+  visit(BufferDeserialize& reader, Map& map) {
+    read_map(reader, map);
+  }
+
+
+  /* Structs that only hold numbers (see fixed_encoding() in
+   * traverse.h) are written with one bounds check for the whole
+   * struct instead of one per field. The FixedWriter writes to memory
+   * that's known to have room, so its visit() functions have no
+   * checks, and the compiler can turn the fields into straight line
+   * code. */
+  struct FixedWriter {
+    uint8_t* pos;
+  };
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T> && !std::is_signed_v<T>>
+  visit(FixedWriter& writer, const T& value) {
+    writer.pos = write_unsigned_int(writer.pos, uint64_t(value));
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T> && std::is_signed_v<T>>
+  visit(FixedWriter& writer, const T& value) {
+    writer.pos = write_signed_int(writer.pos, value);
+  }
+
+  inline void visit(FixedWriter& writer, const char& value) {
+    visit(writer, static_cast<unsigned char>(value));
+  }
+  inline void visit(FixedWriter& writer, const signed char& value) {
+    visit(writer, static_cast<unsigned char>(value));
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_enum_v<T>>
+  visit(FixedWriter& writer, const T& value) {
+    visit(writer, std::underlying_type_t<T>(value));
+  }
+
+  template<typename Element, size_t N>
+  void visit(FixedWriter& writer, const std::array<Element, N>& array) {
+    for (const auto& element : array) {
+      visit(writer, element);
+    }
+  }
+
+  template<typename T>
+  std::enable_if_t<(max_encoded_size_v<T> > 0), bool>
+  visit_fixed(BufferSerialize& writer, const T& obj) {
+    // Near the end of a fixed block, the struct may still fit when
+    // it's written a field at a time
+    if (!writer.vector && size_t(writer.end - writer.pos) < max_encoded_size_v<T>) { return false; }
+    if (uint8_t* p = writer.Reserve(max_encoded_size_v<T>)) {
+      FixedWriter fixed{p};
+      visit(fixed, obj);
+      writer.pos = fixed.pos;
+    }
+    return true;
+  }
+
+  /* The FixedReader reads a struct that only holds numbers when
+   * there's enough input for every number to take max_varint_size
+   * bytes, so it only has to check that each number ends within that
+   * many bytes. If one doesn't, ok is false, and the struct is read
+   * again the usual way to report the error. */
+  struct FixedReader {
+    const uint8_t* pos;
+    bool ok = true;
+  };
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T> && !std::is_signed_v<T>>
+  visit(FixedReader& reader, T& value) {
+    uint64_t wide_value = 0;
+    const uint8_t* next = read_unsigned_int(reader.pos, reader.pos + max_varint_size, wide_value);
+    reader.ok = reader.ok && next;
+    reader.pos = next ? next : reader.pos;
+    value = static_cast<T>(wide_value);
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T> && std::is_signed_v<T>>
+  visit(FixedReader& reader, T& value) {
+    int64_t wide_value = 0;
+    const uint8_t* next = read_signed_int(reader.pos, reader.pos + max_varint_size, wide_value);
+    reader.ok = reader.ok && next;
+    reader.pos = next ? next : reader.pos;
+    value = static_cast<T>(wide_value);
+  }
+
+  inline void visit(FixedReader& reader, char& value) {
+    unsigned char u;
+    visit(reader, u);
+    value = static_cast<char>(u);
+  }
+  inline void visit(FixedReader& reader, signed char& value) {
+    unsigned char u;
+    visit(reader, u);
+    value = static_cast<signed char>(u);
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_enum_v<T>>
+  visit(FixedReader& reader, T& value) {
+    std::underlying_type_t<T> v;
+    visit(reader, v);
+    value = static_cast<T>(v);
+  }
+
+  template<typename Element, size_t N>
+  void visit(FixedReader& reader, std::array<Element, N>& array) {
+    for (auto& element : array) {
+      visit(reader, element);
+    }
+  }
+
+  template<typename T>
+  std::enable_if_t<(max_encoded_size_v<T> > 0), bool>
+  visit_fixed(BufferDeserialize& reader, T& obj) {
+    if (reader.remaining() < fixed_encoding<T>().numbers * max_varint_size) { return false; }
+    if (stopped(reader)) { return true; }
+    FixedReader fixed{reader.pos};
+    visit(fixed, obj);
+    if (!fixed.ok) { return false; }
+    reader.pos = fixed.pos;
+    return true;
+  }
+
+
+  /* Columns: a vector of structs written one field at a time, so
+   * that the values of each field are next to each other. This is the
+   * vector's size followed by a column for each field, in the order
+   * of TRAVERSE_STRUCT:
+   *
+   * - a column of integers or enums is the difference from the
+   *   previous element (from 0 for the first), zigzag encoded, so
+   *   values that change slowly take one byte each
+   * - a column of structs is a column for each of their fields
+   * - any other column is each element's value in the usual format
+   *
+   * The fields are found at the same offset in every element, so they
+   * must be members of the struct, as they are with FIELD().
+   */
+  template<typename T>
+  constexpr bool is_delta_column_v = std::is_integral_v<T> || std::is_enum_v<T>;
+
+  template<typename T>
+  uint64_t column_bits(const T& value) {
+    if constexpr (std::is_enum_v<T>) {
+      return uint64_t(std::underlying_type_t<T>(value));
+    } else {
+      return uint64_t(value);
+    }
+  }
+
+  template<typename T>
+  T column_value(uint64_t bits) {
+    if constexpr (std::is_enum_v<T>) {
+      return static_cast<T>(column_value<std::underlying_type_t<T>>(bits));
+    } else if constexpr (std::is_same_v<T, bool>) {
+      return bits != 0;
+    } else {
+      return static_cast<T>(bits);
+    }
+  }
+
+  // The column of one field, in elements that are stride bytes apart
+  struct ColumnWriter {
+    BufferSerialize& writer;
+    const uint8_t* base;
+    size_t stride;
+    size_t count;
+  };
+
+  inline uint64_t output_offset(ColumnWriter& columns) {
+    return output_offset(columns.writer);
+  }
+
+  template<typename T>
+  void write_column(BufferSerialize& writer, const uint8_t* base, size_t stride, size_t count) {
+    if constexpr (has_struct_fields_v<T>) {
+      ColumnWriter columns{writer, base, stride, count};
+      visit(columns, *reinterpret_cast<const T*>(base));
+    } else if constexpr (is_delta_column_v<T>) {
+      uint64_t previous = 0;
+      for (size_t i = 0; i < count; ++i) {
+        uint64_t value = column_bits(*reinterpret_cast<const T*>(base + i * stride));
+        if (uint8_t* p = writer.Reserve(max_varint_size)) {
+          writer.pos = write_signed_int(p, int64_t(value - previous));
+        }
+        previous = value;
+      }
+    } else {
+      for (size_t i = 0; i < count; ++i) {
+        visit(writer, *reinterpret_cast<const T*>(base + i * stride));
+      }
+    }
+  }
+
+  template<>
+  struct StructVisitor<ColumnWriter> {
+    const char* name;
+    ColumnWriter& columns;
+
+    template<typename T>
+    StructVisitor& field(const char*, const T& value) {
+      size_t offset = reinterpret_cast<const uint8_t*>(&value) - columns.base;
+      write_column<T>(columns.writer, columns.base + offset, columns.stride, columns.count);
+      return *this;
+    }
+  };
+
+  /* Writes a vector of structs as columns. This is what a writer
+   * with columnar set does for every vector of structs. */
+  template<typename Element, typename Allocator>
+  void write_columns(BufferSerialize& writer, const std::vector<Element, Allocator>& vector) {
+    visit(writer, uint64_t(vector.size()));
+    if (!vector.empty()) {
+      write_column<Element>(writer, reinterpret_cast<const uint8_t*>(vector.data()), sizeof(Element), vector.size());
+    }
+  }
+
+  struct ColumnReader {
+    BufferDeserialize& reader;
+    uint8_t* base;
+    size_t stride;
+    size_t count;
+  };
+
+  inline uint64_t input_offset(ColumnReader& columns) {
+    return input_offset(columns.reader);
+  }
+
+  template<typename T>
+  void read_column(BufferDeserialize& reader, uint8_t* base, size_t stride, size_t count) {
+    if (stopped(reader)) { return; }
+    if constexpr (has_struct_fields_v<T>) {
+      ColumnReader columns{reader, base, stride, count};
+      visit(columns, *reinterpret_cast<T*>(base));
+    } else if constexpr (is_delta_column_v<T>) {
+      // Decoded in blocks, like vectors of integers
+      const size_t blocksize = 256;
+      uint64_t block[blocksize];
+      uint64_t previous = 0;
+      for (size_t i = 0; i < count; ) {
+        size_t wanted = std::min(count - i, blocksize);
+        size_t found = decode_varints(reader.pos, reader.end, block, wanted);
+        for (size_t j = 0; j < found; ++j) {
+          previous += uint64_t(int64_t(block[j] >> 1) ^ -int64_t(block[j] & 1));
+          *reinterpret_cast<T*>(base + (i + j) * stride) = column_value<T>(previous);
+        }
+        i += found;
+        if (found < wanted) {
+          fail(reader, ErrorCode::END_OF_INPUT) << "Error: expected " << count
+                        << " numbers in column but only found " << i << "\n";
+          reader.pos = reader.end;
+          return;
+        }
+      }
+    } else {
+      for (size_t i = 0; i < count; ++i) {
+        visit(reader, *reinterpret_cast<T*>(base + i * stride));
+        if (stopped(reader)) { return; }
+      }
+    }
+  }
+
+  template<>
+  struct StructVisitor<ColumnReader> {
+    const char* name;
+    ColumnReader& columns;
+
+    template<typename T>
+    StructVisitor& field(const char* label, T& value) {
+      if (stopped(columns.reader)) { return *this; }
+      size_t offset = reinterpret_cast<uint8_t*>(&value) - columns.base;
+      bool failed = columns.reader.errors.failed();
+      read_column<T>(columns.reader, columns.base + offset, columns.stride, columns.count);
+      columns.reader.errors.note_field(label, failed);
+      return *this;
+    }
+  };
+
+  // Reads the size of a vector that's written as columns
+  inline bool read_column_count(BufferDeserialize& reader, uint64_t& size, uint64_t element_size) {
+    if (!read_unsigned_int(reader, size)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read vector size\n";
+      return false;
+    }
+    if (!check_vector_limits(reader, size, element_size)) {
+      return false;
+    }
+    // Each element takes at least a byte in each column
+    if (size > reader.remaining()) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: expected " << size
+                    << " elements in columns but only " << reader.remaining() << " bytes left\n";
+      reader.pos = reader.end;
+      return false;
+    }
+    return true;
+  }
+
+  /* Reads a vector of structs that was written as columns. If the
+   * columns are incomplete, the vector is left empty. This is what a
+   * reader with columnar set does for every vector of structs. */
+  template<typename Element, typename Allocator>
+  void read_columns(BufferDeserialize& reader, std::vector<Element, Allocator>& vector) {
+    if (stopped(reader)) { return; }
+    use_resource(vector, reader.resource);
+    if (!reader.update_in_place) {
+      vector.clear();
+    }
+    uint64_t size = 0;
+    if (!read_column_count(reader, size, sizeof(Element))) {
+      vector.clear();
+      return;
+    }
+    vector.resize(size);
+    if (size == 0) { return; }
+    bool failed = reader.errors.failed();
+    read_column<Element>(reader, reinterpret_cast<uint8_t*>(vector.data()), sizeof(Element), size);
+    if (!failed && reader.errors.failed()) {
+      vector.clear();
+    }
+  }
+
+  /* Columns can also be read into a struct of vectors, one for each
+   * column, in the same order as the fields of the struct that was
+   * written. For example, a vector of Point {int x, y;} can be read
+   * into a PointColumns {std::vector<int> x, y;}. */
+  struct ColumnsReader {
+    BufferDeserialize& reader;
+    uint64_t count;
+  };
+
+  inline uint64_t input_offset(ColumnsReader& columns) {
+    return input_offset(columns.reader);
+  }
+
+  template<>
+  struct StructVisitor<ColumnsReader> {
+    const char* name;
+    ColumnsReader& columns;
+
+    template<typename T, typename Allocator>
+    StructVisitor& field(const char* label, std::vector<T, Allocator>& column) {
+      static_assert(!std::is_same_v<T, bool>, "std::vector<bool> can't be a column");
+      if (stopped(columns.reader)) { return *this; }
+      use_resource(column, columns.reader.resource);
+      column.clear();
+      column.resize(columns.count);
+      bool failed = columns.reader.errors.failed();
+      read_column<T>(columns.reader, reinterpret_cast<uint8_t*>(column.data()), sizeof(T), columns.count);
+      columns.reader.errors.note_field(label, failed);
+      return *this;
+    }
+  };
+
+  template<typename Columns>
+  std::enable_if_t<has_struct_fields_v<Columns>>
+  read_columns(BufferDeserialize& reader, Columns& columns) {
+    if (stopped(reader)) { return; }
+    uint64_t size = 0;
+    if (!read_column_count(reader, size, 1)) { return; }
+    ColumnsReader columns_reader{reader, size};
+    visit(columns_reader, columns);
+  }
+
+}
+
+
+#endif
@@ -0,0 +1,471 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+/**
+ * Compress the output of BinarySerialize, or any other streambuf
+ * writer, on the way out, and decompress the input of
+ * BinaryDeserialize on the way in, without a buffer for the whole
+ * message. The streambufs here collect a large block of output and
+ * compress it all at once, or decompress a block of input at a time.
+ * LZ4 (the frame format) is fast enough to use for messages; zstd
+ * compresses more, for archives. Each is available when its header
+ * is found, and needs its library, for example
+ * $(pkg-config --cflags --libs liblz4 libzstd).
+ *
+ * Example usage:
+ *
+ *     std::filebuf file;
+ *     file.open("world.bin.zst", std::ios::out | std::ios::binary);
+ *     traverse::ZstdCompressStreambuf compressed(file);
+ *     traverse::BinarySerialize writer(compressed);
+ *     visit(writer, world);
+ *     compressed.Finish(); // or let the destructor finish the frame
+ *     if (!compressed.Errors().empty()) { throw "write error"; }
+ *
+ *     traverse::ZstdDecompressStreambuf decompressed(file);
+ *     traverse::BinaryDeserialize reader(decompressed);
+ *     visit(reader, world);
+ *     if (!decompressed.Errors().empty() || !reader.Errors().empty()) { throw "read error"; }
+ *
+ * Input that isn't a valid frame stops the decompressed input, so the
+ * reader will also report that the input ended early; the reason is
+ * in the streambuf's Errors().
+ *
+ * Small messages don't have much in them for the compressor to find.
+ * With zstd, train a dictionary on a sample of messages with
+ * zstd_train_dictionary(), and give the same dictionary to the
+ * ZstdCompressor and ZstdDecompressor.
+ */
+
+#ifndef TRAVERSE_COMPRESS_H
+#define TRAVERSE_COMPRESS_H
+
+#include "traverse.h"
+#if __has_include(<lz4frame.h>)
+#include <lz4frame.h>
+#endif
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
+namespace traverse {
+
+  inline bool write_bytes(std::streambuf& out, const char* data, size_t size) {
+    return out.sputn(data, std::streamsize(size)) == std::streamsize(size);
+  }
+
+  /** The CompressStreambuf keeps what's written in a block, and
+   *  passes each full block to the Compressor, which writes the
+   *  compressed bytes to out. The Compressor has
+   *
+   *      bool write(const char* data, size_t size, std::streambuf& out);
+   *      bool flush(std::streambuf& out); // everything so far can be decompressed
+   *      bool end(std::streambuf& out);   // the end of the frame
+   *      const char* error;
+   *
+   *  The block starts small and grows up to block_size, so that a
+   *  small message doesn't pay for clearing a large block.
+   *
+   *  pubsync() flushes, so that the receiver can decompress what has
+   *  been written so far, at some cost in compression. Finish() ends
+   *  the frame; after that, nothing more can be written.
+   */
+  template<typename Compressor>
+  struct CompressStreambuf : std::streambuf {
+    static constexpr size_t default_block_size = 256 * 1024;
+    static constexpr size_t initial_block_size = 4096;
+
+    std::streambuf& out;
+    Compressor compressor;
+    std::vector<char> block;
+    size_t block_size;
+    uint64_t block_offset = 0;  // bytes written before the block
+    ErrorLog errors;
+    bool finished = false;
+
+    CompressStreambuf(std::streambuf& out_, Compressor compressor_ = Compressor(), size_t block_size_ = default_block_size)
+      : out(out_), compressor(std::move(compressor_)),
+        block(std::clamp(block_size_, size_t(1), initial_block_size)), block_size(std::max(block_size_, size_t(1))) {
+      setp(block.data(), block.data() + block.size());
+    }
+    CompressStreambuf(const CompressStreambuf&) = delete;
+    CompressStreambuf& operator = (const CompressStreambuf&) = delete;
+    ~CompressStreambuf() override { Finish(); }
+
+    std::string Errors() { return errors.str(); }
+
+    bool Finish() {
+      if (!finished) {
+        compress_block();
+        if (!errors.failed() && !compressor.end(out)) { fail(); }
+        finished = true;
+      }
+      return !errors.failed();
+    }
+
+  protected:
+    void fail() {
+      errors.error(ErrorCode::FILE_ERROR) << "Error: can't compress the output: " << compressor.error << "\n";
+    }
+
+    void compress_block() {
+      size_t size = pptr() - pbase();
+      if (size > 0 && !errors.failed() && !compressor.write(pbase(), size, out)) { fail(); }
+      block_offset += size;
+      setp(block.data(), block.data() + block.size());
+    }
+
+    int_type overflow(int_type c) override {
+      if (finished || errors.failed()) { return traits_type::eof(); }
+      if (block.size() < block_size) {
+        size_t used = pptr() - pbase();
+        block.resize(std::min(block.size() * 2, block_size));
+        setp(block.data(), block.data() + block.size());
+        pbump(int(used));
+      } else {
+        compress_block();
+        if (errors.failed()) { return traits_type::eof(); }
+      }
+      if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+      }
+      return traits_type::not_eof(c);
+    }
+
+    int sync() override {
+      if (finished) { return errors.failed() ? -1 : 0; }
+      compress_block();
+      if (!errors.failed() && !compressor.flush(out)) { fail(); }
+      if (out.pubsync() != 0) { return -1; }
+      return errors.failed() ? -1 : 0;
+    }
+
+    // Only the current position, which is the uncompressed size so far
+    pos_type seekoff(off_type offset, std::ios::seekdir dir, std::ios::openmode which) override {
+      if (offset != 0 || dir != std::ios::cur || !(which & std::ios::out)) { return pos_type(off_type(-1)); }
+      return pos_type(off_type(block_offset + (pptr() - pbase())));
+    }
+  };
+
+  /** The DecompressStreambuf reads compressed input from in, a
+   *  chunk at a time, and gives the Decompressor room for a block of
+   *  output. The Decompressor has
+   *
+   *      // Uses up to src_size bytes of src and writes up to
+   *      // dst_size bytes to dst, then sets them to what it used
+   *      bool decompress(const char* src, size_t& src_size, char* dst, size_t& dst_size, bool& frame_done);
+   *      const char* error;
+   *
+   *  Frames that follow each other in the input are read as one. As
+   *  with the CompressStreambuf, the block grows up to block_size.
+   */
+  template<typename Decompressor>
+  struct DecompressStreambuf : std::streambuf {
+    static constexpr size_t default_block_size = 256 * 1024;
+    static constexpr size_t initial_block_size = 4096;
+    static constexpr size_t input_chunk_size = 64 * 1024;
+
+    std::streambuf& in;
+    Decompressor decompressor;
+    std::vector<char> input;
+    std::vector<char> block;
+    size_t block_size;
+    size_t input_pos = 0;
+    size_t input_end = 0;
+    uint64_t compressed_used = 0;  // bytes of in that have been decompressed
+    uint64_t block_offset = 0;     // decompressed bytes before the block
+    bool in_frame = false;
+    bool input_done = false;
+    ErrorLog errors;
+
+    DecompressStreambuf(std::streambuf& in_, Decompressor decompressor_ = Decompressor(), size_t block_size_ = default_block_size)
+      : in(in_), decompressor(std::move(decompressor_)),
+        block(std::clamp(block_size_, size_t(1), initial_block_size)), block_size(std::max(block_size_, size_t(1))) {
+      setg(block.data(), block.data(), block.data());
+    }
+    DecompressStreambuf(const DecompressStreambuf&) = delete;
+    DecompressStreambuf& operator = (const DecompressStreambuf&) = delete;
+
+    std::string Errors() { return errors.str(); }
+
+  protected:
+    int_type underflow() override {
+      if (gptr() < egptr()) { return traits_type::to_int_type(*gptr()); }
+      block_offset += egptr() - eback();
+      setg(block.data(), block.data(), block.data());
+      while (!errors.failed()) {
+        if (input_pos == input_end) {
+          if (input_done) { break; }
+          if (input.size() < input_chunk_size) {
+            input.resize(input.empty() ? initial_block_size : std::min(input.size() * 2, input_chunk_size));
+          }
+          std::streamsize size = in.sgetn(input.data(), std::streamsize(input.size()));
+          if (size <= 0) {
+            input_done = true;
+            break;
+          }
+          input_pos = 0;
+          input_end = size_t(size);
+        }
+        size_t src_size = input_end - input_pos;
+        size_t dst_size = block.size();
+        bool frame_done = false;
+        if (!decompressor.decompress(input.data() + input_pos, src_size, block.data(), dst_size, frame_done)) {
+          errors.error(ErrorCode::BAD_FRAMING, compressed_used)
+            << "Error: compressed input is invalid at byte " << compressed_used << ": " << decompressor.error << "\n";
+          break;
+        }
+        input_pos += src_size;
+        compressed_used += src_size;
+        in_frame = !frame_done;
+        if (dst_size > 0) {
+          // There was more output than room, so use a larger block from now on
+          if (dst_size == block.size() && block.size() < block_size) {
+            block.resize(std::min(block.size() * 2, block_size));
+          }
+          setg(block.data(), block.data(), block.data() + dst_size);
+          return traits_type::to_int_type(*gptr());
+        }
+      }
+      if (input_done && in_frame && !errors.failed()) {
+        errors.error(ErrorCode::BAD_FRAMING, compressed_used)
+          << "Error: compressed input ended in the middle of a frame, after " << compressed_used << " bytes\n";
+      }
+      return traits_type::eof();
+    }
+
+    // Only the current position, which is the decompressed size so far
+    pos_type seekoff(off_type offset, std::ios::seekdir dir, std::ios::openmode which) override {
+      if (offset != 0 || dir != std::ios::cur || !(which & std::ios::in)) { return pos_type(off_type(-1)); }
+      return pos_type(off_type(block_offset + (gptr() - eback())));
+    }
+  };
+
+
+#if __has_include(<lz4frame.h>)
+  /** LZ4 frames. The compression level is 0 for the fastest; higher
+   *  levels, up to 12, use the slower LZ4 HC. Set preferences before
+   *  the first write for the other options of lz4frame.h.
+   */
+  struct Lz4Compressor {
+    struct Free { void operator () (LZ4F_cctx* context) const { LZ4F_freeCompressionContext(context); } };
+    std::unique_ptr<LZ4F_cctx, Free> context;
+    LZ4F_preferences_t preferences{};
+    std::vector<char> buffer;
+    bool started = false;
+    const char* error = nullptr;
+
+    explicit Lz4Compressor(int level = 0) {
+      LZ4F_cctx* created = nullptr;
+      if (!check(LZ4F_createCompressionContext(&created, LZ4F_VERSION))) { return; }
+      context.reset(created);
+      preferences.compressionLevel = level;
+      preferences.frameInfo.blockSizeID = LZ4F_max256KB;
+      // The CompressStreambuf already collects a block, so LZ4 doesn't have to
+      preferences.autoFlush = 1;
+    }
+
+    bool check(size_t result) {
+      if (LZ4F_isError(result)) {
+        error = LZ4F_getErrorName(result);
+        return false;
+      }
+      return true;
+    }
+
+    bool put(size_t result, std::streambuf& out) {
+      if (!check(result)) { return false; }
+      if (!write_bytes(out, buffer.data(), result)) {
+        error = "can't write the output";
+        return false;
+      }
+      return true;
+    }
+
+    bool begin(std::streambuf& out) {
+      if (error) { return false; }
+      if (started) { return true; }
+      started = true;
+      buffer.resize(std::max(size_t(LZ4F_HEADER_SIZE_MAX), LZ4F_compressBound(0, &preferences)));
+      return put(LZ4F_compressBegin(context.get(), buffer.data(), buffer.size(), &preferences), out);
+    }
+
+    bool write(const char* data, size_t size, std::streambuf& out) {
+      if (!begin(out)) { return false; }
+      buffer.resize(std::max(buffer.size(), LZ4F_compressBound(size, &preferences)));
+      return put(LZ4F_compressUpdate(context.get(), buffer.data(), buffer.size(), data, size, nullptr), out);
+    }
+
+    bool flush(std::streambuf& out) {
+      if (!begin(out)) { return false; }
+      return put(LZ4F_flush(context.get(), buffer.data(), buffer.size(), nullptr), out);
+    }
+
+    bool end(std::streambuf& out) {
+      if (!begin(out)) { return false; }
+      started = false;
+      return put(LZ4F_compressEnd(context.get(), buffer.data(), buffer.size(), nullptr), out);
+    }
+  };
+
+  struct Lz4Decompressor {
+    struct Free { void operator () (LZ4F_dctx* context) const { LZ4F_freeDecompressionContext(context); } };
+    std::unique_ptr<LZ4F_dctx, Free> context;
+    const char* error = nullptr;
+
+    Lz4Decompressor() {
+      LZ4F_dctx* created = nullptr;
+      size_t result = LZ4F_createDecompressionContext(&created, LZ4F_VERSION);
+      if (LZ4F_isError(result)) {
+        error = LZ4F_getErrorName(result);
+        return;
+      }
+      context.reset(created);
+    }
+
+    bool decompress(const char* src, size_t& src_size, char* dst, size_t& dst_size, bool& frame_done) {
+      if (error) { return false; }
+      size_t result = LZ4F_decompress(context.get(), dst, &dst_size, src, &src_size, nullptr);
+      if (LZ4F_isError(result)) {
+        error = LZ4F_getErrorName(result);
+        return false;
+      }
+      frame_done = result == 0;
+      return true;
+    }
+  };
+
+  using Lz4CompressStreambuf = CompressStreambuf<Lz4Compressor>;
+  using Lz4DecompressStreambuf = DecompressStreambuf<Lz4Decompressor>;
+#endif
+
+
+#if __has_include(<zstd.h>)
+  /** zstd frames. The levels go from 1 to 19 (or up to 22 with more
+   *  memory); 3 is zstd's default. A dictionary from
+   *  zstd_train_dictionary() helps with small messages, if the
+   *  decompressor has the same one.
+   */
+  struct ZstdCompressor {
+    struct Free { void operator () (ZSTD_CCtx* context) const { ZSTD_freeCCtx(context); } };
+    std::unique_ptr<ZSTD_CCtx, Free> context;
+    std::vector<char> buffer;
+    const char* error = nullptr;
+
+    explicit ZstdCompressor(int level = 3, std::string_view dictionary = {})
+      : context(ZSTD_createCCtx()), buffer(ZSTD_CStreamOutSize()) {
+      if (!context) {
+        error = "can't create a zstd context";
+        return;
+      }
+      if (!check(ZSTD_CCtx_setParameter(context.get(), ZSTD_c_compressionLevel, level))) { return; }
+      if (!dictionary.empty()) {
+        check(ZSTD_CCtx_loadDictionary(context.get(), dictionary.data(), dictionary.size()));
+      }
+    }
+
+    bool check(size_t result) {
+      if (ZSTD_isError(result)) {
+        error = ZSTD_getErrorName(result);
+        return false;
+      }
+      return true;
+    }
+
+    bool compress(const char* data, size_t size, ZSTD_EndDirective mode, std::streambuf& out) {
+      if (error) { return false; }
+      ZSTD_inBuffer input{data, size, 0};
+      while (true) {
+        ZSTD_outBuffer output{buffer.data(), buffer.size(), 0};
+        size_t remaining = ZSTD_compressStream2(context.get(), &output, &input, mode);
+        if (!check(remaining)) { return false; }
+        if (!write_bytes(out, buffer.data(), output.pos)) {
+          error = "can't write the output";
+          return false;
+        }
+        // Continuing only has to use up the input; flushing and
+        // ending also have to write out everything zstd is holding
+        if (mode == ZSTD_e_continue ? input.pos == input.size : remaining == 0) { return true; }
+      }
+    }
+
+    bool write(const char* data, size_t size, std::streambuf& out) { return compress(data, size, ZSTD_e_continue, out); }
+    bool flush(std::streambuf& out) { return compress(nullptr, 0, ZSTD_e_flush, out); }
+    bool end(std::streambuf& out) { return compress(nullptr, 0, ZSTD_e_end, out); }
+  };
+
+  struct ZstdDecompressor {
+    struct Free { void operator () (ZSTD_DCtx* context) const { ZSTD_freeDCtx(context); } };
+    std::unique_ptr<ZSTD_DCtx, Free> context;
+    const char* error = nullptr;
+
+    explicit ZstdDecompressor(std::string_view dictionary = {})
+      : context(ZSTD_createDCtx()) {
+      if (!context) {
+        error = "can't create a zstd context";
+        return;
+      }
+      if (!dictionary.empty()) {
+        size_t result = ZSTD_DCtx_loadDictionary(context.get(), dictionary.data(), dictionary.size());
+        if (ZSTD_isError(result)) { error = ZSTD_getErrorName(result); }
+      }
+    }
+
+    bool decompress(const char* src, size_t& src_size, char* dst, size_t& dst_size, bool& frame_done) {
+      if (error) { return false; }
+      ZSTD_inBuffer input{src, src_size, 0};
+      ZSTD_outBuffer output{dst, dst_size, 0};
+      size_t result = ZSTD_decompressStream(context.get(), &output, &input);
+      if (ZSTD_isError(result)) {
+        error = ZSTD_getErrorName(result);
+        return false;
+      }
+      src_size = input.pos;
+      dst_size = output.pos;
+      frame_done = result == 0;
+      return true;
+    }
+  };
+
+  using ZstdCompressStreambuf = CompressStreambuf<ZstdCompressor>;
+  using ZstdDecompressStreambuf = DecompressStreambuf<ZstdDecompressor>;
+
+  /* A dictionary for compressing messages like the samples, of up
+   * to max_size bytes. zstd needs plenty of samples (hundreds, or a
+   * total of at least 100 times max_size) to find what they have in
+   * common; with too few, the dictionary is empty. */
+  inline std::string zstd_train_dictionary(const std::vector<std::string>& samples, size_t max_size = 16 * 1024) {
+    std::string concatenated;
+    std::vector<size_t> sizes;
+    for (const std::string& sample : samples) {
+      concatenated += sample;
+      sizes.push_back(sample.size());
+    }
+    std::string dictionary(max_size, '\0');
+    size_t size = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), concatenated.data(),
+                                        sizes.data(), unsigned(sizes.size()));
+    if (ZDICT_isError(size)) { return {}; }
+    dictionary.resize(size);
+    return dictionary;
+  }
+
+  // Trains on the BinarySerialize bytes of each message
+  template<typename T>
+  std::string zstd_train_dictionary_on(const std::vector<T>& messages, size_t max_size = 16 * 1024) {
+    std::vector<std::string> samples;
+    for (const T& message : messages) {
+      std::stringbuf buf;
+      BinarySerialize writer(buf);
+      visit(writer, message);
+      samples.push_back(buf.str());
+    }
+    return zstd_train_dictionary(samples, max_size);
+  }
+#endif
+}
+
+
+#endif
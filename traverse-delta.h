@@ -0,0 +1,337 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+/**
+ * Delta encoding: write only the parts of an object that changed
+ * since a baseline copy of it that the receiver already has.
+ *
+ * A struct is a bitmask with one bit per field, in the order of
+ * TRAVERSE_STRUCT, followed by the changed fields. A changed struct
+ * field is itself a delta. A vector is its new size, then the
+ * indices that changed in the part it shares with the baseline, each
+ * followed by that element's delta, then a 0, then the elements past
+ * the end of the baseline in full. Everything else is written in
+ * full, in the BinarySerialize format, when it changed.
+ *
+ * Example usage for C++ to bytes:
+ *
+ *     std::vector<uint8_t> bytes;
+ *     traverse::DeltaSerialize writer(bytes);
+ *     write_delta(writer, current, baseline);
+ *     writer.Finish(); // or let writer go out of scope
+ *
+ * Example usage for bytes to C++:
+ *
+ *     // state must have the same value as baseline had
+ *     traverse::DeltaDeserialize reader(bytes.data(), bytes.size());
+ *     read_delta(reader, state);
+ *     if (!reader.Errors().empty()) { throw "read error"; }
+ *     // state now has the same value as current
+ *
+ * Structs need TRAVERSE_STRUCT. The baseline's field is found at the
+ * same offset as the current object's field, so this works best when
+ * the fields are members of the struct, as they are with FIELD(). A
+ * field that isn't a member, such as .field("shape", *obj.shape), is
+ * written as a delta from a value-initialized object every time.
+ */
+
+#ifndef TRAVERSE_DELTA_H
+#define TRAVERSE_DELTA_H
+
+#include "traverse.h"
+#include "traverse-buffer.h"
+#include <concepts>
+
+namespace traverse {
+
+  /** The DeltaSerialize writes to a vector, and takes unchanged
+   *  fields back out after writing them, so it needs to be able to
+   *  go back to an earlier position. The current and baseline
+   *  pointers are for the struct that's being visited.
+   */
+  struct DeltaSerialize {
+    BufferSerialize out;
+    const void* current = nullptr;
+    const void* baseline = nullptr;
+    size_t struct_size = 0;
+    bool changed = false;
+
+    DeltaSerialize(std::vector<uint8_t>& bytes): out(bytes) {}
+
+    void Finish() { out.Finish(); }
+  };
+
+  /** The DeltaDeserialize applies a delta to an object that has the
+   *  baseline's value. The errors, limits, and flags are the ones on
+   *  the BufferDeserialize; see traverse-buffer.h. As with the
+   *  DeltaSerialize, current is the struct that's being visited.
+   */
+  struct DeltaDeserialize {
+    BufferDeserialize in;
+    void* current = nullptr;
+    size_t struct_size = 0;
+
+    DeltaDeserialize(const uint8_t* data, size_t size): in(data, size) {}
+    DeltaDeserialize(const std::vector<uint8_t>& data): in(data) {}
+    std::string Errors() { return in.errors.str(); }
+    size_t remaining() const { return in.remaining(); }
+  };
+
+  /* write_changes writes the delta of value from baseline and
+   * returns true if they're different. Structs and vectors are always
+   * written, so that the reader can tell what changed; other values
+   * are written only if they changed. */
+  template<typename T>
+  bool write_changes(DeltaSerialize& writer, const T& value, const T& baseline);
+
+  template<typename Element, typename Allocator>
+  bool write_changes(DeltaSerialize& writer,
+                     const std::vector<Element, Allocator>& vector,
+                     const std::vector<Element, Allocator>& baseline);
+
+  template<typename T>
+  bool write_changes(DeltaSerialize& writer, const T& value, const T& baseline) {
+    if constexpr (has_struct_fields_v<T>) {
+      const void* saved_current = writer.current;
+      const void* saved_baseline = writer.baseline;
+      size_t saved_size = writer.struct_size;
+      bool saved_changed = writer.changed;
+      writer.current = &value;
+      writer.baseline = &baseline;
+      writer.struct_size = sizeof(T);
+      writer.changed = false;
+      visit(writer, value);
+      bool changed = writer.changed;
+      writer.current = saved_current;
+      writer.baseline = saved_baseline;
+      writer.struct_size = saved_size;
+      writer.changed = saved_changed;
+      return changed;
+    } else if constexpr (std::equality_comparable<T>) {
+      if (value == baseline) { return false; }
+      visit(writer.out, value);
+      return true;
+    } else {
+      // Without operator ==, compare the encodings
+      size_t before = writer.out.size();
+      visit(writer.out, value);
+      std::vector<uint8_t> baseline_bytes;
+      BufferSerialize baseline_writer(baseline_bytes);
+      visit(baseline_writer, baseline);
+      baseline_writer.Finish();
+      if (writer.out.size() - before == baseline_bytes.size()
+          && std::equal(baseline_bytes.begin(), baseline_bytes.end(), writer.out.start + before)) {
+        writer.out.pos = writer.out.start + before;
+        return false;
+      }
+      return true;
+    }
+  }
+
+  template<typename Element, typename Allocator>
+  bool write_changes(DeltaSerialize& writer,
+                     const std::vector<Element, Allocator>& vector,
+                     const std::vector<Element, Allocator>& baseline) {
+    bool changed = vector.size() != baseline.size();
+    size_t common = std::min(vector.size(), baseline.size());
+    visit(writer.out, uint64_t(vector.size()));
+    // Each changed index is written as the distance from the one
+    // after the previous changed index, plus 1, so that 0 can end it
+    size_t next = 0;
+    for (size_t i = 0; i < common; i++) {
+      size_t before = writer.out.size();
+      visit(writer.out, uint64_t(i - next + 1));
+      if (write_changes(writer, vector[i], baseline[i])) {
+        changed = true;
+        next = i + 1;
+      } else {
+        writer.out.pos = writer.out.start + before;
+      }
+    }
+    visit(writer.out, uint64_t(0));
+    for (size_t i = common; i < vector.size(); i++) {
+      visit(writer.out, vector[i]);
+    }
+    return changed;
+  }
+
+  // Writes the delta of value from baseline; if they're the same,
+  // the delta says that nothing changed
+  template<typename T>
+  void write_delta(DeltaSerialize& writer, const T& value, const T& baseline) {
+    size_t before = writer.out.size();
+    if (!write_changes(writer, value, baseline) && writer.out.size() == before) {
+      visit(writer.out, value);
+    }
+  }
+
+  // Whether a field at this offset from the struct is inside it
+  inline bool is_member(uintptr_t offset, size_t field_size, size_t struct_size) {
+    return field_size <= struct_size && offset <= struct_size - field_size;
+  }
+
+  template<>
+  struct StructVisitor<DeltaSerialize> {
+    const char* name;
+    DeltaSerialize& writer;
+    uintptr_t current;
+    uintptr_t baseline;
+    size_t struct_size;
+    size_t mask_offset;
+    size_t next_field = 0;
+
+    StructVisitor(const char* name_, DeltaSerialize& writer_, const FieldTable& fields)
+      : name(name_), writer(writer_),
+        current(reinterpret_cast<uintptr_t>(writer.current)),
+        baseline(reinterpret_cast<uintptr_t>(writer.baseline)),
+        struct_size(writer.struct_size),
+        mask_offset(writer.out.size()) {
+      size_t mask_size = (fields.size() + 7) / 8;
+      if (uint8_t* p = writer.out.Reserve(mask_size)) {
+        std::memset(p, 0, mask_size);
+        writer.out.pos = p + mask_size;
+      }
+    }
+
+    template<typename T>
+    StructVisitor& field(const char*, const T& value) {
+      size_t index = next_field++;
+      size_t before = writer.out.size();
+      uintptr_t offset = reinterpret_cast<uintptr_t>(&value) - current;
+      bool changed;
+      if (is_member(offset, sizeof(T), struct_size)) {
+        changed = write_changes(writer, value, *reinterpret_cast<const T*>(baseline + offset));
+      } else {
+        // Not a member, so there's no baseline to compare to; the
+        // reader starts from a value-initialized T too
+        write_delta(writer, value, T());
+        changed = true;
+      }
+      if (changed) {
+        writer.out.start[mask_offset + index / 8] |= uint8_t(1 << (index % 8));
+        writer.changed = true;
+      } else {
+        writer.out.pos = writer.out.start + before;
+      }
+      return *this;
+    }
+  };
+
+
+  template<typename T>
+  void read_changes(DeltaDeserialize& reader, T& value);
+
+  template<typename Element, typename Allocator>
+  void read_changes(DeltaDeserialize& reader, std::vector<Element, Allocator>& vector);
+
+  template<typename T>
+  void read_changes(DeltaDeserialize& reader, T& value) {
+    if constexpr (has_struct_fields_v<T>) {
+      void* saved_current = reader.current;
+      size_t saved_size = reader.struct_size;
+      reader.current = &value;
+      reader.struct_size = sizeof(T);
+      visit(reader, value);
+      reader.current = saved_current;
+      reader.struct_size = saved_size;
+    } else {
+      visit(reader.in, value);
+    }
+  }
+
+  template<typename Element, typename Allocator>
+  void read_changes(DeltaDeserialize& reader, std::vector<Element, Allocator>& vector) {
+    if (stopped(reader.in)) { return; }
+    uint64_t size = 0;
+    if (!read_unsigned_int(reader.in, size)) {
+      fail(reader.in, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read vector size\n";
+      return;
+    }
+    if (!check_vector_limits(reader.in, size, sizeof(Element))) {
+      return;
+    }
+    // Each element past the end of the baseline takes at least one
+    // byte, so the remaining input limits how much the vector can grow
+    size_t baseline_size = vector.size();
+    if (size > baseline_size && size - baseline_size > reader.in.remaining()) {
+      fail(reader.in, ErrorCode::END_OF_INPUT) << "Error: expected " << size - baseline_size
+                    << " new elements in vector but only " << reader.in.remaining() << " bytes left\n";
+      return;
+    }
+    uint64_t common = std::min(uint64_t(baseline_size), size);
+    vector.resize(size);
+
+    uint64_t next = 0;
+    while (true) {
+      uint64_t distance = 0;
+      if (!read_unsigned_int(reader.in, distance)) {
+        fail(reader.in, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read changed index\n";
+        return;
+      }
+      if (distance == 0) { break; }
+      if (distance - 1 >= common - next) {
+        fail(reader.in, ErrorCode::BAD_VALUE) << "Error: changed index " << next + (distance - 1)
+                      << " is past the " << common << " elements shared with the baseline\n";
+        return;
+      }
+      uint64_t index = next + (distance - 1);
+      read_changes(reader, vector[index]);
+      if (stopped(reader.in)) { return; }
+      next = index + 1;
+    }
+    for (uint64_t i = common; i < size; i++) {
+      visit(reader.in, vector[i]);
+      if (stopped(reader.in)) { return; }
+    }
+  }
+
+  // Applies the delta written by write_delta to value
+  template<typename T>
+  void read_delta(DeltaDeserialize& reader, T& value) {
+    read_changes(reader, value);
+  }
+
+  template<>
+  struct StructVisitor<DeltaDeserialize> {
+    const char* name;
+    DeltaDeserialize& reader;
+    uintptr_t current;
+    size_t struct_size;
+    const uint8_t* mask = nullptr;
+    size_t next_field = 0;
+
+    StructVisitor(const char* name_, DeltaDeserialize& reader_, const FieldTable& fields)
+      : name(name_), reader(reader_),
+        current(reinterpret_cast<uintptr_t>(reader.current)),
+        struct_size(reader.struct_size) {
+      if (stopped(reader.in)) { return; }
+      size_t mask_size = (fields.size() + 7) / 8;
+      if (reader.in.remaining() < mask_size) {
+        fail(reader.in, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read changed fields of "
+                      << name << "\n";
+        reader.in.pos = reader.in.end;
+        return;
+      }
+      mask = reader.in.pos;
+      reader.in.pos += mask_size;
+    }
+
+    template<typename T>
+    StructVisitor& field(const char* label, T& value) {
+      size_t index = next_field++;
+      if (mask == nullptr || stopped(reader.in)) { return *this; }
+      if (mask[index / 8] & (1 << (index % 8))) {
+        bool failed = reader.in.errors.failed();
+        uintptr_t offset = reinterpret_cast<uintptr_t>(&value) - current;
+        if (!is_member(offset, sizeof(T), struct_size)) { value = T(); }
+        read_changes(reader, value);
+        reader.in.errors.note_field(label, failed);
+      }
+      return *this;
+    }
+  };
+}
+
+
+#endif
@@ -0,0 +1,442 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+/**
+ * Fixed-width binary serialization.
+ *
+ * FixedBinarySerialize and FixedBinaryDeserialize are an opt-in
+ * alternative to BinarySerialize and BinaryDeserialize in traverse.h.
+ * Instead of variable length integers, every number is written with
+ * its own size, little endian, so floats and doubles keep all their
+ * bits. Vectors of numbers are written as one block of memory.
+ *
+ * The format:
+ *
+ *  - bool, char: 1 byte
+ *  - other numbers: sizeof(T) bytes, little endian; floating point
+ *    numbers are written as their IEEE bit pattern
+ *  - enums: the underlying type
+ *  - strings: uint64_t size, then the bytes
+ *  - vectors: uint64_t size, then each element; vectors of
+ *    is_bulk_copyable types are written/read with one sputn/sgetn
+ *  - structs: each field, in order
+ *
+ * std::string_view and std::span can be written in place of
+ * std::string and std::vector. FixedBufferDeserialize, at the end
+ * of this file, reads from memory and can read them back as views
+ * into that memory.
+ *
+ * Unlike the variable length format, the writer and reader need to
+ * use the same types: an int16_t can't be read into an int32_t.
+ *
+ * Both readers have a fail_fast field that works the same way as in
+ * BinaryDeserialize.
+ *
+ * Example usage:
+ *
+ *     std::stringbuf buf;
+ *     traverse::FixedBinarySerialize writer(buf);
+ *     visit(writer, yourobject);
+ *
+ *     traverse::FixedBinaryDeserialize reader(buf);
+ *     visit(reader, yourobject);
+ *     if (!reader.Errors().empty()) { throw "read error"; }
+ */
+
+#ifndef TRAVERSE_FIXED_H
+#define TRAVERSE_FIXED_H
+
+#include "traverse.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace traverse {
+
+  /* Vectors of these types are copied as a block of memory, when the
+   * machine is little endian. Numbers (except bool, because not every
+   * byte is a valid bool) and enums are included. A packed struct
+   * with no padding can be added with
+   *
+   *     template<> struct traverse::is_bulk_copyable<MyStruct> : std::true_type {};
+   *
+   * but then its in-memory layout becomes the format for vectors of
+   * that struct, so both sides have to agree on the layout.
+   */
+  template<typename T>
+  struct is_bulk_copyable
+    : std::bool_constant<(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+                         || std::is_enum_v<T>> {};
+
+  template<typename T>
+  constexpr bool bulk_copy_v = is_bulk_copyable<T>::value
+    && std::is_trivially_copyable_v<T>
+    && std::endian::native == std::endian::little;
+
+  template<typename T>
+  void write_fixed(std::streambuf& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big) {
+      std::reverse(bytes, bytes + sizeof(T));
+    }
+    out.sputn(bytes, sizeof(T));
+  }
+
+  template<typename T>
+  bool read_fixed(std::streambuf& in, T& value) {
+    char bytes[sizeof(T)];
+    if (in.sgetn(bytes, sizeof(T)) != std::streamsize(sizeof(T))) {
+      return false;
+    }
+    if constexpr (std::endian::native == std::endian::big) {
+      std::reverse(bytes, bytes + sizeof(T));
+    }
+    std::memcpy(&value, bytes, sizeof(T));
+    return true;
+  }
+
+
+  struct FixedBinarySerialize {
+    std::streambuf& out;
+    FixedBinarySerialize(std::streambuf& out_): out(out_) {}
+  };
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T>>
+  visit(FixedBinarySerialize& writer, const T& value) {
+    write_fixed(writer.out, value);
+  }
+
+  inline void visit(FixedBinarySerialize& writer, const bool& value) {
+    writer.out.sputc(value ? 1 : 0);
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_enum_v<T>>
+  visit(FixedBinarySerialize& writer, const T& value) {
+    visit(writer, std::underlying_type_t<T>(value));
+  }
+
+  inline void visit(FixedBinarySerialize& writer, const std::string_view& string) {
+    write_fixed(writer.out, uint64_t(string.size()));
+    writer.out.sputn(string.data(), string.size());
+  }
+
+  template<typename Allocator>
+  void visit(FixedBinarySerialize& writer, const std::basic_string<char, std::char_traits<char>, Allocator>& string) {
+    visit(writer, std::string_view(string));
+  }
+
+  template<typename Element>
+  void visit(FixedBinarySerialize& writer, const std::span<Element>& span) {
+    using T = std::remove_const_t<Element>;
+    write_fixed(writer.out, uint64_t(span.size()));
+    if constexpr (bulk_copy_v<T>) {
+      writer.out.sputn(reinterpret_cast<const char*>(span.data()),
+                       span.size() * sizeof(T));
+    } else {
+      for (auto& element : span) {
+        visit(writer, element);
+      }
+    }
+  }
+
+  template<typename Element, typename Allocator>
+  void visit(FixedBinarySerialize& writer, const std::vector<Element, Allocator>& vector) {
+    visit(writer, std::span<const Element>(vector));
+  }
+
+
+  struct FixedBinaryDeserialize {
+    std::streambuf& in;
+    ErrorLog errors;
+    bool fail_fast = false;
+    std::pmr::memory_resource* resource = nullptr;
+    FixedBinaryDeserialize(std::streambuf& buf): in(buf) {}
+    std::string Errors() { return errors.str(); }
+  };
+
+  inline uint64_t input_offset(FixedBinaryDeserialize& reader) {
+    auto pos = reader.in.pubseekoff(0, std::ios::cur, std::ios::in);
+    return pos < 0 ? ErrorLog::unknown_offset : uint64_t(pos);
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T>>
+  visit(FixedBinaryDeserialize& reader, T& value) {
+    if (stopped(reader)) { return; }
+    if (!read_fixed(reader.in, value)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read number\n";
+    }
+  }
+
+  inline void visit(FixedBinaryDeserialize& reader, bool& value) {
+    if (stopped(reader)) { return; }
+    int c = reader.in.sbumpc();
+    if (c == std::streambuf::traits_type::eof()) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read bool\n";
+      return;
+    }
+    value = c != 0;
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_enum_v<T>>
+  visit(FixedBinaryDeserialize& reader, T& value) {
+    if (stopped(reader)) { return; }
+    std::underlying_type_t<T> v{};
+    visit(reader, v);
+    value = static_cast<T>(v);
+  }
+
+  /* The sizes are untrusted input, so strings and vectors are read
+   * in blocks, and only grow as data actually arrives.
+   */
+  const size_t fixed_read_blocksize = 65536;
+
+  template<typename Allocator>
+  void visit(FixedBinaryDeserialize& reader, std::basic_string<char, std::char_traits<char>, Allocator>& string) {
+    if (stopped(reader)) { return; }
+    use_resource(string, reader.resource);
+    uint64_t size = 0;
+    if (!read_fixed(reader.in, size)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read string size\n";
+      return;
+    }
+    string.resize(0);
+    while (string.size() < size) {
+      size_t start = string.size();
+      size_t bytes_to_read = size_t(std::min(size - start, uint64_t(fixed_read_blocksize)));
+      string.resize(start + bytes_to_read);
+      size_t bytes_actually_read = reader.in.sgetn(&string[start], bytes_to_read);
+      if (bytes_actually_read < bytes_to_read) {
+        string.resize(start + bytes_actually_read);
+        fail(reader, ErrorCode::END_OF_INPUT) << "Error: expected " << size
+                      << " bytes in string but only found "
+                      << string.size() << "\n";
+        return;
+      }
+    }
+  }
+
+  template<typename Element, typename Allocator>
+  void visit(FixedBinaryDeserialize& reader, std::vector<Element, Allocator>& vector) {
+    if (stopped(reader)) { return; }
+    use_resource(vector, reader.resource);
+    uint64_t size = 0;
+    if (!read_fixed(reader.in, size)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read vector size\n";
+      return;
+    }
+    vector.clear();
+    if constexpr (bulk_copy_v<Element>) {
+      const size_t blockelements = std::max(size_t(1), fixed_read_blocksize / sizeof(Element));
+      while (vector.size() < size) {
+        size_t start = vector.size();
+        size_t elements_to_read = size_t(std::min(size - start, uint64_t(blockelements)));
+        vector.resize(start + elements_to_read);
+        size_t bytes_to_read = elements_to_read * sizeof(Element);
+        size_t bytes_actually_read = reader.in.sgetn(reinterpret_cast<char*>(vector.data() + start),
+                                                     bytes_to_read);
+        if (bytes_actually_read < bytes_to_read) {
+          vector.resize(start + bytes_actually_read / sizeof(Element));
+          break;
+        }
+      }
+    } else {
+      while (vector.size() < size
+             && reader.in.sgetc() != std::streambuf::traits_type::eof()) {
+        vector.emplace_back();
+        visit(reader, vector.back());
+        if (stopped(reader)) { return; }
+      }
+    }
+    if (vector.size() != size) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: expected " << size
+                    << " elements in vector but only found "
+                    << vector.size() << "\n";
+    }
+  }
+
+
+  /** The FixedBufferDeserialize reads the same format from a block
+   *  of memory, which must stay alive while the reader is in use. In
+   *  addition to the owning types, it can read std::string_view and
+   *  std::span<const T> (for is_bulk_copyable T), which point
+   *  directly into the block instead of copying. That way a struct
+   *  of views can be declared next to a struct of owning types:
+   *
+   *      struct Mesh { std::string name; std::vector<float> weights; };
+   *      struct MeshView { std::string_view name; std::span<const float> weights; };
+   *
+   *  and read from the same bytes, as long as the fields are in the
+   *  same order. The format has no padding, so a span can only be
+   *  made when its data happens to be aligned; otherwise it's an
+   *  error, and the owning type should be used instead.
+   */
+  struct FixedBufferDeserialize {
+    const uint8_t* start;
+    const uint8_t* pos;
+    const uint8_t* end;
+    ErrorLog errors;
+    bool fail_fast = false;
+    std::pmr::memory_resource* resource = nullptr;
+    FixedBufferDeserialize(const uint8_t* data, size_t size): start(data), pos(data), end(data + size) {}
+    FixedBufferDeserialize(const std::vector<uint8_t>& data): FixedBufferDeserialize(data.data(), data.size()) {}
+    std::string Errors() { return errors.str(); }
+    size_t remaining() const { return end - pos; }
+  };
+
+  inline uint64_t input_offset(FixedBufferDeserialize& reader) {
+    return reader.pos - reader.start;
+  }
+
+  template<typename T>
+  bool read_fixed(FixedBufferDeserialize& reader, T& value) {
+    if (reader.remaining() < sizeof(T)) {
+      reader.pos = reader.end;
+      return false;
+    }
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, reader.pos, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big) {
+      std::reverse(bytes, bytes + sizeof(T));
+    }
+    std::memcpy(&value, bytes, sizeof(T));
+    reader.pos += sizeof(T);
+    return true;
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T>>
+  visit(FixedBufferDeserialize& reader, T& value) {
+    if (stopped(reader)) { return; }
+    if (!read_fixed(reader, value)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read number\n";
+    }
+  }
+
+  inline void visit(FixedBufferDeserialize& reader, bool& value) {
+    if (stopped(reader)) { return; }
+    if (reader.pos == reader.end) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read bool\n";
+      return;
+    }
+    value = *reader.pos++ != 0;
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_enum_v<T>>
+  visit(FixedBufferDeserialize& reader, T& value) {
+    if (stopped(reader)) { return; }
+    std::underlying_type_t<T> v{};
+    visit(reader, v);
+    value = static_cast<T>(v);
+  }
+
+  // Read a size and that many bytes, returning false if there's no size
+  inline bool read_string_view(FixedBufferDeserialize& reader, std::string_view& string) {
+    if (stopped(reader)) { return false; }
+    uint64_t size = 0;
+    if (!read_fixed(reader, size)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read string size\n";
+      return false;
+    }
+    if (size > reader.remaining()) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: expected " << size
+                    << " bytes in string but only found "
+                    << reader.remaining() << "\n";
+      size = reader.remaining();
+    }
+    string = std::string_view(reinterpret_cast<const char*>(reader.pos), size_t(size));
+    reader.pos += size;
+    return true;
+  }
+
+  template<typename Allocator>
+  void visit(FixedBufferDeserialize& reader, std::basic_string<char, std::char_traits<char>, Allocator>& string) {
+    use_resource(string, reader.resource);
+    std::string_view view;
+    if (read_string_view(reader, view)) {
+      string.assign(view);
+    }
+  }
+
+  inline void visit(FixedBufferDeserialize& reader, std::string_view& string) {
+    read_string_view(reader, string);
+  }
+
+  // Read a size and return how many of those elements are in the
+  // buffer, or -1 if there's no size
+  template<typename T>
+  int64_t read_bulk_size(FixedBufferDeserialize& reader) {
+    if (stopped(reader)) { return -1; }
+    uint64_t size = 0;
+    if (!read_fixed(reader, size)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read vector size\n";
+      return -1;
+    }
+    uint64_t available = reader.remaining() / sizeof(T);
+    if (size > available) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: expected " << size
+                    << " elements in vector but only found "
+                    << available << "\n";
+      size = available;
+    }
+    return int64_t(size);
+  }
+
+  template<typename T>
+  void visit(FixedBufferDeserialize& reader, std::span<const T>& span) {
+    static_assert(bulk_copy_v<T>, "span<const T> can only view is_bulk_copyable types on a little endian machine");
+    int64_t size = read_bulk_size<T>(reader);
+    if (size < 0) { return; }
+    const uint8_t* data = reader.pos;
+    reader.pos += size * sizeof(T);
+    if (reinterpret_cast<uintptr_t>(data) % alignof(T) != 0) {
+      fail(reader, ErrorCode::BAD_VALUE) << "Error: vector data is not aligned for a span of "
+                    << alignof(T) << "-byte aligned elements\n";
+      span = {};
+      return;
+    }
+    span = std::span<const T>(reinterpret_cast<const T*>(data), size_t(size));
+  }
+
+  template<typename Element, typename Allocator>
+  void visit(FixedBufferDeserialize& reader, std::vector<Element, Allocator>& vector) {
+    if (stopped(reader)) { return; }
+    use_resource(vector, reader.resource);
+    if constexpr (bulk_copy_v<Element>) {
+      int64_t size = read_bulk_size<Element>(reader);
+      if (size < 0) { return; }
+      vector.resize(size_t(size));
+      if (size > 0) {
+        std::memcpy(vector.data(), reader.pos, size * sizeof(Element));
+        reader.pos += size * sizeof(Element);
+      }
+    } else {
+      uint64_t size = 0;
+      if (!read_fixed(reader, size)) {
+        fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read vector size\n";
+        return;
+      }
+      vector.clear();
+      while (vector.size() < size && reader.pos != reader.end) {
+        vector.emplace_back();
+        visit(reader, vector.back());
+        if (stopped(reader)) { return; }
+      }
+      if (vector.size() != size) {
+        fail(reader, ErrorCode::END_OF_INPUT) << "Error: expected " << size
+                      << " elements in vector but only found "
+                      << vector.size() << "\n";
+      }
+    }
+  }
+
+}
+
+
+#endif
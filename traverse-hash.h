@@ -0,0 +1,265 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+/**
+ * A 64-bit hash of an object, for telling whether it changed or as a
+ * key for a cache of serialized objects.
+ *
+ * The hash is of the bytes that BinarySerialize would write, but the
+ * bytes are fed to the hash as they're made instead of being written
+ * out, so hash_value(obj) == hash_bytes(bytes of obj). The hash
+ * function is in the style of xxHash64 but isn't compatible with it.
+ * It's not meant for hash tables that take untrusted keys.
+ *
+ * Example usage:
+ *
+ *     uint64_t hash = traverse::hash_value(yourobject);
+ *
+ * To skip hashing parts that didn't change, keep them in a
+ * Versioned<T> (see traverse.h) and give the HashVisitor a HashCache:
+ *
+ *     traverse::HashCache cache; // keep this around between calls
+ *     traverse::HashVisitor hasher{&cache};
+ *     visit(hasher, yourobject);
+ *     uint64_t hash = hasher.hash();
+ *
+ * A Versioned<T> adds the 8 byte hash of its value instead of the
+ * value's bytes, with or without a cache, so the hash is the same
+ * either way. The cache is only for one thread at a time.
+ */
+
+#ifndef TRAVERSE_HASH_H
+#define TRAVERSE_HASH_H
+
+#include "traverse.h"
+#include "traverse-buffer.h"
+#include <cstring>
+#include <unordered_map>
+
+namespace traverse {
+
+  /* Hashes of Versioned values, by version. It's cleared when it
+   * reaches max_entries, since old versions are never looked up
+   * again, and when it's used with a different seed, since the
+   * hashes depend on the seed. */
+  struct HashCache {
+    std::unordered_map<uint64_t, uint64_t> hashes;
+    uint64_t seed = 0;
+    size_t max_entries = 1 << 16;
+    size_t hits = 0;
+
+    void clear() { hashes.clear(); }
+  };
+
+  struct HashVisitor {
+    static constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+    static constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+    HashCache* cache = nullptr;
+    uint64_t seed = 0;
+    uint64_t acc = seed + prime5;
+    uint64_t word = 0;          // the bytes after the last full word
+    uint64_t length = 0;
+
+    void mix(uint64_t w) {
+      acc ^= std::rotl(w * prime2, 31) * prime1;
+      acc = std::rotl(acc, 27) * prime1 + prime4;
+    }
+
+    void add(const uint8_t* data, size_t n) {
+      size_t used = length % 8;
+      length += n;
+      if (used != 0) {
+        for (; n > 0 && used < 8; n--) {
+          word |= uint64_t(*data++) << (8 * used++);
+        }
+        if (used < 8) { return; }
+        mix(word);
+        word = 0;
+      }
+      for (; n >= 8; data += 8, n -= 8) {
+        uint64_t w = 0;
+        if constexpr (std::endian::native == std::endian::little) {
+          std::memcpy(&w, data, 8);
+        } else {
+          for (size_t i = 0; i < 8; i++) { w |= uint64_t(data[i]) << (8 * i); }
+        }
+        mix(w);
+      }
+      for (size_t i = 0; i < n; i++) {
+        word |= uint64_t(data[i]) << (8 * i);
+      }
+    }
+
+    // The hash of the bytes so far; more can be added after this
+    uint64_t hash() const {
+      uint64_t h = acc + length;
+      if (length % 8 != 0) {
+        h ^= std::rotl(word * prime5, 11) * prime1;
+        h = std::rotl(h, 27) * prime1 + prime4;
+      }
+      h ^= h >> 33;
+      h *= prime2;
+      h ^= h >> 29;
+      h *= prime3;
+      h ^= h >> 32;
+      return h;
+    }
+  };
+
+  inline uint64_t hash_bytes(const void* data, size_t size) {
+    HashVisitor hasher;
+    hasher.add(static_cast<const uint8_t*>(data), size);
+    return hasher.hash();
+  }
+
+  // Encode one integer the way BinarySerialize does
+  template<typename T>
+  uint8_t* hash_encode(uint8_t* out, const T& value) {
+    if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char>) {
+      return write_unsigned_int(out, static_cast<unsigned char>(value));
+    } else if constexpr (std::is_signed_v<T>) {
+      return write_signed_int(out, value);
+    } else {
+      return write_unsigned_int(out, uint64_t(value));
+    }
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T>>
+  visit(HashVisitor& hasher, const T& value) {
+    uint8_t bytes[max_varint_size];
+    hasher.add(bytes, hash_encode(bytes, value) - bytes);
+  }
+
+  template <typename T>
+  inline std::enable_if_t<std::is_enum_v<T>>
+  visit(HashVisitor& hasher, const T& value) {
+    visit(hasher, std::underlying_type_t<T>(value));
+  }
+
+  inline void visit(HashVisitor& hasher, const std::string_view& string) {
+    visit(hasher, uint64_t(string.size()));
+    hasher.add(reinterpret_cast<const uint8_t*>(string.data()), string.size());
+  }
+
+  template<typename Allocator>
+  void visit(HashVisitor& hasher, const std::basic_string<char, std::char_traits<char>, Allocator>& string) {
+    visit(hasher, std::string_view(string));
+  }
+
+  template<typename Element>
+  void visit(HashVisitor& hasher, const std::span<Element>& span) {
+    visit(hasher, uint64_t(span.size()));
+    if constexpr (std::is_integral_v<Element>) {
+      // Encode a block of integers at a time and hash the block
+      uint8_t bytes[256 + max_varint_size];
+      uint8_t* pos = bytes;
+      for (auto element : span) {
+        pos = hash_encode(pos, element);
+        if (pos >= bytes + 256) {
+          hasher.add(bytes, pos - bytes);
+          pos = bytes;
+        }
+      }
+      hasher.add(bytes, pos - bytes);
+    } else {
+      for (auto& element : span) {
+        visit(hasher, element);
+      }
+    }
+  }
+
+  template<typename Element, typename Allocator>
+  void visit(HashVisitor& hasher, const std::vector<Element, Allocator>& vector) {
+    visit(hasher, std::span<const Element>(vector));
+  }
+
+  template<typename T>
+  void visit(HashVisitor& hasher, const std::optional<T>& value) {
+    visit(hasher, unsigned(value.has_value()));
+    if (value) { visit(hasher, *value); }
+  }
+
+  template<typename T>
+  void visit(HashVisitor& hasher, const std::unique_ptr<T>& pointer) {
+    visit(hasher, unsigned(pointer != nullptr));
+    if (pointer) { visit(hasher, *pointer); }
+  }
+
+  template<typename Element, size_t N>
+  void visit(HashVisitor& hasher, const std::array<Element, N>& array) {
+    for (const auto& element : array) {
+      visit(hasher, element);
+    }
+  }
+
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map>>
+  visit(HashVisitor& hasher, const Map& map) {
+    visit(hasher, uint64_t(map.size()));
+    for (const auto& [key, value] : map) {
+      visit(hasher, key);
+      visit(hasher, value);
+    }
+  }
+
+  template<typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType>>
+  visit(HashVisitor& hasher, VariantType& value) {
+    using Traits = VariantTraits<std::remove_const_t<VariantType>>;
+    visit(hasher, unsigned(Traits::index(value)));
+    Traits::apply([&](const auto& alternative) { visit(hasher, alternative); }, value);
+  }
+
+  // The hash of a Versioned value is added as 8 bytes
+  inline void add_hash(HashVisitor& hasher, uint64_t hash) {
+    uint8_t bytes[8];
+    for (size_t i = 0; i < 8; i++) { bytes[i] = uint8_t(hash >> (8 * i)); }
+    hasher.add(bytes, 8);
+  }
+
+  template<typename T>
+  void visit(HashVisitor& hasher, const Versioned<T>& versioned) {
+    HashCache* cache = hasher.cache;
+    if (cache != nullptr && cache->seed != hasher.seed) {
+      cache->clear();
+      cache->seed = hasher.seed;
+    }
+    if (cache != nullptr) {
+      auto cached = cache->hashes.find(versioned.version());
+      if (cached != cache->hashes.end()) {
+        cache->hits++;
+        add_hash(hasher, cached->second);
+        return;
+      }
+    }
+    HashVisitor inner{cache, hasher.seed};
+    visit(inner, versioned.get());
+    uint64_t hash = inner.hash();
+    if (cache != nullptr) {
+      if (cache->hashes.size() >= cache->max_entries) { cache->clear(); }
+      cache->hashes.emplace(versioned.version(), hash);
+    }
+    add_hash(hasher, hash);
+  }
+
+  template<typename T>
+  void visit(HashVisitor& hasher, Versioned<T>& versioned) {
+    visit(hasher, std::as_const(versioned));
+  }
+
+  template<typename T>
+  uint64_t hash_value(const T& obj) {
+    HashVisitor hasher;
+    visit(hasher, obj);
+    return hasher.hash();
+  }
+}
+
+
+#endif
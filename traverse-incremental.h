@@ -0,0 +1,302 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+/**
+ * Decode the BinarySerialize format as the input arrives, a chunk at
+ * a time, instead of waiting for the whole message. When a chunk runs
+ * out in the middle of the object, feed() returns NEED_MORE_DATA and
+ * keeps what it has decoded so far; the next chunk continues from
+ * there. The object is complete when feed() returns DONE.
+ *
+ * Example usage:
+ *
+ *     traverse::IncrementalDeserialize reader;
+ *     Message message;
+ *     traverse::DecodeStatus status = traverse::DecodeStatus::NEED_MORE_DATA;
+ *     while (status == traverse::DecodeStatus::NEED_MORE_DATA) {
+ *       size_t size = receive(socket, chunk, sizeof(chunk));
+ *       if (size == 0) { status = reader.close(); break; }
+ *       status = reader.feed(message, chunk, size);
+ *     }
+ *     if (status == traverse::DecodeStatus::FAILED) { throw reader.Errors(); }
+ *
+ * Pass the same object to every feed() until it's done. Bytes after
+ * the end of the object are kept for the next one; call reset() and
+ * then feed() the next object, with no data if there's no new input.
+ *
+ * Progress is kept at the level of struct fields and vector elements,
+ * so a large vector is decoded as its elements arrive. Other values,
+ * such as strings, optionals, maps, and variants, are decoded once
+ * all of their bytes have arrived. Until then, their bytes are kept
+ * in a buffer; the rest of the input is decoded straight out of each
+ * chunk. string_view and span fields aren't supported, since the
+ * chunks they would point into go away.
+ */
+
+#ifndef TRAVERSE_INCREMENTAL_H
+#define TRAVERSE_INCREMENTAL_H
+
+#include "traverse.h"
+#include "traverse-buffer.h"
+
+namespace traverse {
+
+  enum class DecodeStatus { NEED_MORE_DATA, DONE, FAILED };
+
+  /** The IncrementalDeserialize stops at the first error, since the
+   *  input after it can't be trusted. The max_elements and max_bytes
+   *  limits are the same as BufferDeserialize's.
+   */
+  struct IncrementalDeserialize {
+    // How far along each struct or vector around the value being
+    // read is, from the outermost in
+    struct Progress {
+      bool started = false;   // the vector's size has been read
+      uint64_t size = 0;      // the vector's size
+      uint64_t done = 0;      // the fields or elements that are complete
+    };
+
+    std::vector<uint8_t> pending;  // input that hasn't been used yet
+    const uint8_t* start = nullptr;
+    const uint8_t* pos = nullptr;
+    const uint8_t* end = nullptr;
+    uint64_t offset = 0;           // input used before start
+    ErrorLog errors;
+    uint64_t max_elements = 0;
+    uint64_t max_bytes = 0;
+    uint64_t bytes_used = 0;
+    std::vector<Progress> progress;
+    size_t depth = 0;
+    bool suspended = false;        // ran out of input in this feed()
+    DecodeStatus status = DecodeStatus::NEED_MORE_DATA;
+
+    std::string Errors() { return errors.str(); }
+
+    // Bytes received but not used; after DONE, the start of the next object
+    size_t remaining() const { return pending.size(); }
+
+    template<typename T>
+    DecodeStatus feed(T& obj, const uint8_t* data, size_t size) {
+      if (status != DecodeStatus::NEED_MORE_DATA) {
+        pending.insert(pending.end(), data, data + size);
+        return status;
+      }
+      if (pending.empty()) {
+        start = data;
+      } else {
+        pending.insert(pending.end(), data, data + size);
+        start = pending.data();
+        size = pending.size();
+      }
+      pos = start;
+      end = start + size;
+      suspended = false;
+      depth = 0;
+      visit(*this, obj);
+
+      if (errors.failed()) {
+        status = DecodeStatus::FAILED;
+      } else if (!suspended) {
+        status = DecodeStatus::DONE;
+      }
+      // Keep the input that wasn't used, for the next feed()
+      size_t used = pos - start;
+      offset += used;
+      if (!pending.empty()) {
+        pending.erase(pending.begin(), pending.begin() + used);
+      } else {
+        pending.assign(pos, end);
+      }
+      start = pos = end = nullptr;
+      return status;
+    }
+
+    template<typename T>
+    DecodeStatus feed(T& obj, const std::vector<uint8_t>& data) {
+      return feed(obj, data.data(), data.size());
+    }
+
+    // There's no more input; it's an error if the object isn't done
+    DecodeStatus close() {
+      if (status == DecodeStatus::NEED_MORE_DATA) {
+        errors.error(ErrorCode::END_OF_INPUT, offset + pending.size())
+          << "Error: input ended after " << offset + pending.size() << " bytes, before the object was complete\n";
+        status = DecodeStatus::FAILED;
+      }
+      return status;
+    }
+
+    // Start on the next object, keeping the input after the last one
+    void reset() {
+      errors.clear();
+      progress.clear();
+      bytes_used = 0;
+      status = DecodeStatus::NEED_MORE_DATA;
+    }
+
+    // Struct and vector visitors call these around their contents
+    size_t enter() {
+      if (progress.size() == depth) { progress.emplace_back(); }
+      return depth++;
+    }
+    void leave(size_t level) {
+      depth = level;
+      if (!suspended && !errors.failed()) { progress.resize(level); }
+    }
+  };
+
+  inline uint64_t input_offset(IncrementalDeserialize& reader) {
+    return reader.offset + (reader.pos - reader.start);
+  }
+
+  inline bool stopped(const IncrementalDeserialize& reader) {
+    return reader.suspended || reader.errors.failed();
+  }
+
+  /* Values that aren't structs or vectors are decoded all at once
+   * with a BufferDeserialize. If it runs out of input, the value is
+   * decoded again from the start in the next feed(). */
+  template<typename T>
+  void read_whole(IncrementalDeserialize& reader, T& value) {
+    if (stopped(reader)) { return; }
+    BufferDeserialize in(reader.pos, reader.end - reader.pos);
+    in.max_elements = reader.max_elements;
+    in.max_bytes = reader.max_bytes;
+    in.bytes_used = reader.bytes_used;
+    in.fail_fast = true;
+    visit(in, value);
+    if (in.errors.code == ErrorCode::END_OF_INPUT) {
+      reader.suspended = true;
+      return;
+    }
+    if (in.errors.failed()) {
+      in.errors.offset += input_offset(reader);
+      reader.errors.append(in.errors);
+    }
+    reader.pos = in.pos;
+    reader.bytes_used = in.bytes_used;
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>
+  visit(IncrementalDeserialize& reader, T& value) {
+    read_whole(reader, value);
+  }
+
+  template<typename Allocator>
+  void visit(IncrementalDeserialize& reader, std::basic_string<char, std::char_traits<char>, Allocator>& string) {
+    read_whole(reader, string);
+  }
+
+  template<typename T>
+  void visit(IncrementalDeserialize& reader, std::optional<T>& value) {
+    read_whole(reader, value);
+  }
+
+  template<typename T>
+  void visit(IncrementalDeserialize& reader, std::unique_ptr<T>& pointer) {
+    read_whole(reader, pointer);
+  }
+
+  template<typename Element, size_t N>
+  void visit(IncrementalDeserialize& reader, std::array<Element, N>& array) {
+    read_whole(reader, array);
+  }
+
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map> && !std::is_const_v<Map>>
+  visit(IncrementalDeserialize& reader, Map& map) {
+    read_whole(reader, map);
+  }
+
+  template<typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType> && !std::is_const_v<VariantType>>
+  visit(IncrementalDeserialize& reader, VariantType& value) {
+    read_whole(reader, value);
+  }
+
+  template<typename Element, typename Allocator>
+  void visit(IncrementalDeserialize& reader, std::vector<Element, Allocator>& vector) {
+    if (stopped(reader)) { return; }
+    size_t level = reader.enter();
+    if (!reader.progress[level].started) {
+      uint64_t size = 0;
+      const uint8_t* next = read_unsigned_int(reader.pos, reader.end, size);
+      if (!next) {
+        // Over-long sizes are accepted, as in the other readers, so
+        // this only happens when the input ends in the size
+        reader.suspended = true;
+        reader.leave(level);
+        return;
+      }
+      reader.pos = next;
+      vector.clear();
+      if (!check_vector_limits(reader, size, sizeof(Element))) {
+        reader.leave(level);
+        return;
+      }
+      // Each element takes at least one byte
+      vector.reserve(std::min(size, uint64_t(reader.end - reader.pos)));
+      reader.progress[level] = {true, size, 0};
+    }
+
+    uint64_t size = reader.progress[level].size;
+    uint64_t i = reader.progress[level].done;
+    if constexpr (std::is_integral_v<Element>) {
+      const size_t blocksize = 256;
+      uint64_t block[blocksize];
+      while (i < size) {
+        size_t wanted = size_t(std::min(size - i, uint64_t(blocksize)));
+        size_t found = decode_varints(reader.pos, reader.end, block, wanted);
+        for (size_t j = 0; j < found; ++j) {
+          vector.push_back(integer_from_varint<Element>(block[j]));
+        }
+        i += found;
+        if (found < wanted) {
+          // The input ended in the middle of a number
+          reader.suspended = true;
+          break;
+        }
+      }
+    } else {
+      for (; i < size; ++i) {
+        if (i == vector.size()) {
+          vector.emplace_back();
+        }
+        visit(reader, vector[i]);
+        if (stopped(reader)) { break; }
+      }
+    }
+    reader.progress[level].done = i;
+    reader.leave(level);
+  }
+
+  template<>
+  struct StructVisitor<IncrementalDeserialize> {
+    const char* name;
+    IncrementalDeserialize& reader;
+    size_t level;
+    size_t next_field = 0;
+
+    StructVisitor(const char* name_, IncrementalDeserialize& reader_)
+      : name(name_), reader(reader_), level(reader.enter()) {}
+    StructVisitor(const StructVisitor&) = delete;
+    StructVisitor& operator = (const StructVisitor&) = delete;
+    ~StructVisitor() { reader.leave(level); }
+
+    template<typename T>
+    StructVisitor& field(const char* label, T& value) {
+      size_t index = next_field++;
+      // Fields that were done in an earlier feed() are skipped
+      if (stopped(reader) || index < reader.progress[level].done) { return *this; }
+      visit(reader, value);
+      reader.errors.note_field(label, false);
+      if (!stopped(reader)) { reader.progress[level].done = index + 1; }
+      return *this;
+    }
+  };
+}
+
+
+#endif
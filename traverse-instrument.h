@@ -0,0 +1,276 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+/**
+ * Count where the bytes and the time go, per struct and per field,
+ * while any visitor (BinarySerialize, BufferDeserialize,
+ * RapidJsonWriter, ...) works on an object. Compile with
+ * -DTRAVERSE_INSTRUMENT to turn it on; it has to be defined before
+ * traverse.h is included, in every file, since it changes what
+ * TRAVERSE_STRUCT generates. Without it, the structs are visited the
+ * same as before, and a Profile stays empty.
+ *
+ * Example usage:
+ *
+ *     traverse::Profile profile;
+ *     traverse::BinarySerialize writer(buf);
+ *     traverse::visit_profiled(profile, writer, message);
+ *     std::cout << profile.report();
+ *
+ * For each struct, and for each field of a struct, the Profile has
+ * the number of visits, the bytes written or read, and, with timing
+ * set, the time taken. Bytes come from the visitor's input_offset()
+ * or output_offset(); visitors without either only get calls and
+ * time. The bytes and time of a field include the structs inside it,
+ * so Polygon.points includes all of its Point lines.
+ *
+ * The counts are kept for the Profile that's active on the thread,
+ * set with a Profiling object (as visit_profiled() does). Use one
+ * Profile per thread.
+ *
+ * While a Profile is active, structs that only hold numbers are
+ * visited a field at a time instead of all at once with
+ * visit_fixed(), so that each field is counted. In columnar mode,
+ * each field's line is for its whole column.
+ */
+
+#ifndef TRAVERSE_INSTRUMENT_H
+#define TRAVERSE_INSTRUMENT_H
+
+#include "traverse.h"
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace traverse {
+
+  /* The time is in cycles where the processor has a cycle counter
+   * that's cheap to read, and in nanoseconds elsewhere. */
+#if defined(__x86_64__) || defined(__i386__)
+  constexpr const char* profile_time_unit = "cycles";
+  inline uint64_t profile_clock() { return __rdtsc(); }
+#else
+  constexpr const char* profile_time_unit = "ns";
+  inline uint64_t profile_clock() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+  }
+#endif
+
+  /** The Profile keeps the counts for each struct name and field
+   *  label. The struct's own line has an empty field label.
+   */
+  struct Profile {
+    struct Counters {
+      uint64_t calls = 0;
+      uint64_t bytes = 0;
+      uint64_t time = 0;
+    };
+
+    struct Line {
+      std::string_view type;
+      std::string_view field;
+      Counters counters;
+    };
+
+    bool timing = false; // reading the clock isn't free, so it's optional
+
+    // The names are string literals from TRAVERSE_STRUCT, so they're
+    // looked up by address; lines() merges names that are the same
+    struct Key {
+      const char* type;
+      const char* field;
+      bool operator == (const Key& other) const { return type == other.type && field == other.field; }
+    };
+    struct KeyHash {
+      size_t operator () (const Key& key) const {
+        return std::hash<const void*>{}(key.type) * 31 + std::hash<const void*>{}(key.field);
+      }
+    };
+    std::unordered_map<Key, Counters, KeyHash> counters;
+
+    void add(const char* type, const char* field, uint64_t start_offset, uint64_t end_offset, uint64_t time) {
+      Counters& line = counters[Key{type, field}];
+      line.calls++;
+      if (start_offset != ErrorLog::unknown_offset && end_offset != ErrorLog::unknown_offset) {
+        line.bytes += end_offset - start_offset;
+      }
+      line.time += time;
+    }
+
+    void clear() { counters.clear(); }
+
+    // The counts for one struct (with no field label) or one field
+    Counters get(std::string_view type, std::string_view field = "") const {
+      Counters total;
+      for (const auto& [key, line] : counters) {
+        if (key.type == type && key.field == field) {
+          total.calls += line.calls;
+          total.bytes += line.bytes;
+          total.time += line.time;
+        }
+      }
+      return total;
+    }
+
+    // Each struct, with the most bytes first, followed by its fields, in the same order
+    std::vector<Line> lines() const {
+      std::map<std::pair<std::string_view, std::string_view>, Counters> merged;
+      for (const auto& [key, line] : counters) {
+        Counters& total = merged[{key.type, key.field}];
+        total.calls += line.calls;
+        total.bytes += line.bytes;
+        total.time += line.time;
+      }
+      std::vector<Line> result;
+      for (const auto& [key, total] : merged) {
+        result.push_back(Line{key.first, key.second, total});
+      }
+      auto struct_bytes = [&merged](std::string_view type) {
+        auto i = merged.find({type, ""});
+        return i == merged.end() ? 0 : i->second.bytes;
+      };
+      std::stable_sort(result.begin(), result.end(),
+                       [&struct_bytes](const Line& a, const Line& b) {
+                         if (a.type != b.type) {
+                           uint64_t a_bytes = struct_bytes(a.type), b_bytes = struct_bytes(b.type);
+                           if (a_bytes != b_bytes) { return a_bytes > b_bytes; }
+                           return a.type < b.type;
+                         }
+                         if (a.field.empty() != b.field.empty()) { return a.field.empty(); }
+                         return a.counters.bytes > b.counters.bytes;
+                       });
+      return result;
+    }
+
+    // A table with one line per struct or field
+    std::string report() const {
+      std::ostringstream out;
+      out << std::left << std::setw(32) << "struct.field"
+          << std::right << std::setw(12) << "calls" << std::setw(14) << "bytes";
+      if (timing) { out << std::setw(16) << profile_time_unit; }
+      out << '\n';
+      for (const Line& line : lines()) {
+        std::string name(line.type);
+        if (!line.field.empty()) { name = "  ." + std::string(line.field); }
+        out << std::left << std::setw(32) << name
+            << std::right << std::setw(12) << line.counters.calls << std::setw(14) << line.counters.bytes;
+        if (timing) { out << std::setw(16) << line.counters.time; }
+        out << '\n';
+      }
+      return out.str();
+    }
+
+    // A JSON array with an object per struct or field. The names are
+    // C++ identifiers, so they don't need escaping.
+    std::string json() const {
+      std::ostringstream out;
+      out << '[';
+      bool first = true;
+      for (const Line& line : lines()) {
+        if (!first) { out << ','; }
+        first = false;
+        out << "{\"struct\":\"" << line.type << "\",\"field\":\"" << line.field
+            << "\",\"calls\":" << line.counters.calls << ",\"bytes\":" << line.counters.bytes;
+        if (timing) { out << ",\"" << profile_time_unit << "\":" << line.counters.time; }
+        out << '}';
+      }
+      out << ']';
+      return out.str();
+    }
+  };
+
+  // The Profile that visits on this thread are counted in, if any
+  inline thread_local Profile* active_profile = nullptr;
+
+  /** While a Profiling object is alive, visits on its thread are
+   *  counted in its Profile. They can be nested; the previous Profile
+   *  is active again when the inner one goes away.
+   */
+  struct Profiling {
+    Profile* previous;
+    Profiling(Profile& profile): previous(std::exchange(active_profile, &profile)) {}
+    Profiling(const Profiling&) = delete;
+    Profiling& operator = (const Profiling&) = delete;
+    ~Profiling() { active_profile = previous; }
+  };
+
+  template<typename Visitor, typename T>
+  void visit_profiled(Profile& profile, Visitor& visitor, T& obj) {
+    Profiling profiling(profile);
+    visit(visitor, obj);
+  }
+
+  // How far into its input or output the visitor is, if it can tell
+  template<typename Visitor>
+  uint64_t visitor_offset(Visitor& visitor) {
+    if constexpr (requires { input_offset(visitor); }) {
+      return input_offset(visitor);
+    } else if constexpr (requires { output_offset(visitor); }) {
+      return output_offset(visitor);
+    } else {
+      return ErrorLog::unknown_offset;
+    }
+  }
+
+  /* TRAVERSE_STRUCT puts a StructProbe around each struct's visit,
+   * so its line in the Profile includes the end of the struct, such
+   * as the closing brace of a JSON object. */
+  template<typename Visitor>
+  struct StructProbe {
+    Profile* profile;
+    const char* name;
+    Visitor& visitor;
+    uint64_t offset = 0;
+    uint64_t start = 0;
+
+    StructProbe(const char* name_, Visitor& visitor_)
+      : profile(active_profile), name(name_), visitor(visitor_) {
+      if (!profile) { return; }
+      offset = visitor_offset(visitor);
+      if (profile->timing) { start = profile_clock(); }
+    }
+    StructProbe(const StructProbe&) = delete;
+    StructProbe& operator = (const StructProbe&) = delete;
+    ~StructProbe() {
+      if (!profile) { return; }
+      uint64_t time = profile->timing ? profile_clock() - start : 0;
+      profile->add(name, "", offset, visitor_offset(visitor), time);
+    }
+  };
+
+  /* TRAVERSE_STRUCT passes each field to an InstrumentedFields,
+   * which passes it on to the visitor's own StructVisitor. */
+  template<typename Visitor, typename Inner>
+  struct InstrumentedFields {
+    const char* name;
+    Visitor& visitor;
+    Inner& inner;
+    Profile* profile;
+
+    template<typename T>
+    InstrumentedFields& field(const char* label, T& value) {
+      if (!profile) {
+        inner.field(label, value);
+        return *this;
+      }
+      uint64_t offset = visitor_offset(visitor);
+      uint64_t start = profile->timing ? profile_clock() : 0;
+      inner.field(label, value);
+      uint64_t time = profile->timing ? profile_clock() - start : 0;
+      profile->add(name, label, offset, visitor_offset(visitor), time);
+      return *this;
+    }
+  };
+
+  // The StructVisitor lives until the end of the TRAVERSE_STRUCT statement
+  template<typename Visitor, typename Inner>
+  InstrumentedFields<Visitor, Inner> instrument_fields(const char* name, Visitor& visitor, Inner&& inner) {
+    return InstrumentedFields<Visitor, Inner>{name, visitor, inner, active_profile};
+  }
+}
+
+
+#endif
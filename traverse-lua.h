@@ -54,12 +54,13 @@ namespace traverse {
     visit(writer, typename std::underlying_type<T>::type(value));
   }
 
-  inline void visit(LuaWriter& writer, const std::string& string) {
+  template<typename Allocator>
+  void visit(LuaWriter& writer, const std::basic_string<char, std::char_traits<char>, Allocator>& string) {
     lua_pushlstring(writer.L, string.data(), string.size());
   }
 
-  template<typename Element>
-  void visit(LuaWriter& writer, const std::vector<Element>& vector) {
+  template<typename Element, typename Allocator>
+  void visit(LuaWriter& writer, const std::vector<Element, Allocator>& vector) {
     lua_createtable(writer.L, vector.size(), 0);
     for (size_t i = 0; i != vector.size(); i++) {
       visit(writer, vector[i]);
@@ -67,19 +68,103 @@ namespace traverse {
     }
   }
   
+  // An optional value or pointer is nil when there's no value
+  template<typename T>
+  void visit(LuaWriter& writer, const std::optional<T>& value) {
+    if (value) { visit(writer, *value); }
+    else { lua_pushnil(writer.L); }
+  }
+
+  template<typename T>
+  void visit(LuaWriter& writer, const std::unique_ptr<T>& pointer) {
+    if (pointer) { visit(writer, *pointer); }
+    else { lua_pushnil(writer.L); }
+  }
+
+  template<typename Element, size_t N>
+  void visit(LuaWriter& writer, const std::array<Element, N>& array) {
+    lua_createtable(writer.L, N, 0);
+    for (size_t i = 0; i != N; i++) {
+      visit(writer, array[i]);
+      lua_rawseti(writer.L, -2, i+1);
+    }
+  }
+
+  // Map keys become table keys, so they should be strings or numbers
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map>>
+  visit(LuaWriter& writer, const Map& map) {
+    lua_createtable(writer.L, 0, map.size());
+    for (const auto& [key, value] : map) {
+      visit(writer, key);
+      visit(writer, value);
+      lua_rawset(writer.L, -3);
+    }
+  }
+
+  // Variants are written as a table {which = ___, data = ___}
+  template<typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType>>
+  visit(LuaWriter& writer, VariantType& value) {
+    using Traits = VariantTraits<std::remove_const_t<VariantType>>;
+    lua_createtable(writer.L, 0, 2);
+    visit(writer, unsigned(Traits::index(value)));
+    lua_setfield(writer.L, -2, "which");
+    Traits::apply([&](const auto& alternative) { visit(writer, alternative); }, value);
+    lua_setfield(writer.L, -2, "data");
+  }
+
+  /* Push a Lua array of the struct's field names. It's made once per
+   * struct type and kept in the registry, keyed by the FieldTable's
+   * address, so that the names are hashed and interned by Lua only
+   * once instead of once per field per object. */
+  inline void push_field_names(lua_State* L, const FieldTable& fields) {
+    lua_rawgetp(L, LUA_REGISTRYINDEX, &fields); // stack: ... names?
+    if (lua_istable(L, -1)) { return; }
+    lua_pop(L, 1);                              // stack: ...
+    lua_createtable(L, fields.size(), 0);       // stack: ... names
+    for (size_t i = 0; i != fields.size(); i++) {
+      lua_pushlstring(L, fields.names[i].data(), fields.names[i].size());
+      lua_rawseti(L, -2, i+1);
+    }
+    lua_pushvalue(L, -1);                       // stack: ... names names
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &fields); // stack: ... names
+  }
+
   template<>
   struct StructVisitor<LuaWriter> {
     const char* name;
     LuaWriter& writer;
+    bool cached_names = false;
+    size_t next_field = 0;
     
     StructVisitor(const char* name_, LuaWriter& writer_)
       : name(name_), writer(writer_) {
       lua_newtable(writer.L);
     }
+
+    // With the field table, the Lua table is made with room for all
+    // the fields, and the keys come from the cached names, which stay
+    // on the stack below the output until the struct is done
+    StructVisitor(const char* name_, LuaWriter& writer_, const FieldTable& fields)
+      : name(name_), writer(writer_), cached_names(true) {
+      push_field_names(writer.L, fields);           // stack: ... names
+      lua_createtable(writer.L, 0, fields.size());  // stack: ... names output
+    }
+
+    ~StructVisitor() {
+      if (cached_names) {
+        lua_remove(writer.L, -2);                   // stack: ... output
+      }
+    }
     
     template<typename T>
     StructVisitor& field(const char* label, const T& value) {
-      lua_pushstring(writer.L, label);
+      if (cached_names) {
+        lua_rawgeti(writer.L, -2, ++next_field);    // stack: ... names output label
+      } else {
+        lua_pushstring(writer.L, label);
+      }
       visit(writer, value);
       lua_rawset(writer.L, -3);
       return *this;
@@ -117,14 +202,19 @@ namespace traverse {
    *      struct, or if the Lua table has a negative or non-contiguous index
    *      when converting to a C++ vector, or if the Lua table has a non-numeric
    *      index when converting to a C++ vector, ignore that field/entry.
+   *
+   * Set resource to read std::pmr containers into a memory_resource;
+   * see use_resource() in traverse.h.
    */
   struct LuaReader {
     lua_State* L;
-    std::ostream& errors;
+    ErrorSink errors;
     
     bool ignore_wrong_type = false;
     bool ignore_missing_field = false;
     bool ignore_extra_field = false;
+
+    std::pmr::memory_resource* resource = nullptr;
   };
 
   template<typename T> inline
@@ -132,7 +222,7 @@ namespace traverse {
   visit(LuaReader& reader, T& value) {
     if (lua_type(reader.L, -1) != LUA_TNUMBER) {
       if (!reader.ignore_wrong_type) {
-        reader.errors << "Error: expected Lua number; skipping" << std::endl;
+        reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Error: expected Lua number; skipping" << std::endl;
       }
       lua_pop(reader.L, 1);
       return;
@@ -149,15 +239,16 @@ namespace traverse {
   template<typename T> inline
   typename std::enable_if<std::is_enum<T>::value, void>::type
   visit(LuaReader& reader, T& value) {
-    typename std::underlying_type<T>::type v;
+    auto v = typename std::underlying_type<T>::type(value);
     visit(reader, v);
     value = T(v);
   }
   
-  inline void visit(LuaReader& reader, std::string& string) {
+  template<typename Allocator>
+  void visit(LuaReader& reader, std::basic_string<char, std::char_traits<char>, Allocator>& string) {
     if (lua_type(reader.L, -1) != LUA_TSTRING) {
       if (!reader.ignore_wrong_type) {
-        reader.errors << "Error: expected Lua string; skipping" << std::endl;
+        reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Error: expected Lua string; skipping" << std::endl;
       }
       lua_pop(reader.L, 1);
       return;
@@ -165,15 +256,16 @@ namespace traverse {
 
     size_t size;
     const char* data = lua_tolstring(reader.L, -1, &size);
-    string = std::string(data, size);
+    use_resource(string, reader.resource);
+    string.assign(data, size);
     lua_pop(reader.L, 1);
   }
 
-  template<typename Element>
-  void visit(LuaReader& reader, std::vector<Element>& vector) {
+  template<typename Element, typename Allocator>
+  void visit(LuaReader& reader, std::vector<Element, Allocator>& vector) {
     if (!lua_istable(reader.L, -1)) {
       if (!reader.ignore_wrong_type) {
-        reader.errors << "Error: expected Lua array(table); skipping" << std::endl;
+        reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Error: expected Lua array(table); skipping" << std::endl;
       }
       lua_pop(reader.L, 1);
       return;
@@ -183,6 +275,7 @@ namespace traverse {
     lua_len(reader.L, -1);      // stack: ... input size
     visit(reader, size);        // stack: ... input
     
+    use_resource(vector, reader.resource);
     vector.resize(size);
     for (size_t i = 0; i < size; i++) {
       lua_rawgeti(reader.L, -1, i+1); // stack: ... input input[i+1]
@@ -194,14 +287,14 @@ namespace traverse {
     while (lua_next(reader.L, -2)) { // stack: ... input key value
       if (lua_type(reader.L, -2) != LUA_TNUMBER) {
         if (!reader.ignore_extra_field) {
-          reader.errors << "Error: converting Lua table to std::vector, found non-numeric key"
+          reader.errors.error(ErrorCode::BAD_VALUE) << "Error: converting Lua table to std::vector, found non-numeric key"
                         << std::endl;
         }
       } else {
         lua_Number index = lua_tointeger(reader.L, -2);
         if (index < 1 || index > size) {
           if (!reader.ignore_extra_field) {
-            reader.errors << "Error: converting Lua table size=" << size
+            reader.errors.error(ErrorCode::BAD_VALUE) << "Error: converting Lua table size=" << size
                           << " to std::vector, found key=" << index
                           << std::endl;
           }
@@ -215,18 +308,132 @@ namespace traverse {
     lua_pop(reader.L, 1);
   }
 
+  template<typename T>
+  void visit(LuaReader& reader, std::optional<T>& value) {
+    if (lua_isnil(reader.L, -1)) {
+      value.reset();
+      lua_pop(reader.L, 1);
+      return;
+    }
+    if (!value) { value.emplace(); }
+    visit(reader, *value);
+  }
+
+  template<typename T>
+  void visit(LuaReader& reader, std::unique_ptr<T>& pointer) {
+    if (lua_isnil(reader.L, -1)) {
+      pointer.reset();
+      lua_pop(reader.L, 1);
+      return;
+    }
+    if (!pointer) { pointer = std::make_unique<T>(); }
+    visit(reader, *pointer);
+  }
+
+  template<typename Element, size_t N>
+  void visit(LuaReader& reader, std::array<Element, N>& array) {
+    if (!lua_istable(reader.L, -1)) {
+      if (!reader.ignore_wrong_type) {
+        reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Error: expected Lua array(table); skipping" << std::endl;
+      }
+      lua_pop(reader.L, 1);
+      return;
+    }
+
+    size_t size;                // stack: ... input
+    lua_len(reader.L, -1);      // stack: ... input size
+    visit(reader, size);        // stack: ... input
+    if (size != N && !reader.ignore_extra_field) {
+      reader.errors.error(ErrorCode::BAD_VALUE) << "Error: converting Lua table size=" << size
+                    << " to std::array of size " << N << std::endl;
+    }
+    for (size_t i = 0; i < N && i < size; i++) {
+      lua_rawgeti(reader.L, -1, i+1); // stack: ... input input[i+1]
+      visit(reader, array[i]);        // stack: ... input
+    }
+    lua_pop(reader.L, 1);
+  }
+
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map> && !std::is_const_v<Map>>
+  visit(LuaReader& reader, Map& map) {
+    if (!lua_istable(reader.L, -1)) {
+      if (!reader.ignore_wrong_type) {
+        reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Error: expected Lua table; skipping" << std::endl;
+      }
+      lua_pop(reader.L, 1);
+      return;
+    }
+
+    use_resource(map, reader.resource);
+    map.clear();
+    lua_pushnil(reader.L);      // stack: ... input nil
+    while (lua_next(reader.L, -2)) { // stack: ... input key value
+      typename Map::key_type key{};
+      typename Map::mapped_type value{};
+      lua_pushvalue(reader.L, -2); // stack: ... input key value key
+      visit(reader, key);       // stack: ... input key value
+      visit(reader, value);     // stack: ... input key
+      map.emplace(std::move(key), std::move(value));
+    }                           // stack: ... input
+    lua_pop(reader.L, 1);
+  }
+
+  template<typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType> && !std::is_const_v<VariantType>>
+  visit(LuaReader& reader, VariantType& value) {
+    if (!lua_istable(reader.L, -1)) {
+      if (!reader.ignore_wrong_type) {
+        reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Error: expected Lua table for variant; skipping" << std::endl;
+      }
+      lua_pop(reader.L, 1);
+      return;
+    }
+
+    unsigned which = 0;
+    lua_getfield(reader.L, -1, "which"); // stack: ... input input.which
+    visit(reader, which);                // stack: ... input
+    lua_getfield(reader.L, -1, "data");  // stack: ... input input.data
+    if (!visit_alternative(reader, value, which)) {
+      reader.errors.error(ErrorCode::BAD_VALUE) << "Error: tried to read variant " << which
+                    << " but there were only " << VariantTraits<VariantType>::size << " types."
+                    << std::endl;
+      lua_pop(reader.L, 1);
+    }                                    // stack: ... input
+    lua_pop(reader.L, 1);
+  }
+
+  // An empty optional or pointer is written as nil, which looks the
+  // same as a missing field
+  template<typename T>
+  struct is_nullable : std::false_type {};
+
+  template<typename T>
+  struct is_nullable<std::optional<T>> : std::true_type {};
+
+  template<typename T>
+  struct is_nullable<std::unique_ptr<T>> : std::true_type {};
+
   template<>
   struct StructVisitor<LuaReader> {
     const char* name;
     LuaReader& reader;
-    std::vector<std::string> lua_field_names;
+    const FieldTable* fields = nullptr;
+    std::vector<std::string> lua_field_names; // without the field table
+    FieldSlots<bool> present;                 // with the field table
+    size_t extra_fields = 0;
+    size_t next_field = 0;
     bool is_table;
     
-    StructVisitor(const char* name_, LuaReader& reader_)
-      : name(name_), reader(reader_) {
+    StructVisitor(const char* name_, LuaReader& reader_, const FieldTable& fields_)
+      : StructVisitor(name_, reader_, &fields_) {}
+
+    StructVisitor(const char* name_, LuaReader& reader_, const FieldTable* fields_ = nullptr)
+      : name(name_), reader(reader_), fields(fields_),
+        present(fields_ != nullptr? fields_->size() : 0) {
       if (!lua_istable(reader.L, -1)) {
         if (!reader.ignore_wrong_type) {
-          reader.errors << "Error: expected Lua object(table) to read into struct "
+          reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Error: expected Lua object(table) to read into struct "
                         << name << "; skipping" << std::endl;
         }
         is_table = false;
@@ -236,29 +443,61 @@ namespace traverse {
       
       // Iterate through the table to find all the string keys; this
       // is used for generating warnings about fields that weren't
-      // transferred to the C++ side
+      // transferred to the C++ side. With the field table, this
+      // marks which fields are present and counts the other keys,
+      // without allocating; the destructor looks for the names of
+      // the other keys only if there are any.
       lua_pushnil(reader.L);    // stack: ... input nil
       while (lua_next(reader.L, -2)) { // stack: ... input key value
         if (lua_type(reader.L, -2) != LUA_TSTRING) {
           if (!reader.ignore_extra_field) {
-            reader.errors << "Error: converting Lua table to " << name
+            reader.errors.error(ErrorCode::BAD_VALUE) << "Error: converting Lua table to " << name
                           << ", found non-string key"
                           << std::endl;
           }
         } else {
           size_t size = 0;
           const char* field = lua_tolstring(reader.L, -2, &size);
-          lua_field_names.push_back(std::string(field, size));
+          if (fields == nullptr) {
+            lua_field_names.push_back(std::string(field, size));
+          } else {
+            size_t index = fields->find(std::string_view(field, size));
+            if (index != FieldTable::npos) {
+              present[index] = true;
+            } else {
+              extra_fields++;
+            }
+          }
         }
         lua_pop(reader.L, 1);   // stack: ... input key
       }                         // stack: ... input
+
+      if (fields != nullptr) {
+        push_field_names(reader.L, *fields); // stack: ... input names
+      }
     }
 
     ~StructVisitor() {
+      if (is_table && fields != nullptr) {
+        lua_pop(reader.L, 1);   // stack: ... input
+        if (!reader.ignore_extra_field && extra_fields > 0) {
+          reader.errors.error(ErrorCode::EXTRA_FIELD) << "Error: Lua object contains extra keys: ";
+          lua_pushnil(reader.L);           // stack: ... input nil
+          while (lua_next(reader.L, -2)) { // stack: ... input key value
+            size_t size = 0;
+            const char* field = lua_type(reader.L, -2) == LUA_TSTRING? lua_tolstring(reader.L, -2, &size) : nullptr;
+            if (field != nullptr && fields->find(std::string_view(field, size)) == FieldTable::npos) {
+              reader.errors << std::string_view(field, size) << ' ';
+            }
+            lua_pop(reader.L, 1);          // stack: ... input key
+          }                                // stack: ... input
+          reader.errors << std::endl;
+        }
+      }
       lua_pop(reader.L, 1);     // stack: ...
 
       if (!reader.ignore_extra_field && !lua_field_names.empty()) {
-        reader.errors << "Error: Lua object contains extra keys: ";
+        reader.errors.error(ErrorCode::EXTRA_FIELD) << "Error: Lua object contains extra keys: ";
         for (auto field : lua_field_names) {
           reader.errors << field << ' ';
         }
@@ -270,25 +509,44 @@ namespace traverse {
     StructVisitor& field(const char* label, T& value) {
       if (!is_table) { return *this; }
       
-      lua_getfield(reader.L, -1, label); // stack: ... input input[label]
-      if (lua_isnil(reader.L, -1)) {
+      bool failed = reader.errors.failed();
+      bool found;
+      if (fields != nullptr) {
+        size_t index = next_field++;
+        found = present[index];
+        if (found) {
+          lua_rawgeti(reader.L, -1, index+1); // stack: ... input names label
+          lua_rawget(reader.L, -3);           // stack: ... input names input[label]
+        } else {
+          lua_pushnil(reader.L);              // stack: ... input names nil
+        }
+      } else {
+        lua_getfield(reader.L, -1, label);    // stack: ... input input[label]
+        found = !lua_isnil(reader.L, -1);
+      }
+
+      // The names are on the stack only when there's a field table
+      if (!found && is_nullable<T>::value) {
+        visit(reader, value);   // stack: ... input (names)
+      } else if (!found) {
         if (!reader.ignore_missing_field) {
-          reader.errors << "Error: Lua object missing field " << label << std::endl;
+          reader.errors.error(ErrorCode::MISSING_FIELD) << "Error: Lua object missing field " << label << std::endl;
         }
-        lua_pop(reader.L, 1);   // stack: ... input
+        lua_pop(reader.L, 1);   // stack: ... input (names)
       } else {
-        if (!reader.ignore_extra_field) {
+        if (!reader.ignore_extra_field && fields == nullptr) {
           // To detect this error, we need to track which fields were used
           auto it = find(lua_field_names.begin(), lua_field_names.end(), label);
           if (it == lua_field_names.end()) {
-            reader.errors << "Error: lua table lost field during traverse" << std::endl;
+            reader.errors.error(ErrorCode::BAD_VALUE) << "Error: lua table lost field during traverse" << std::endl;
           } else {
             std::swap(*it, lua_field_names.back());
             lua_field_names.pop_back();
           }
         }
-        visit(reader, value);   // stack: ... input
+        visit(reader, value);   // stack: ... input (names)
       }
+      reader.errors.note_field(label, failed);
       return *this;
     }
   };
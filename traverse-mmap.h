@@ -0,0 +1,148 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+/**
+ * Read a file in the BinarySerialize format by mapping it into
+ * memory instead of reading it through a streambuf. The mapped file
+ * is a contiguous block of memory, so it can be decoded with the
+ * BufferDeserialize from traverse-buffer.h, and pages are read
+ * from disk only when they're touched. This uses mmap, so it's for
+ * POSIX systems only.
+ *
+ * Example usage for a file with one object:
+ *
+ *     traverse::MappedBinaryDeserialize reader("assets.bin");
+ *     visit(reader.in, yourobject);
+ *     if (!reader.Errors().empty()) { throw "read error"; }
+ *
+ * Example usage for a file with a batch of records (see traverse-batch.h):
+ *
+ *     traverse::MappedBinaryDeserialize reader("archive.bin");
+ *     traverse::BatchReader batch = reader.batch();
+ *     if (!batch.Errors().empty()) { throw "bad framing"; }
+ *     batch.read(i, record); // any record, in any order
+ *
+ * The string_view and span fields read by reader.in (or the batch)
+ * point into the mapped file, without copying, so they're only valid
+ * while the reader is alive.
+ */
+
+#ifndef TRAVERSE_MMAP_H
+#define TRAVERSE_MMAP_H
+
+#include "traverse.h"
+#include "traverse-buffer.h"
+#include "traverse-batch.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace traverse {
+
+  /* How the mapped file will be read, so that the kernel can read
+   * ahead (SEQUENTIAL) or not (RANDOM) */
+  enum class MappedAccess { NORMAL, SEQUENTIAL, RANDOM };
+
+  /** The MappedFile maps a whole file read-only, and unmaps it in
+   *  the destructor. If the file can't be opened or mapped, the
+   *  problem is in Errors() and the data is empty. An empty file
+   *  gives empty data with no error.
+   */
+  struct MappedFile {
+    const uint8_t* start = nullptr;
+    size_t length = 0;
+    ErrorLog errors;
+
+    MappedFile(const std::string& path, MappedAccess access = MappedAccess::SEQUENTIAL) {
+      int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+        errors.error(ErrorCode::FILE_ERROR) << "Error: can't open " << path << ": " << std::strerror(errno) << "\n";
+        return;
+      }
+      struct stat info;
+      if (::fstat(fd, &info) != 0) {
+        errors.error(ErrorCode::FILE_ERROR) << "Error: can't get size of " << path << ": " << std::strerror(errno) << "\n";
+      } else if (!S_ISREG(info.st_mode)) {
+        errors.error(ErrorCode::FILE_ERROR) << "Error: " << path << " is not a regular file\n";
+      } else if (info.st_size > 0) {
+        // mmap can't map 0 bytes, so an empty file stays unmapped
+        void* mapping = ::mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+          errors.error(ErrorCode::FILE_ERROR) << "Error: can't map " << path << ": " << std::strerror(errno) << "\n";
+        } else {
+          start = static_cast<const uint8_t*>(mapping);
+          length = size_t(info.st_size);
+          advise(access);
+        }
+      }
+      // The mapping stays valid after the file is closed
+      ::close(fd);
+    }
+    MappedFile(MappedFile&& other) noexcept
+      : start(std::exchange(other.start, nullptr)),
+        length(std::exchange(other.length, 0)),
+        errors(std::move(other.errors)) {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+    ~MappedFile() {
+      if (start != nullptr) { ::munmap(const_cast<uint8_t*>(start), length); }
+    }
+
+    std::string Errors() { return errors.str(); }
+
+    const uint8_t* data() const { return start; }
+    size_t size() const { return length; }
+
+    // Change the read ahead hint; it's only a hint, so errors are ignored
+    void advise(MappedAccess access) {
+      if (start == nullptr) { return; }
+      int advice = access == MappedAccess::SEQUENTIAL ? MADV_SEQUENTIAL
+                 : access == MappedAccess::RANDOM ? MADV_RANDOM
+                 : MADV_NORMAL;
+      ::madvise(const_cast<uint8_t*>(start), length, advice);
+    }
+  };
+
+  /** The MappedBinaryDeserialize maps a file and decodes it with a
+   *  BufferDeserialize, in. Set the limits and flags on in; see
+   *  traverse-buffer.h. An error opening the file is the first error
+   *  in in.errors.
+   */
+  struct MappedBinaryDeserialize {
+    MappedFile file;
+    BufferDeserialize in;
+
+    MappedBinaryDeserialize(const std::string& path, MappedAccess access = MappedAccess::SEQUENTIAL)
+      : file(path, access), in(file.data(), file.size()) {
+      in.errors.append(file.errors);
+    }
+
+    std::string Errors() { return in.errors.str(); }
+    size_t remaining() const { return in.remaining(); }
+
+    // The records of a batch stored in the file, found by the batch's
+    // index without decoding them. The limits and flags set on in are
+    // used for decoding the records. Records are usually read out of
+    // order, so this turns off read ahead.
+    BatchReader batch(BatchFormat format = BatchFormat::INDEXED) {
+      file.advise(MappedAccess::RANDOM);
+      BatchReader reader(file.data(), file.size(), format);
+      // Not being able to map the file was the first problem
+      if (file.errors.failed()) { reader.errors = file.errors; }
+      reader.max_elements = in.max_elements;
+      reader.max_bytes = in.max_bytes;
+      reader.update_in_place = in.update_in_place;
+      reader.fail_fast = in.fail_fast;
+      reader.columnar = in.columnar;
+      reader.resource = in.resource;
+      return reader;
+    }
+  };
+}
+
+
+#endif
@@ -0,0 +1,176 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+/**
+ * Decode the records of a batch (see traverse-batch.h) on several
+ * threads. Each record is decoded by its own BufferDeserialize, so
+ * the threads share nothing but the input. Compile with -pthread.
+ *
+ * Example usage:
+ *
+ *     traverse::BatchReader batch(bytes);
+ *     std::vector<Message> messages;
+ *     if (!traverse::parallel_deserialize(batch, messages)) {
+ *       throw batch.Errors();
+ *     }
+ *
+ * The threads take records in chunks from a shared counter, so a
+ * thread that gets small records goes back for more instead of
+ * waiting for the others. Results are stored by record number, and
+ * errors are added to batch.Errors() in record order, so the output
+ * is the same as reading the records one at a time.
+ *
+ * If batch.resource is set, it's used from all the threads at once,
+ * so it has to be thread safe, like std::pmr::synchronized_pool_resource
+ * (and unlike std::pmr::monotonic_buffer_resource).
+ *
+ * It also writes the text of a large vector on several threads.
+ * parallel_text_dump(out, vector) writes the same text as a
+ * TextWriter (see traverse-text.h), with each thread formatting its
+ * own chunk of elements. parallel_write() does the same for any
+ * format, such as JSON:
+ *
+ *     out << '[';
+ *     traverse::parallel_write(out, messages.size(), [&](size_t i, std::string& text) {
+ *       rapidjson::StringBuffer json;
+ *       traverse::RapidJsonWriter writer(json);
+ *       visit(writer, messages[i]);
+ *       text.append(json.GetString(), json.GetSize());
+ *     }, ",");
+ *     out << ']';
+ */
+
+#ifndef TRAVERSE_PARALLEL_H
+#define TRAVERSE_PARALLEL_H
+
+#include "traverse-batch.h"
+#include "traverse-text.h"
+#include <atomic>
+#include <exception>
+#include <thread>
+
+namespace traverse {
+
+  /* Runs work(chunk) for each chunk from 0 to chunks - 1 on up to
+   * threads threads, including this one. The threads take chunks from
+   * a shared counter. An exception thrown by work() stops the other
+   * threads soon, and is rethrown here. */
+  template<typename Work>
+  void parallel_chunks(size_t chunks, unsigned threads, Work work) {
+    if (threads == 0) { threads = std::max(1u, std::thread::hardware_concurrency()); }
+    threads = unsigned(std::min<size_t>(threads, chunks));
+    std::atomic<size_t> next_chunk{0};
+    std::vector<std::exception_ptr> exceptions(threads);
+
+    auto run = [&](unsigned thread) {
+      try {
+        for (size_t chunk; (chunk = next_chunk.fetch_add(1, std::memory_order_relaxed)) < chunks; ) {
+          work(chunk);
+        }
+      } catch (...) {
+        exceptions[thread] = std::current_exception();
+        next_chunk = chunks; // stop the other threads soon
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned thread = 1; thread < threads; ++thread) {
+      workers.emplace_back(run, thread);
+    }
+    if (threads > 0) { run(0); }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    for (auto& exception : exceptions) {
+      if (exception) { std::rethrow_exception(exception); }
+    }
+  }
+
+  /** Decode every record of the batch into out, resized to the number
+   *  of records. threads = 0 uses one thread per core. Returns false
+   *  if any record had errors.
+   */
+  template<typename T, typename Allocator>
+  bool parallel_deserialize(BatchReader& batch, std::vector<T, Allocator>& out,
+                            unsigned threads = 0, size_t chunk_size = 256) {
+    const size_t count = batch.size();
+    if (!batch.update_in_place) { out.clear(); }
+    out.resize(count);
+    if (chunk_size == 0) { chunk_size = 1; }
+    const size_t chunks = (count + chunk_size - 1) / chunk_size;
+
+    // Each chunk's errors, so that they can be merged in order
+    std::vector<ErrorLog> chunk_errors(chunks);
+    parallel_chunks(chunks, threads, [&](size_t chunk) {
+      size_t end = std::min(count, (chunk + 1) * chunk_size);
+      for (size_t i = chunk * chunk_size; i < end; ++i) {
+        ErrorLog record_errors = batch.decode(i, out[i]);
+        if (!record_errors.empty()) {
+          chunk_errors[chunk].append(record_errors, "Record " + std::to_string(i) + ": ");
+        }
+      }
+    });
+
+    bool ok = true;
+    for (const auto& errors : chunk_errors) {
+      if (!errors.empty()) {
+        batch.errors.append(errors);
+        ok = false;
+      }
+    }
+    return ok;
+  }
+
+  /** Write the text of elements 0 to count - 1 to out, in order, with
+   *  separator between them. format(i, text) appends the text of
+   *  element i. The threads format a chunk of elements each into its
+   *  own string; after each round of chunks, this thread writes them
+   *  out in order, so only a round's text is kept in memory.
+   */
+  template<typename Format>
+  void parallel_write(std::ostream& out, size_t count, Format format, std::string_view separator = ", ",
+                      unsigned threads = 0, size_t chunk_size = 256) {
+    if (chunk_size == 0) { chunk_size = 1; }
+    if (threads == 0) { threads = std::max(1u, std::thread::hardware_concurrency()); }
+    const size_t chunks = (count + chunk_size - 1) / chunk_size;
+    const size_t round_size = 4 * size_t(threads);
+    std::vector<std::string> texts(std::min(chunks, round_size));
+    for (size_t first = 0; first < chunks; first += round_size) {
+      size_t round = std::min(round_size, chunks - first);
+      parallel_chunks(round, threads, [&](size_t chunk) {
+        std::string& text = texts[chunk];
+        text.clear();
+        size_t begin = (first + chunk) * chunk_size;
+        size_t end = std::min(count, begin + chunk_size);
+        for (size_t i = begin; i < end; ++i) {
+          if (i != 0) { text.append(separator); }
+          format(i, text);
+        }
+      });
+      for (size_t chunk = 0; chunk < round; ++chunk) {
+        out.write(texts[chunk].data(), std::streamsize(texts[chunk].size()));
+      }
+    }
+  }
+
+  /** Write the same text as a TextWriter would for the vector, with
+   *  its elements formatted on several threads.
+   */
+  template<typename T, typename Allocator>
+  void parallel_text_dump(std::ostream& out, const std::vector<T, Allocator>& vector,
+                          unsigned threads = 0, size_t chunk_size = 256) {
+    out << '[';
+    parallel_write(out, vector.size(), [&vector](size_t i, std::string& text) {
+      // The writer appends to the chunk's text
+      TextWriter writer;
+      writer.buffer.swap(text);
+      visit(writer, vector[i]);
+      writer.buffer.swap(text);
+    }, ", ", threads, chunk_size);
+    out << ']';
+  }
+}
+
+
+#endif
@@ -33,13 +33,22 @@
 namespace traverse {
 
   /** The PicoJsonWriter will take a value from C++ and write it into
-   *  a picojson object.
+   *  a picojson object. Arrays and objects are built in place in the
+   *  output, so each value is allocated once and never copied.
    */
   struct PicoJsonWriter {
     picojson::value& out;
     PicoJsonWriter(picojson::value& out_): out(out_) {}
   };
 
+  // Replace the output with an empty array or object and return it,
+  // so that the elements can be written straight into it
+  template<typename Container>
+  Container& emplace_output(PicoJsonWriter& writer) {
+    writer.out = picojson::value(Container());
+    return writer.out.get<Container>();
+  }
+
   template<typename T> inline
   typename std::enable_if<std::is_arithmetic<T>::value, void>::type
   visit(PicoJsonWriter& writer, const T& value) {
@@ -52,36 +61,95 @@ namespace traverse {
     visit(writer, typename std::underlying_type<T>::type(value));
   }
 
-  inline void visit(PicoJsonWriter& writer, const std::string& string) {
-    writer.out = picojson::value(string);
+  template<typename Allocator>
+  void visit(PicoJsonWriter& writer, const std::basic_string<char, std::char_traits<char>, Allocator>& string) {
+    writer.out = picojson::value(string.data(), string.size());
   }
   
-  template<typename Element>
-  void visit(PicoJsonWriter& writer, const std::vector<Element>& vector) {
-    picojson::value::array output;
-    for (auto element : vector) {
-      output.push_back(picojson::value());
+  template<typename Element, typename Allocator>
+  void visit(PicoJsonWriter& writer, const std::vector<Element, Allocator>& vector) {
+    auto& output = emplace_output<picojson::value::array>(writer);
+    output.reserve(vector.size());
+    for (const auto& element : vector) {
+      output.emplace_back();
       PicoJsonWriter element_writer{output.back()};
       visit(element_writer, element);
     }
-    writer.out = picojson::value(output);
+  }
+
+  // An optional value or pointer is null when there's no value
+  template<typename T>
+  void visit(PicoJsonWriter& writer, const std::optional<T>& value) {
+    if (value) { visit(writer, *value); }
+    else { writer.out = picojson::value(); }
+  }
+
+  template<typename T>
+  void visit(PicoJsonWriter& writer, const std::unique_ptr<T>& pointer) {
+    if (pointer) { visit(writer, *pointer); }
+    else { writer.out = picojson::value(); }
+  }
+
+  template<typename Element, size_t N>
+  void visit(PicoJsonWriter& writer, const std::array<Element, N>& array) {
+    auto& output = emplace_output<picojson::value::array>(writer);
+    output.reserve(N);
+    for (const auto& element : array) {
+      output.emplace_back();
+      PicoJsonWriter element_writer{output.back()};
+      visit(element_writer, element);
+    }
+  }
+
+  // A map with string keys is an object; other maps are an array of
+  // [key, value] arrays
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map>>
+  visit(PicoJsonWriter& writer, const Map& map) {
+    if constexpr (has_string_key_v<Map>) {
+      auto& output = emplace_output<picojson::value::object>(writer);
+      for (const auto& [key, value] : map) {
+        PicoJsonWriter value_writer{output[std::string(key.data(), key.size())]};
+        visit(value_writer, value);
+      }
+    } else {
+      auto& output = emplace_output<picojson::value::array>(writer);
+      output.reserve(map.size());
+      for (const auto& [key, value] : map) {
+        output.emplace_back(picojson::value::array(2));
+        auto& entry = output.back().get<picojson::value::array>();
+        PicoJsonWriter key_writer{entry[0]};
+        PicoJsonWriter value_writer{entry[1]};
+        visit(key_writer, key);
+        visit(value_writer, value);
+      }
+    }
+  }
+
+  // Variants are written as an object {which: ___, data: ___}
+  template<typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType>>
+  visit(PicoJsonWriter& writer, VariantType& value) {
+    using Traits = VariantTraits<std::remove_const_t<VariantType>>;
+    auto& output = emplace_output<picojson::value::object>(writer);
+    PicoJsonWriter writer_which = {output["which"]};
+    PicoJsonWriter writer_data = {output["data"]};
+    visit(writer_which, unsigned(Traits::index(value)));
+    Traits::apply([&](const auto& alternative) { visit(writer_data, alternative); }, value);
   }
 
   template<>
   struct StructVisitor<PicoJsonWriter> {
     const char* name;
     PicoJsonWriter& writer;
-    picojson::value::object output;
+    picojson::value::object& output;
     
     StructVisitor(const char* name_, PicoJsonWriter& writer_)
-      : name(name_), writer(writer_) {}
-    ~StructVisitor() {
-      writer.out = picojson::value(output);
-    }
+      : name(name_), writer(writer_),
+        output(emplace_output<picojson::value::object>(writer)) {}
     
     template<typename T>
     StructVisitor& field(const char* label, const T& value) {
-      output[label] = picojson::value();
       PicoJsonWriter field_writer{output[label]};
       visit(field_writer, value);
       return *this;
@@ -91,18 +159,20 @@ namespace traverse {
 
   /** The PicoJsonReader will take a picojson object and convert
    *  into a C++ object, leaving error messages in the user-supplied
-   *  error stream.
+   *  error stream. Set resource to read std::pmr containers into a
+   *  memory_resource; see use_resource() in traverse.h.
    */
   struct PicoJsonReader {
     const picojson::value& in;
-    std::ostream& errors;
+    ErrorSink errors;
+    std::pmr::memory_resource* resource = nullptr;
   };
 
   template<typename T> inline
   typename std::enable_if<std::is_arithmetic<T>::value, void>::type
   visit(PicoJsonReader& reader, T& value) {
     if (!reader.in.is<double>()) {
-      reader.errors << "Warning: expected JSON number; skipping" << std::endl;
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON number; skipping" << std::endl;
       return;
     }
     value = T(reader.in.get<double>());
@@ -111,66 +181,218 @@ namespace traverse {
   template<typename T> inline
   typename std::enable_if<std::is_enum<T>::value, void>::type
   visit(PicoJsonReader& reader, T& value) {
-    typename std::underlying_type<T>::type v;
+    auto v = typename std::underlying_type<T>::type(value);
     visit(reader, v);
     value = T(v);
   }
 
-  inline void visit(PicoJsonReader& reader, std::string& string) {
+  template<typename Allocator>
+  void visit(PicoJsonReader& reader, std::basic_string<char, std::char_traits<char>, Allocator>& string) {
     if (!reader.in.is<std::string>()) {
-      reader.errors << "Warning: expected JSON string; skipping" << std::endl;
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON string; skipping" << std::endl;
       return;
     }
-    string = reader.in.get<std::string>();
+    const std::string& input = reader.in.get<std::string>();
+    use_resource(string, reader.resource);
+    string.assign(input.data(), input.size());
   }
 
-  template<typename Element>
-  void visit(PicoJsonReader& reader, std::vector<Element>& vector) {
+  template<typename Element, typename Allocator>
+  void visit(PicoJsonReader& reader, std::vector<Element, Allocator>& vector) {
     if (!reader.in.is<picojson::value::array>()) {
-      reader.errors << "Warning: expected JSON array; skipping" << std::endl;
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON array; skipping" << std::endl;
       return;
     }
     
     const picojson::value::array& array = reader.in.get<picojson::value::array>();
+    use_resource(vector, reader.resource);
     vector.clear();
-    for (auto json_element : array) {
-      vector.push_back(Element());
-      PicoJsonReader element_reader{json_element, reader.errors};
+    for (const auto& json_element : array) {
+      vector.emplace_back();
+      PicoJsonReader element_reader{json_element, reader.errors, reader.resource};
       visit(element_reader, vector.back());
     }
   }
 
+  template<typename T>
+  void visit(PicoJsonReader& reader, std::optional<T>& value) {
+    if (reader.in.is<picojson::null>()) {
+      value.reset();
+      return;
+    }
+    if (!value) { value.emplace(); }
+    visit(reader, *value);
+  }
+
+  template<typename T>
+  void visit(PicoJsonReader& reader, std::unique_ptr<T>& pointer) {
+    if (reader.in.is<picojson::null>()) {
+      pointer.reset();
+      return;
+    }
+    if (!pointer) { pointer = std::make_unique<T>(); }
+    visit(reader, *pointer);
+  }
+
+  template<typename Element, size_t N>
+  void visit(PicoJsonReader& reader, std::array<Element, N>& array) {
+    if (!reader.in.is<picojson::value::array>()) {
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON array; skipping" << std::endl;
+      return;
+    }
+    const picojson::value::array& input = reader.in.get<picojson::value::array>();
+    if (input.size() != N) {
+      reader.errors.error(ErrorCode::BAD_VALUE) << "Warning: expected JSON array of size " << N
+                    << " but found " << input.size() << std::endl;
+    }
+    for (size_t i = 0; i < N && i < input.size(); ++i) {
+      PicoJsonReader element_reader{input[i], reader.errors, reader.resource};
+      visit(element_reader, array[i]);
+    }
+  }
+
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map> && !std::is_const_v<Map>>
+  visit(PicoJsonReader& reader, Map& map) {
+    if constexpr (has_string_key_v<Map>) {
+      if (!reader.in.is<picojson::value::object>()) {
+        reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON object; skipping" << std::endl;
+        return;
+      }
+      const picojson::value::object& input = reader.in.get<picojson::value::object>();
+      use_resource(map, reader.resource);
+      map.clear();
+      if constexpr (requires { map.reserve(size_t(0)); }) { map.reserve(input.size()); }
+      for (const auto& member : input) {
+        typename Map::mapped_type value{};
+        PicoJsonReader value_reader{member.second, reader.errors, reader.resource};
+        visit(value_reader, value);
+        map.emplace_hint(map.end(),
+                         typename Map::key_type(member.first.data(), member.first.size()),
+                         std::move(value));
+      }
+    } else {
+      if (!reader.in.is<picojson::value::array>()) {
+        reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON array of [key, value]; skipping" << std::endl;
+        return;
+      }
+      const picojson::value::array& input = reader.in.get<picojson::value::array>();
+      use_resource(map, reader.resource);
+      map.clear();
+      if constexpr (requires { map.reserve(size_t(0)); }) { map.reserve(input.size()); }
+      for (const auto& entry : input) {
+        if (!entry.is<picojson::value::array>() || entry.get<picojson::value::array>().size() != 2) {
+          reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON array of [key, value]; skipping" << std::endl;
+          continue;
+        }
+        const picojson::value::array& pair = entry.get<picojson::value::array>();
+        typename Map::key_type key{};
+        typename Map::mapped_type value{};
+        PicoJsonReader key_reader{pair[0], reader.errors, reader.resource};
+        PicoJsonReader value_reader{pair[1], reader.errors, reader.resource};
+        visit(key_reader, key);
+        visit(value_reader, value);
+        map.emplace_hint(map.end(), std::move(key), std::move(value));
+      }
+    }
+  }
+
   template<>
   struct StructVisitor<PicoJsonReader> {
     const char* name;
     PicoJsonReader& reader;
     const picojson::value::object& input;
+    const FieldTable* fields = nullptr;
+    FieldSlots<const picojson::value*> slots;
+    size_t next_field = 0;
     
     StructVisitor(const char* name_, PicoJsonReader& reader_)
       : name(name_),
         reader(reader_),
-        input(reader.in.get<picojson::value::object>())
+        input(reader.in.get<picojson::value::object>()),
+        slots(0)
     {
       if (!reader.in.is<picojson::value::object>()) {
-        reader.errors << "Warning: expected JSON object; skipping" << std::endl;
+        reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON object; skipping" << std::endl;
       }
     }
+
+    // Match the JSON members to the fields in one pass
+    StructVisitor(const char* name_, PicoJsonReader& reader_, const FieldTable& fields_)
+      : name(name_),
+        reader(reader_),
+        input(reader.in.get<picojson::value::object>()),
+        fields(&fields_),
+        slots(fields_.size())
+    {
+      if (!reader.in.is<picojson::value::object>()) {
+        reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON object; skipping" << std::endl;
+        return;
+      }
+      for (auto& member : input) {
+        size_t index = fields->find(member.first);
+        if (index != FieldTable::npos) {
+          slots[index] = &member.second;
+        }
+      }
+    }
+    
     ~StructVisitor() {
     }
     
     template<typename T>
     StructVisitor& field(const char* label, T& value) {
-      std::string key(label);
-      auto i = input.find(key);
-      if (i == input.end()) {
-        reader.errors << "Warning: JSON object missing field " << key << std::endl;
+      const picojson::value* json_value = nullptr;
+      if (fields != nullptr) {
+        json_value = slots[next_field++];
+      } else {
+        auto i = input.find(label);
+        if (i != input.end()) { json_value = &i->second; }
+      }
+      bool failed = reader.errors.failed();
+      if (json_value == nullptr) {
+        reader.errors.error(ErrorCode::MISSING_FIELD) << "Warning: JSON object missing field " << label << std::endl;
       } else {
-        PicoJsonReader field_reader{i->second, reader.errors};
+        PicoJsonReader field_reader{*json_value, reader.errors, reader.resource};
         visit(field_reader, value);
       }
+      reader.errors.note_field(label, failed);
       return *this;
     }
   };
+
+  template<typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType> && !std::is_const_v<VariantType>>
+  visit(PicoJsonReader& reader, VariantType& value) {
+    if (!reader.in.is<picojson::value::object>()) {
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON object for variant; skipping" << std::endl;
+      return;
+    }
+    const auto& input = reader.in.get<picojson::value::object>();
+    auto input_which = input.find("which");
+    if (input_which == input.end()) {
+      reader.errors.error(ErrorCode::MISSING_FIELD) << "Error: JSON object missing field 'which'\n";
+      return;
+    }
+    auto input_data = input.find("data");
+    if (input_data == input.end()) {
+      reader.errors.error(ErrorCode::MISSING_FIELD) << "Error: JSON object missing field 'data'\n";
+      return;
+    }
+
+    // TODO: check that there are no other fields
+    
+    PicoJsonReader reader_which{input_which->second, reader.errors};
+    unsigned which = 0;
+    visit(reader_which, which);
+    
+    PicoJsonReader reader_data{input_data->second, reader.errors, reader.resource};
+    if (!visit_alternative(reader_data, value, which)) {
+      reader.errors.error(ErrorCode::BAD_VALUE) << "Error: tried to read variant " << which
+                    << " but there were only " << VariantTraits<VariantType>::size << " types."
+                    << std::endl;
+    }
+  }
   
 }
 
@@ -8,9 +8,19 @@
  * Example usage for C++ to JSON:
  *
  *     rapidjson::StringBuffer output;
- *     traverse::JsonWriter jsonwriter{output};
+ *     traverse::RapidJsonWriter jsonwriter{output};
  *     visit(jsonwriter, yourobject);
- *     std::cout << buffer.GetString();
+ *     std::cout << output.GetString();
+ *
+ * Example usage for C++ to JSON in a caller's buffer, without a
+ * StringBuffer (see BasicRapidJsonWriter):
+ *
+ *     char buffer[1024];
+ *     traverse::JsonBufferStream output(buffer, sizeof(buffer));
+ *     traverse::BasicRapidJsonWriter<traverse::JsonBufferStream> jsonwriter{output};
+ *     visit(jsonwriter, yourobject);
+ *     if (output.overflow) { throw "buffer too small"; }
+ *     send(socket, buffer, output.size(), 0);
  *
  * Example usage for JSON to C++:
  * 
@@ -22,6 +32,14 @@
  *     visit(jsonreader, yourobject);
  *     if (!errors.empty()) { throw "read error"; }
  *
+ * Example usage for JSON to C++ without a Document (see RapidJsonSaxReader):
+ *
+ *     rapidjson::StringStream input("json string");
+ *     std::stringstream errors;
+ *     traverse::RapidJsonSaxReader jsonreader{input, errors};
+ *     visit(jsonreader, yourobject);
+ *     if (!errors.empty()) { throw "parse or read error"; }
+ *
  */
 
 #ifndef TRAVERSE_JSON_H
@@ -31,66 +49,273 @@
 
 #include "traverse.h"
 #include "rapidjson/document.h"
+#include "rapidjson/reader.h"
+#include "rapidjson/error/en.h"
 #include "rapidjson/writer.h"
+#include "rapidjson/prettywriter.h"
 #include "rapidjson/stringbuffer.h"
+#include <memory>
+#include <streambuf>
+#include <string_view>
+#include <vector>
 
 namespace traverse {
 
-  /** The RapidJsonWriter will take a value from C++ and write it into
-   *  a rapidjson stream (SAX).
+  /** The BasicRapidJsonWriter will take a value from C++ and write it
+   *  into a rapidjson output stream (SAX). OutputStream can be any
+   *  rapidjson stream: a StringBuffer, one of the streams below, or
+   *  your own class with Put(char) and Flush(). Writer is
+   *  rapidjson::Writer or rapidjson::PrettyWriter over that stream.
    */
-  struct RapidJsonWriter {
-    rapidjson::StringBuffer& out;
-    rapidjson::Writer<rapidjson::StringBuffer> writer;
-    RapidJsonWriter(rapidjson::StringBuffer& out_): out(out_), writer(out) {}
+  template<typename OutputStream, typename Writer = rapidjson::Writer<OutputStream>>
+  struct BasicRapidJsonWriter {
+    OutputStream& out;
+    Writer writer;
+    SerializationCache* cache = nullptr;
+    BasicRapidJsonWriter(OutputStream& out_): out(out_), writer(out) {}
   };
 
-  template<typename T> inline
-  typename std::enable_if<std::is_arithmetic<T>::value && !std::is_signed<T>::value, void>::type
-  visit(RapidJsonWriter& writer, const T& value) {
+  template<typename OutputStream, typename Writer>
+  uint64_t output_offset(BasicRapidJsonWriter<OutputStream, Writer>& writer) {
+    if constexpr (requires { writer.out.GetSize(); }) {
+      return writer.out.GetSize();
+    } else if constexpr (requires { writer.out.size(); }) {
+      return writer.out.size();
+    } else {
+      return ErrorLog::unknown_offset;
+    }
+  }
+
+  using RapidJsonWriter = BasicRapidJsonWriter<rapidjson::StringBuffer>;
+
+  template<typename OutputStream>
+  using RapidJsonPrettyWriter = BasicRapidJsonWriter<OutputStream, rapidjson::PrettyWriter<OutputStream>>;
+
+  /** Output stream that writes into a fixed block of memory supplied
+   *  by the caller. When the block is full, writing stops and
+   *  overflow is set to true. The output is not 0 terminated.
+   */
+  struct JsonBufferStream {
+    typedef char Ch;
+    char* start;
+    char* pos;
+    char* end;
+    bool overflow = false;
+
+    JsonBufferStream(char* data, size_t size): start(data), pos(data), end(data + size) {}
+
+    void Put(char c) {
+      if (pos != end) { *pos++ = c; }
+      else { overflow = true; }
+    }
+    void Flush() {}
+    size_t size() const { return pos - start; }
+  };
+
+  /** Output stream that writes to a std::streambuf, such as a
+   *  std::filebuf or a socket's streambuf.
+   */
+  struct JsonStreambufStream {
+    typedef char Ch;
+    std::streambuf& out;
+    bool failed = false;
+
+    JsonStreambufStream(std::streambuf& out_): out(out_) {}
+
+    void Put(char c) {
+      if (out.sputc(c) == std::streambuf::traits_type::eof()) { failed = true; }
+    }
+    void Flush() { out.pubsync(); }
+  };
+
+  /** Output stream that writes into a list of fixed size chunks, so
+   *  that a long output is never copied to grow a buffer. Pass
+   *  chunks() to writev() or similar; each chunk is full except for
+   *  the last one.
+   */
+  struct JsonChunkStream {
+    typedef char Ch;
+    size_t chunk_size;
+
+    JsonChunkStream(size_t chunk_size_ = 4096): chunk_size(chunk_size_) {}
+
+    void Put(char c) {
+      if (pos == end) { NewChunk(); }
+      *pos++ = c;
+    }
+    void Flush() {}
+
+    size_t size() const {
+      return storage.empty()? 0 : (storage.size() - 1) * chunk_size + (pos - storage.back().get());
+    }
+
+    std::vector<std::string_view> chunks() const {
+      std::vector<std::string_view> result;
+      for (size_t i = 0; i < storage.size(); ++i) {
+        size_t used = i + 1 == storage.size()? pos - storage[i].get() : chunk_size;
+        result.emplace_back(storage[i].get(), used);
+      }
+      return result;
+    }
+
+    void clear() {
+      if (!storage.empty()) {
+        storage.resize(1);
+        pos = storage[0].get();
+        end = pos + chunk_size;
+      }
+    }
+
+  private:
+    std::vector<std::unique_ptr<char[]>> storage;
+    char* pos = nullptr;
+    char* end = nullptr;
+
+    void NewChunk() {
+      storage.emplace_back(new char[chunk_size]);
+      pos = storage.back().get();
+      end = pos + chunk_size;
+    }
+  };
+
+  template<typename OutputStream, typename Writer, typename T> inline
+  std::enable_if_t<std::is_integral_v<T> && !std::is_signed_v<T> && !std::is_same_v<T, bool>>
+  visit(BasicRapidJsonWriter<OutputStream, Writer>& writer, const T& value) {
     writer.writer.Uint64(value);
   }
 
-  template<typename T> inline
-  typename std::enable_if<std::is_arithmetic<T>::value && std::is_signed<T>::value, void>::type
-  visit(RapidJsonWriter& writer, const T& value) {
+  template<typename OutputStream, typename Writer, typename T> inline
+  std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T>>
+  visit(BasicRapidJsonWriter<OutputStream, Writer>& writer, const T& value) {
     writer.writer.Int64(value);
   }
 
-  template<> inline
-  void visit(RapidJsonWriter& writer, const bool& value) {
+  template<typename OutputStream, typename Writer> inline
+  void visit(BasicRapidJsonWriter<OutputStream, Writer>& writer, const bool& value) {
     writer.writer.Bool(value);
   }
 
-  template<> inline
-  void visit(RapidJsonWriter& writer, const double& value) {
+  template<typename OutputStream, typename Writer, typename T> inline
+  std::enable_if_t<std::is_floating_point_v<T>>
+  visit(BasicRapidJsonWriter<OutputStream, Writer>& writer, const T& value) {
     writer.writer.Double(value);
   }
 
-  template<typename T> inline
-  typename std::enable_if<std::is_enum<T>::value, void>::type
-  visit(RapidJsonWriter& writer, const T& value) {
+  template<typename OutputStream, typename Writer, typename T> inline
+  std::enable_if_t<std::is_enum_v<T>>
+  visit(BasicRapidJsonWriter<OutputStream, Writer>& writer, const T& value) {
     visit(writer, typename std::underlying_type<T>::type(value));
   }
 
-  inline void visit(RapidJsonWriter& writer, const std::string& string) {
-    writer.writer.String(string);
+  template<typename OutputStream, typename Writer, typename Allocator>
+  void visit(BasicRapidJsonWriter<OutputStream, Writer>& writer,
+             const std::basic_string<char, std::char_traits<char>, Allocator>& string) {
+    writer.writer.String(string.data(), rapidjson::SizeType(string.size()));
   }
   
-  template<typename Element>
-  void visit(RapidJsonWriter& writer, const std::vector<Element>& vector) {
+  template<typename OutputStream, typename Writer, typename Element, typename Allocator>
+  void visit(BasicRapidJsonWriter<OutputStream, Writer>& writer, const std::vector<Element, Allocator>& vector) {
     writer.writer.StartArray();
-    for (auto element : vector) {
+    for (const auto& element : vector) {
       visit(writer, element);
     }
     writer.writer.EndArray();
   }
 
-  template<>
-  struct StructVisitor<RapidJsonWriter> {
-    RapidJsonWriter& writer;
+  // An optional value or pointer is null when there's no value
+  template<typename OutputStream, typename Writer, typename T>
+  void visit(BasicRapidJsonWriter<OutputStream, Writer>& writer, const std::optional<T>& value) {
+    if (value) { visit(writer, *value); }
+    else { writer.writer.Null(); }
+  }
+
+  template<typename OutputStream, typename Writer, typename T>
+  void visit(BasicRapidJsonWriter<OutputStream, Writer>& writer, const std::unique_ptr<T>& pointer) {
+    if (pointer) { visit(writer, *pointer); }
+    else { writer.writer.Null(); }
+  }
+
+  template<typename OutputStream, typename Writer, typename Element, size_t N>
+  void visit(BasicRapidJsonWriter<OutputStream, Writer>& writer, const std::array<Element, N>& array) {
+    writer.writer.StartArray();
+    for (const auto& element : array) {
+      visit(writer, element);
+    }
+    writer.writer.EndArray();
+  }
+
+  // A map with string keys is an object; other maps are an array of
+  // [key, value] arrays
+  template<typename OutputStream, typename Writer, typename Map>
+  std::enable_if_t<is_map_v<Map>>
+  visit(BasicRapidJsonWriter<OutputStream, Writer>& writer, const Map& map) {
+    if constexpr (has_string_key_v<Map>) {
+      writer.writer.StartObject();
+      for (const auto& [key, value] : map) {
+        writer.writer.Key(key.data(), rapidjson::SizeType(key.size()));
+        visit(writer, value);
+      }
+      writer.writer.EndObject();
+    } else {
+      writer.writer.StartArray();
+      for (const auto& [key, value] : map) {
+        writer.writer.StartArray();
+        visit(writer, key);
+        visit(writer, value);
+        writer.writer.EndArray();
+      }
+      writer.writer.EndArray();
+    }
+  }
+
+  // A variant is an object {which: ___, data: ___}
+  template<typename OutputStream, typename Writer, typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType>>
+  visit(BasicRapidJsonWriter<OutputStream, Writer>& writer, VariantType& value) {
+    using Traits = VariantTraits<std::remove_const_t<VariantType>>;
+    writer.writer.StartObject();
+    writer.writer.Key("which");
+    writer.writer.Uint64(Traits::index(value));
+    writer.writer.Key("data");
+    Traits::apply([&](const auto& alternative) { visit(writer, alternative); }, value);
+    writer.writer.EndObject();
+  }
+
+  /* With a cache, a Versioned value is written once per version as
+   * compact JSON, and copied in with RawValue after that. In a
+   * PrettyWriter, those values stay compact. */
+  template<typename OutputStream, typename Writer, typename T>
+  void visit(BasicRapidJsonWriter<OutputStream, Writer>& writer, const Versioned<T>& versioned) {
+    if (writer.cache == nullptr) {
+      visit(writer, versioned.get());
+      return;
+    }
+    const std::string* fragment = writer.cache->find(versioned.version(), SerializationCache::JSON);
+    if (fragment == nullptr) {
+      rapidjson::StringBuffer buffer;
+      RapidJsonWriter fragment_writer(buffer);
+      fragment_writer.cache = writer.cache;
+      visit(fragment_writer, versioned.get());
+      fragment = &writer.cache->insert(versioned.version(), SerializationCache::JSON,
+                                       std::string(buffer.GetString(), buffer.GetSize()));
+    }
+    rapidjson::Type type = rapidjson::kNumberType;
+    switch (fragment->empty()? ' ' : (*fragment)[0]) {
+    case '{': type = rapidjson::kObjectType; break;
+    case '[': type = rapidjson::kArrayType; break;
+    case '"': type = rapidjson::kStringType; break;
+    case 'n': type = rapidjson::kNullType; break;
+    case 't': type = rapidjson::kTrueType; break;
+    case 'f': type = rapidjson::kFalseType; break;
+    }
+    writer.writer.RawValue(fragment->data(), fragment->size(), type);
+  }
+
+  template<typename OutputStream, typename Writer>
+  struct StructVisitor<BasicRapidJsonWriter<OutputStream, Writer>> {
+    BasicRapidJsonWriter<OutputStream, Writer>& writer;
     
-    StructVisitor(const char*, RapidJsonWriter& writer_)
+    StructVisitor(const char*, BasicRapidJsonWriter<OutputStream, Writer>& writer_)
       : writer(writer_) {
       writer.writer.StartObject();
     }
@@ -111,39 +336,50 @@ namespace traverse {
   /** The RapidJsonReader will take a rapidjson document and convert
    *  into a C++ object, leaving error messages in the user-supplied
    *  error stream.
+   *
+   *  Set update_in_place to true when reading into an object that
+   *  still holds an earlier value. Vectors are resized instead of
+   *  cleared, and existing elements are read into, so the strings
+   *  and vectors inside them keep their capacity.
+   *
+   *  Set resource to read std::pmr containers into a memory_resource;
+   *  see use_resource() in traverse.h.
    */
   struct RapidJsonReader {
     const rapidjson::Value& in;
-    std::ostream& errors;
+    ErrorSink errors;
+    bool update_in_place = false;
+    std::pmr::memory_resource* resource = nullptr;
   };
 
   template<typename T> inline
   typename std::enable_if<std::is_arithmetic<T>::value && !std::is_signed<T>::value, void>::type
   visit(RapidJsonReader& reader, T& value) {
     if (!reader.in.IsUint64()) {
-      reader.errors << "Warning: expected JSON uint; skipping" << std::endl;
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON uint; skipping" << std::endl;
       return;
     }
     value = T(reader.in.GetUint64());
   }
 
   template<typename T> inline
-  typename std::enable_if<std::is_arithmetic<T>::value && std::is_signed<T>::value, void>::type
+  typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, void>::type
   visit(RapidJsonReader& reader, T& value) {
     if (!reader.in.IsInt64()) {
-      reader.errors << "Warning: expected JSON int; skipping" << std::endl;
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON int; skipping" << std::endl;
       return;
     }
     value = T(reader.in.GetInt64());
   }
 
-  template<> inline
-  void visit(RapidJsonReader& reader, double& value) {
+  template<typename T> inline
+  typename std::enable_if<std::is_floating_point<T>::value, void>::type
+  visit(RapidJsonReader& reader, T& value) {
     if (!reader.in.IsNumber()) {
-      reader.errors << "Warning: expected JSON number; skipping" << std::endl;
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON number; skipping" << std::endl;
       return;
     }
-    value = reader.in.GetDouble();
+    value = T(reader.in.GetDouble());
   }
 
   template<> inline
@@ -153,72 +389,669 @@ namespace traverse {
     } else if (reader.in.IsNumber()) {
       value = reader.in.GetDouble() != 0.0;
     } else {
-      reader.errors << "Warning: expected JSON bool or number; skipping" << std::endl;
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON bool or number; skipping" << std::endl;
     }
   }
 
   template<typename T> inline
   typename std::enable_if<std::is_enum<T>::value, void>::type
   visit(RapidJsonReader& reader, T& value) {
-    typename std::underlying_type<T>::type v;
+    auto v = typename std::underlying_type<T>::type(value);
     visit(reader, v);
     value = T(v);
   }
 
-  inline void visit(RapidJsonReader& reader, std::string& string) {
+  template<typename Allocator>
+  void visit(RapidJsonReader& reader, std::basic_string<char, std::char_traits<char>, Allocator>& string) {
     if (!reader.in.IsString()) {
-      reader.errors << "Warning: expected JSON string; skipping" << std::endl;
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON string; skipping" << std::endl;
       return;
     }
-    string = reader.in.GetString();
+    use_resource(string, reader.resource);
+    string.assign(reader.in.GetString(), reader.in.GetStringLength());
   }
 
-  template<typename Element>
-  void visit(RapidJsonReader& reader, std::vector<Element>& vector) {
+  template<typename Element, typename Allocator>
+  void visit(RapidJsonReader& reader, std::vector<Element, Allocator>& vector) {
     if (!reader.in.IsArray()) {
-      reader.errors << "Warning: expected JSON array; skipping" << std::endl;
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON array; skipping" << std::endl;
+      return;
+    }
+    use_resource(vector, reader.resource);
+    
+    if (reader.update_in_place) {
+      auto array = reader.in.GetArray();
+      vector.resize(array.Size());
+      for (size_t i = 0; i < vector.size(); ++i) {
+        RapidJsonReader element_reader{array[rapidjson::SizeType(i)], reader.errors, true, reader.resource};
+        visit(element_reader, vector[i]);
+      }
       return;
     }
     
     vector.clear();
     for (auto& json_element : reader.in.GetArray()) {
-      vector.push_back(Element());
-      RapidJsonReader element_reader{json_element, reader.errors};
+      vector.emplace_back();
+      RapidJsonReader element_reader{json_element, reader.errors, false, reader.resource};
       visit(element_reader, vector.back());
     }
   }
 
+  template<typename T>
+  void visit(RapidJsonReader& reader, std::optional<T>& value) {
+    if (reader.in.IsNull()) {
+      value.reset();
+      return;
+    }
+    if (!value || !reader.update_in_place) { value.emplace(); }
+    visit(reader, *value);
+  }
+
+  template<typename T>
+  void visit(RapidJsonReader& reader, std::unique_ptr<T>& pointer) {
+    if (reader.in.IsNull()) {
+      pointer.reset();
+      return;
+    }
+    if (!pointer || !reader.update_in_place) { pointer = std::make_unique<T>(); }
+    visit(reader, *pointer);
+  }
+
+  template<typename Element, size_t N>
+  void visit(RapidJsonReader& reader, std::array<Element, N>& array) {
+    if (!reader.in.IsArray()) {
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON array; skipping" << std::endl;
+      return;
+    }
+    auto input = reader.in.GetArray();
+    if (input.Size() != N) {
+      reader.errors.error(ErrorCode::BAD_VALUE) << "Warning: expected JSON array of size " << N
+                    << " but found " << input.Size() << std::endl;
+    }
+    for (size_t i = 0; i < N && i < input.Size(); ++i) {
+      RapidJsonReader element_reader{input[rapidjson::SizeType(i)], reader.errors, reader.update_in_place, reader.resource};
+      visit(element_reader, array[i]);
+    }
+  }
+
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map> && !std::is_const_v<Map>>
+  visit(RapidJsonReader& reader, Map& map) {
+    if constexpr (has_string_key_v<Map>) {
+      if (!reader.in.IsObject()) {
+        reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON object; skipping" << std::endl;
+        return;
+      }
+    } else if (!reader.in.IsArray()) {
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON array of [key, value]; skipping" << std::endl;
+      return;
+    }
+    use_resource(map, reader.resource);
+    map.clear();
+    if constexpr (has_string_key_v<Map>) {
+      if constexpr (requires { map.reserve(size_t(0)); }) { map.reserve(reader.in.MemberCount()); }
+      for (auto& member : reader.in.GetObject()) {
+        typename Map::mapped_type value{};
+        RapidJsonReader value_reader{member.value, reader.errors, false, reader.resource};
+        visit(value_reader, value);
+        map.emplace_hint(map.end(),
+                         typename Map::key_type(member.name.GetString(), member.name.GetStringLength()),
+                         std::move(value));
+      }
+    } else {
+      if constexpr (requires { map.reserve(size_t(0)); }) { map.reserve(reader.in.Size()); }
+      for (auto& entry : reader.in.GetArray()) {
+        if (!entry.IsArray() || entry.Size() != 2) {
+          reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON array of [key, value]; skipping" << std::endl;
+          continue;
+        }
+        typename Map::key_type key{};
+        typename Map::mapped_type value{};
+        RapidJsonReader key_reader{entry[rapidjson::SizeType(0)], reader.errors, false, reader.resource};
+        RapidJsonReader value_reader{entry[rapidjson::SizeType(1)], reader.errors, false, reader.resource};
+        visit(key_reader, key);
+        visit(value_reader, value);
+        map.emplace_hint(map.end(), std::move(key), std::move(value));
+      }
+    }
+  }
+
+  template<typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType> && !std::is_const_v<VariantType>>
+  visit(RapidJsonReader& reader, VariantType& value) {
+    if (!reader.in.IsObject()) {
+      reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON object for variant; skipping" << std::endl;
+      return;
+    }
+    auto input_which = reader.in.FindMember("which");
+    auto input_data = reader.in.FindMember("data");
+    if (input_which == reader.in.MemberEnd() || input_data == reader.in.MemberEnd()) {
+      reader.errors.error(ErrorCode::MISSING_FIELD) << "Error: JSON variant needs fields 'which' and 'data'\n";
+      return;
+    }
+    RapidJsonReader reader_which{input_which->value, reader.errors};
+    unsigned which = 0;
+    visit(reader_which, which);
+    RapidJsonReader reader_data{input_data->value, reader.errors, false, reader.resource};
+    if (!visit_alternative(reader_data, value, which)) {
+      reader.errors.error(ErrorCode::BAD_VALUE) << "Error: tried to read variant " << which
+                    << " but there were only " << VariantTraits<VariantType>::size << " types."
+                    << std::endl;
+    }
+  }
+
   template<>
   struct StructVisitor<RapidJsonReader> {
     const char* name;
     RapidJsonReader& reader;
     const rapidjson::Value& input;
+    const FieldTable* fields = nullptr;
+    FieldSlots<const rapidjson::Value*> slots;
+    size_t next_field = 0;
     
     StructVisitor(const char* name_, RapidJsonReader& reader_)
       : name(name_),
         reader(reader_),
-        input(reader.in)
+        input(reader.in),
+        slots(0)
     {
       if (!reader.in.IsObject()) {
-        reader.errors << "Warning: expected JSON object; skipping" << std::endl;
+        reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON object; skipping" << std::endl;
       }
     }
+
+    // Match the JSON members to the fields in one pass
+    StructVisitor(const char* name_, RapidJsonReader& reader_, const FieldTable& fields_)
+      : name(name_),
+        reader(reader_),
+        input(reader.in),
+        fields(&fields_),
+        slots(fields_.size())
+    {
+      if (!reader.in.IsObject()) {
+        reader.errors.error(ErrorCode::TYPE_MISMATCH) << "Warning: expected JSON object; skipping" << std::endl;
+        return;
+      }
+      for (auto& member : input.GetObject()) {
+        size_t index = fields->find(std::string_view(member.name.GetString(), member.name.GetStringLength()));
+        if (index != FieldTable::npos && slots[index] == nullptr) {
+          slots[index] = &member.value;
+        }
+      }
+    }
+    
     ~StructVisitor() {
     }
     
     template<typename T>
     StructVisitor& field(const char* label, T& value) {
-      auto i = input.FindMember(label);
-      if (i == input.MemberEnd()) {
-        reader.errors << "Warning: JSON object missing field " << label << std::endl;
+      if (!input.IsObject()) { return *this; }
+      const rapidjson::Value* json_value = nullptr;
+      if (fields != nullptr) {
+        json_value = slots[next_field++];
       } else {
-        RapidJsonReader field_reader{i->value, reader.errors};
+        auto i = input.FindMember(label);
+        if (i != input.MemberEnd()) { json_value = &i->value; }
+      }
+      bool failed = reader.errors.failed();
+      if (json_value == nullptr) {
+        reader.errors.error(ErrorCode::MISSING_FIELD) << "Warning: JSON object missing field " << label << std::endl;
+      } else {
+        RapidJsonReader field_reader{*json_value, reader.errors, reader.update_in_place, reader.resource};
         visit(field_reader, value);
       }
+      reader.errors.note_field(label, failed);
       return *this;
     }
   };
   
+
+  /** The RapidJsonSaxReader reads JSON text from a rapidjson input
+   *  stream (StringStream, FileReadStream, IStreamWrapper, ...) and
+   *  fills in the C++ object as tokens arrive, without building a
+   *  Document. It reports the same warnings as RapidJsonReader, but in
+   *  the order of the JSON text; missing fields are reported at the
+   *  end of each object. JSON syntax errors are reported as
+   *  "Error: ..." and stop the reading.
+   *
+   *     rapidjson::StringStream input(json_text);
+   *     traverse::RapidJsonSaxReader jsonreader{input, errors};
+   *     visit(jsonreader, yourobject);
+   *
+   *  The stream must outlive the reader. Each visit() reads one JSON
+   *  value; extra text after the top-level value is an error.
+   */
+  struct RapidJsonSaxReader {
+    enum class TokenType {
+      NONE, // at the end of the input, or after a syntax error
+      NULL_VALUE, BOOL, NUMBER, STRING, KEY,
+      START_OBJECT, END_OBJECT, START_ARRAY, END_ARRAY
+    };
+
+    // The current token; string is only valid until next()
+    struct Token {
+      TokenType type = TokenType::NONE;
+      bool boolean = false;
+      bool is_int64 = false, is_uint64 = false;
+      int64_t int64 = 0;
+      uint64_t uint64 = 0;
+      double number = 0.0;
+      std::string_view string;
+    };
+
+    // Receives one event from the rapidjson parser
+    struct Handler {
+      Token& token;
+      bool Null() { token.type = TokenType::NULL_VALUE; return true; }
+      bool Bool(bool b) { token.type = TokenType::BOOL; token.boolean = b; return true; }
+      bool Int(int i) { return Int64(i); }
+      bool Uint(unsigned u) { return Uint64(u); }
+      bool Int64(int64_t i) {
+        token.type = TokenType::NUMBER;
+        token.is_int64 = true; token.is_uint64 = i >= 0;
+        token.int64 = i; token.uint64 = uint64_t(i); token.number = double(i);
+        return true;
+      }
+      bool Uint64(uint64_t u) {
+        token.type = TokenType::NUMBER;
+        token.is_int64 = u <= uint64_t(INT64_MAX); token.is_uint64 = true;
+        token.int64 = int64_t(u); token.uint64 = u; token.number = double(u);
+        return true;
+      }
+      bool Double(double d) {
+        token.type = TokenType::NUMBER;
+        token.is_int64 = token.is_uint64 = false;
+        token.number = d;
+        return true;
+      }
+      bool RawNumber(const char*, rapidjson::SizeType, bool) { return false; }
+      bool String(const char* s, rapidjson::SizeType length, bool) {
+        token.type = TokenType::STRING; token.string = std::string_view(s, length); return true;
+      }
+      bool Key(const char* s, rapidjson::SizeType length, bool) {
+        token.type = TokenType::KEY; token.string = std::string_view(s, length); return true;
+      }
+      bool StartObject() { token.type = TokenType::START_OBJECT; return true; }
+      bool EndObject(rapidjson::SizeType) { token.type = TokenType::END_OBJECT; return true; }
+      bool StartArray() { token.type = TokenType::START_ARRAY; return true; }
+      bool EndArray(rapidjson::SizeType) { token.type = TokenType::END_ARRAY; return true; }
+    };
+
+    ErrorSink errors;
+    bool update_in_place = false;
+    std::pmr::memory_resource* resource = nullptr;
+    Token token;
+    bool failed = false;
+    rapidjson::Reader parser;
+    void* stream;
+    bool (*parse_next)(RapidJsonSaxReader& reader);
+
+    template<typename InputStream>
+    RapidJsonSaxReader(InputStream& stream_, ErrorSink errors_)
+      : errors(errors_),
+        stream(&stream_),
+        parse_next([](RapidJsonSaxReader& reader) {
+          Handler handler{reader.token};
+          return reader.parser.IterativeParseNext<rapidjson::kParseDefaultFlags>(
+            *static_cast<InputStream*>(reader.stream), handler);
+        })
+    {
+      parser.IterativeParseInit();
+      next();
+    }
+    RapidJsonSaxReader(const RapidJsonSaxReader&) = delete;
+    RapidJsonSaxReader& operator = (const RapidJsonSaxReader&) = delete;
+
+    // Move to the next token
+    void next() {
+      token.type = TokenType::NONE;
+      if (failed || parser.IterativeParseComplete()) { return; }
+      if (!parse_next(*this)) {
+        token.type = TokenType::NONE;
+        failed = true;
+        errors.error(ErrorCode::PARSE_ERROR, parser.GetErrorOffset()) << "Error: JSON parse error at offset " << parser.GetErrorOffset()
+               << ": " << rapidjson::GetParseError_En(parser.GetParseErrorCode()) << std::endl;
+      }
+    }
+
+    // Move past the current value, including everything inside it
+    void skip() {
+      int depth = 0;
+      do {
+        if (token.type == TokenType::START_OBJECT || token.type == TokenType::START_ARRAY) {
+          ++depth;
+        } else if (token.type == TokenType::END_OBJECT || token.type == TokenType::END_ARRAY) {
+          --depth;
+        }
+        next();
+      } while (depth > 0 && token.type != TokenType::NONE);
+    }
+
+    // If the current value isn't what's expected, warn and skip it
+    bool expect(bool matches, const char* warning) {
+      if (matches) { return true; }
+      if (token.type != TokenType::NONE) {
+        errors.error(ErrorCode::TYPE_MISMATCH) << warning << std::endl;
+        skip();
+      }
+      return false;
+    }
+  };
+
+  template<typename T> inline
+  typename std::enable_if<std::is_arithmetic<T>::value && !std::is_signed<T>::value, void>::type
+  visit(RapidJsonSaxReader& reader, T& value) {
+    if (!reader.expect(reader.token.type == RapidJsonSaxReader::TokenType::NUMBER && reader.token.is_uint64,
+                       "Warning: expected JSON uint; skipping")) {
+      return;
+    }
+    value = T(reader.token.uint64);
+    reader.next();
+  }
+
+  template<typename T> inline
+  typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, void>::type
+  visit(RapidJsonSaxReader& reader, T& value) {
+    if (!reader.expect(reader.token.type == RapidJsonSaxReader::TokenType::NUMBER && reader.token.is_int64,
+                       "Warning: expected JSON int; skipping")) {
+      return;
+    }
+    value = T(reader.token.int64);
+    reader.next();
+  }
+
+  template<typename T> inline
+  typename std::enable_if<std::is_floating_point<T>::value, void>::type
+  visit(RapidJsonSaxReader& reader, T& value) {
+    if (!reader.expect(reader.token.type == RapidJsonSaxReader::TokenType::NUMBER,
+                       "Warning: expected JSON number; skipping")) {
+      return;
+    }
+    value = T(reader.token.number);
+    reader.next();
+  }
+
+  template<> inline
+  void visit(RapidJsonSaxReader& reader, bool& value) {
+    if (!reader.expect(reader.token.type == RapidJsonSaxReader::TokenType::BOOL
+                       || reader.token.type == RapidJsonSaxReader::TokenType::NUMBER,
+                       "Warning: expected JSON bool or number; skipping")) {
+      return;
+    }
+    if (reader.token.type == RapidJsonSaxReader::TokenType::BOOL) {
+      value = reader.token.boolean;
+    } else {
+      value = reader.token.number != 0.0;
+    }
+    reader.next();
+  }
+
+  template<typename T> inline
+  typename std::enable_if<std::is_enum<T>::value, void>::type
+  visit(RapidJsonSaxReader& reader, T& value) {
+    auto v = typename std::underlying_type<T>::type(value);
+    visit(reader, v);
+    value = T(v);
+  }
+
+  template<typename Allocator>
+  void visit(RapidJsonSaxReader& reader, std::basic_string<char, std::char_traits<char>, Allocator>& string) {
+    if (!reader.expect(reader.token.type == RapidJsonSaxReader::TokenType::STRING,
+                       "Warning: expected JSON string; skipping")) {
+      return;
+    }
+    use_resource(string, reader.resource);
+    string.assign(reader.token.string.data(), reader.token.string.size());
+    reader.next();
+  }
+
+  template<typename Element, typename Allocator>
+  void visit(RapidJsonSaxReader& reader, std::vector<Element, Allocator>& vector) {
+    if (!reader.expect(reader.token.type == RapidJsonSaxReader::TokenType::START_ARRAY,
+                       "Warning: expected JSON array; skipping")) {
+      return;
+    }
+    use_resource(vector, reader.resource);
+    reader.next();
+
+    // In place, the elements already there are read into
+    if (!reader.update_in_place) { vector.clear(); }
+    size_t i = 0;
+    while (reader.token.type != RapidJsonSaxReader::TokenType::END_ARRAY
+           && reader.token.type != RapidJsonSaxReader::TokenType::NONE) {
+      if (i == vector.size()) { vector.emplace_back(); }
+      visit(reader, vector[i]);
+      ++i;
+    }
+    vector.erase(vector.begin() + i, vector.end());
+    reader.next();
+  }
+
+  template<typename T>
+  void visit(RapidJsonSaxReader& reader, std::optional<T>& value) {
+    if (reader.token.type == RapidJsonSaxReader::TokenType::NULL_VALUE) {
+      value.reset();
+      reader.next();
+      return;
+    }
+    if (!value || !reader.update_in_place) { value.emplace(); }
+    visit(reader, *value);
+  }
+
+  template<typename T>
+  void visit(RapidJsonSaxReader& reader, std::unique_ptr<T>& pointer) {
+    if (reader.token.type == RapidJsonSaxReader::TokenType::NULL_VALUE) {
+      pointer.reset();
+      reader.next();
+      return;
+    }
+    if (!pointer || !reader.update_in_place) { pointer = std::make_unique<T>(); }
+    visit(reader, *pointer);
+  }
+
+  template<typename Element, size_t N>
+  void visit(RapidJsonSaxReader& reader, std::array<Element, N>& array) {
+    using TokenType = RapidJsonSaxReader::TokenType;
+    if (!reader.expect(reader.token.type == TokenType::START_ARRAY,
+                       "Warning: expected JSON array; skipping")) {
+      return;
+    }
+    reader.next();
+    size_t i = 0;
+    while (reader.token.type != TokenType::END_ARRAY && reader.token.type != TokenType::NONE) {
+      if (i < N) { visit(reader, array[i]); }
+      else { reader.skip(); }
+      ++i;
+    }
+    if (reader.token.type == TokenType::NONE) { return; } // syntax error
+    if (i != N) {
+      reader.errors.error(ErrorCode::BAD_VALUE) << "Warning: expected JSON array of size " << N
+                    << " but found " << i << std::endl;
+    }
+    reader.next();
+  }
+
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map> && !std::is_const_v<Map>>
+  visit(RapidJsonSaxReader& reader, Map& map) {
+    using TokenType = RapidJsonSaxReader::TokenType;
+    if constexpr (has_string_key_v<Map>) {
+      if (!reader.expect(reader.token.type == TokenType::START_OBJECT,
+                         "Warning: expected JSON object; skipping")) {
+        return;
+      }
+    } else if (!reader.expect(reader.token.type == TokenType::START_ARRAY,
+                              "Warning: expected JSON array of [key, value]; skipping")) {
+      return;
+    }
+    use_resource(map, reader.resource);
+    map.clear();
+    reader.next();
+    auto more = [&]() {
+      if constexpr (has_string_key_v<Map>) { return reader.token.type == TokenType::KEY; }
+      return reader.token.type != TokenType::END_ARRAY && reader.token.type != TokenType::NONE;
+    };
+    while (more()) {
+      typename Map::key_type key{};
+      typename Map::mapped_type value{};
+      if constexpr (has_string_key_v<Map>) {
+        key.assign(reader.token.string.data(), reader.token.string.size());
+        reader.next();
+        visit(reader, value);
+      } else {
+        if (!reader.expect(reader.token.type == TokenType::START_ARRAY,
+                           "Warning: expected JSON array of [key, value]; skipping")) {
+          continue;
+        }
+        reader.next();
+        visit(reader, key);
+        visit(reader, value);
+        if (reader.token.type != TokenType::END_ARRAY) {
+          reader.errors.error(ErrorCode::BAD_VALUE) << "Warning: expected JSON array of [key, value]; skipping the rest"
+                                                    << std::endl;
+          while (reader.token.type != TokenType::END_ARRAY && reader.token.type != TokenType::NONE) {
+            reader.skip();
+          }
+        }
+        reader.next();
+      }
+      map.emplace_hint(map.end(), std::move(key), std::move(value));
+    }
+    reader.next();
+  }
+
+  /* The variant's type has to be known before its data is read, so
+   * "which" has to come before "data", as RapidJsonWriter writes it. */
+  template<typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType> && !std::is_const_v<VariantType>>
+  visit(RapidJsonSaxReader& reader, VariantType& value) {
+    using TokenType = RapidJsonSaxReader::TokenType;
+    if (!reader.expect(reader.token.type == TokenType::START_OBJECT,
+                       "Warning: expected JSON object for variant; skipping")) {
+      return;
+    }
+    reader.next();
+    bool seen_which = false, seen_data = false;
+    unsigned which = 0;
+    while (reader.token.type == TokenType::KEY) {
+      std::string_view key = reader.token.string;
+      if (key == "which" && !seen_which) {
+        reader.next();
+        visit(reader, which);
+        seen_which = true;
+      } else if (key == "data" && seen_which && !seen_data) {
+        reader.next();
+        seen_data = true;
+        if (!visit_alternative(reader, value, which)) {
+          reader.errors.error(ErrorCode::BAD_VALUE) << "Error: tried to read variant " << which
+                        << " but there were only " << VariantTraits<VariantType>::size << " types."
+                        << std::endl;
+          reader.skip();
+        }
+      } else {
+        reader.next();
+        reader.skip();
+      }
+    }
+    if (reader.token.type != TokenType::END_OBJECT) { return; } // syntax error
+    reader.next();
+    if (!seen_data) {
+      reader.errors.error(ErrorCode::MISSING_FIELD) << "Error: JSON variant needs field 'which' followed by 'data'\n";
+    }
+  }
+
+  /* The fields arrive in the order of the JSON text, not the order of
+   * the struct, so field() only remembers where each field is, and the
+   * object is read when the StructVisitor is destroyed.
+   */
+  template<>
+  struct StructVisitor<RapidJsonSaxReader> {
+    struct Field {
+      const char* label;
+      void* value;
+      void (*read)(RapidJsonSaxReader& reader, void* value);
+      bool seen;
+    };
+    
+    const char* name;
+    RapidJsonSaxReader& reader;
+    const FieldTable* fields = nullptr;
+    FieldSlots<Field> slots;
+    std::vector<Field> unlisted_fields; // when there's no field table
+    size_t count = 0;
+
+    StructVisitor(const char* name_, RapidJsonSaxReader& reader_)
+      : name(name_), reader(reader_), slots(0) {}
+    
+    StructVisitor(const char* name_, RapidJsonSaxReader& reader_, const FieldTable& fields_)
+      : name(name_), reader(reader_), fields(&fields_), slots(fields_.size()) {}
+
+    ~StructVisitor() {
+      read_object();
+    }
+
+    template<typename T>
+    static void read_field(RapidJsonSaxReader& reader, void* value) {
+      visit(reader, *static_cast<T*>(value));
+    }
+    
+    template<typename T>
+    StructVisitor& field(const char* label, T& value) {
+      Field f{label, &value, &read_field<T>, false};
+      if (fields != nullptr) {
+        slots[count] = f;
+      } else {
+        unlisted_fields.push_back(f);
+      }
+      ++count;
+      return *this;
+    }
+
+    Field& field_at(size_t index) {
+      return fields != nullptr ? slots[index] : unlisted_fields[index];
+    }
+
+    size_t find(std::string_view key) {
+      if (fields != nullptr) { return fields->find(key); }
+      for (size_t i = 0; i < count; ++i) {
+        if (key == unlisted_fields[i].label) { return i; }
+      }
+      return FieldTable::npos;
+    }
+    
+    void read_object() {
+      using TokenType = RapidJsonSaxReader::TokenType;
+      if (!reader.expect(reader.token.type == TokenType::START_OBJECT,
+                         "Warning: expected JSON object; skipping")) {
+        return;
+      }
+      reader.next();
+      while (reader.token.type == TokenType::KEY) {
+        size_t index = find(reader.token.string);
+        reader.next();
+        if (index == FieldTable::npos || field_at(index).seen) {
+          reader.skip();
+        } else {
+          Field& f = field_at(index);
+          f.seen = true;
+          bool failed = reader.errors.failed();
+          f.read(reader, f.value);
+          reader.errors.note_field(f.label, failed);
+        }
+      }
+      if (reader.token.type != TokenType::END_OBJECT) { return; } // syntax error
+      reader.next();
+      
+      for (size_t i = 0; i < count; ++i) {
+        if (!field_at(i).seen) {
+          bool failed = reader.errors.failed();
+          reader.errors.error(ErrorCode::MISSING_FIELD) << "Warning: JSON object missing field " << field_at(i).label << std::endl;
+          reader.errors.note_field(field_at(i).label, failed);
+        }
+      }
+    }
+  };
+
 }
 
 
@@ -0,0 +1,209 @@
+// Copyright 2026 Red Blob Games <redblobgames@gmail.com>
+// https://github.com/redblobgames/cpp-traverse
+// License: Apache v2.0 <http://www.apache.org/licenses/LICENSE-2.0.html>
+
+/**
+ * A faster CoutWriter, for dumping large objects as text. It writes
+ * the same text as CoutWriter and the operator << that
+ * TRAVERSE_STRUCT makes, but formats numbers with std::to_chars and
+ * collects the text in a buffer, instead of going through the
+ * std::ostream formatting for every value.
+ *
+ * Example usage:
+ *
+ *     traverse::TextWriter writer(std::cout);
+ *     visit(writer, world);
+ *     writer.Flush(); // or let the destructor flush
+ *
+ * Without a stream, the text stays in writer.buffer. to_text(obj)
+ * returns it as a string.
+ *
+ * The text is what a std::ostream with its default settings writes,
+ * so numbers are always in decimal, and floating point values have 6
+ * significant digits. CoutWriter follows the stream's settings
+ * instead.
+ *
+ * To split a large vector across threads, see parallel_text_dump()
+ * in traverse-parallel.h.
+ */
+
+#ifndef TRAVERSE_TEXT_H
+#define TRAVERSE_TEXT_H
+
+#include "traverse.h"
+
+namespace traverse {
+
+  struct TextWriter {
+    static constexpr size_t flush_size = 64 * 1024;
+
+    std::ostream* out = nullptr;
+    std::string buffer;
+
+    TextWriter() {}
+    TextWriter(std::ostream& out_): out(&out_) {}
+    TextWriter(const TextWriter&) = delete;
+    TextWriter& operator = (const TextWriter&) = delete;
+    ~TextWriter() { Flush(); }
+
+    // Writes the buffer to the stream, if there is one
+    void Flush() {
+      if (out && !buffer.empty()) {
+        out->write(buffer.data(), std::streamsize(buffer.size()));
+        buffer.clear();
+      }
+    }
+
+    // Called after each value; the buffer is kept small when there's
+    // somewhere to write it
+    void check_flush() {
+      if (out && buffer.size() >= flush_size) { Flush(); }
+    }
+  };
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T>>
+  visit(TextWriter& writer, const T& value) {
+    if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>) {
+      // std::ostream writes these as characters
+      writer.buffer.push_back(char(value));
+    } else if constexpr (std::is_same_v<T, bool>) {
+      writer.buffer.push_back(value ? '1' : '0');
+    } else {
+      char digits[64];
+      std::to_chars_result result;
+      if constexpr (std::is_floating_point_v<T>) {
+        result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6);
+      } else {
+        result = std::to_chars(digits, digits + sizeof(digits), value);
+      }
+      writer.buffer.append(digits, result.ptr);
+    }
+    writer.check_flush();
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_enum_v<T>>
+  visit(TextWriter& writer, const T& value) {
+    visit(writer, (long long)(value));
+  }
+
+  // The same quoting as std::quoted: a backslash before " and before backslash
+  inline void visit(TextWriter& writer, const std::string_view& string) {
+    writer.buffer.push_back('"');
+    // Copy the runs of characters between the ones that need a backslash
+    const char* run = string.data();
+    const char* end = string.data() + string.size();
+    for (const char* p = run; p != end; ++p) {
+      if (*p == '"' || *p == '\\') {
+        writer.buffer.append(run, p);
+        writer.buffer.push_back('\\');
+        run = p;
+      }
+    }
+    writer.buffer.append(run, end);
+    writer.buffer.push_back('"');
+    writer.check_flush();
+  }
+
+  template<typename Allocator>
+  void visit(TextWriter& writer, const std::basic_string<char, std::char_traits<char>, Allocator>& string) {
+    visit(writer, std::string_view(string));
+  }
+
+  template<typename Element>
+  void visit(TextWriter& writer, const std::span<Element>& span) {
+    writer.buffer.push_back('[');
+    for (size_t i = 0; i < span.size(); ++i) {
+      if (i != 0) writer.buffer.append(", ");
+      visit(writer, span[i]);
+    }
+    writer.buffer.push_back(']');
+  }
+
+  template<typename Element, typename Allocator>
+  void visit(TextWriter& writer, const std::vector<Element, Allocator>& vector) {
+    writer.buffer.push_back('[');
+    for (size_t i = 0; i < vector.size(); ++i) {
+      if (i != 0) writer.buffer.append(", ");
+      visit(writer, vector[i]);
+    }
+    writer.buffer.push_back(']');
+  }
+
+  template<typename T>
+  void visit(TextWriter& writer, const std::optional<T>& value) {
+    if (value) { visit(writer, *value); }
+    else { writer.buffer.append("null"); }
+  }
+
+  template<typename T>
+  void visit(TextWriter& writer, const std::unique_ptr<T>& pointer) {
+    if (pointer) { visit(writer, *pointer); }
+    else { writer.buffer.append("null"); }
+  }
+
+  template<typename Element, size_t N>
+  void visit(TextWriter& writer, const std::array<Element, N>& array) {
+    visit(writer, std::span<const Element>(array));
+  }
+
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map>>
+  visit(TextWriter& writer, const Map& map) {
+    writer.buffer.push_back('{');
+    bool first = true;
+    for (const auto& [key, value] : map) {
+      if (!first) writer.buffer.append(", ");
+      first = false;
+      visit(writer, key);
+      writer.buffer.append(": ");
+      visit(writer, value);
+    }
+    writer.buffer.push_back('}');
+  }
+
+  template<typename VariantType> inline
+  std::enable_if_t<is_variant_v<VariantType>>
+  visit(TextWriter& writer, VariantType& value) {
+    VariantTraits<std::remove_const_t<VariantType>>::apply
+      ([&](const auto& alternative) { visit(writer, alternative); }, value);
+  }
+
+  template<>
+  struct StructVisitor<TextWriter> {
+    const char* name;
+    TextWriter& writer;
+    bool first;
+
+    StructVisitor(const char* name_, TextWriter& writer_)
+      : name(name_), writer(writer_), first(true) {
+      writer.buffer.append(name);
+      writer.buffer.push_back('{');
+    }
+
+    ~StructVisitor() {
+      writer.buffer.push_back('}');
+    }
+
+    template<typename T>
+    StructVisitor& field(const char* label, const T& value) {
+      if (!first) writer.buffer.append(", ");
+      first = false;
+      writer.buffer.append(label);
+      writer.buffer.push_back(':');
+      visit(writer, value);
+      return *this;
+    }
+  };
+
+  template<typename T>
+  std::string to_text(const T& obj) {
+    TextWriter writer;
+    visit(writer, obj);
+    return std::move(writer.buffer);
+  }
+}
+
+
+#endif
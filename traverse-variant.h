@@ -7,8 +7,9 @@
  * 
  * The traverse library is "multimethod" style so it can be extended with
  * both new nouns (data types to be visited) and verbs (visit operations).
- * This file only defines variant + cout and variant + binary serialization,
- * but does not define variant + json or variant + lua.
+ * Every visitor that handles variants does it through VariantTraits (see
+ * traverse.h), so this file only has to describe mapbox::variant to it.
+ * std::variant works without this file.
  */
 
 #ifndef TRAVERSE_VARIANT_H
@@ -17,72 +18,31 @@
 #include "traverse.h"
 #include "mapbox/variant.hpp"
 #include "mapbox/variant_io.hpp"
+#include <tuple>
 
 
 namespace traverse {
   // Using mapbox's variant here but if you use boost or another variant,
-  // change the includes above and these typedefs:
+  // change the includes above, these typedefs, and VariantTraits:
   template<typename ...T> using variant = mapbox::util::variant<T...>;
   using mapbox::util::apply_visitor;
 
-  
-  struct CoutVariantVisitor {
-    CoutWriter& writer;
-    template<typename T> void operator()(const T& value) {
-      visit(writer, value);
+  template<typename ...Alternatives>
+  struct VariantTraits<mapbox::util::variant<Alternatives...>> {
+    using VariantType = mapbox::util::variant<Alternatives...>;
+    static constexpr size_t size = sizeof...(Alternatives);
+    static size_t index(const VariantType& value) { return value.which(); }
+    template<size_t I>
+    static auto& emplace(VariantType& value) {
+      using Alternative = std::tuple_element_t<I, std::tuple<Alternatives...>>;
+      value.template set<Alternative>();
+      return value.template get<Alternative>();
     }
-  };
-  
-  template<typename ...Variants>
-  void visit(CoutWriter& writer, const variant<Variants...>& value) {
-      apply_visitor(CoutVariantVisitor{writer}, value);
-  }
-
-  
-  struct BinarySerializeVariantHelper {
-    BinarySerialize& writer;
-    template<typename T> void operator()(const T& value) {
-      visit(writer, value);
+    template<typename Function>
+    static void apply(Function&& function, const VariantType& value) {
+      apply_visitor(std::forward<Function>(function), value);
     }
   };
-  
-  template<typename ...Variants>
-  void visit(BinarySerialize& writer, const variant<Variants...>& value) {
-    unsigned which = value.which();
-    visit(writer, which);
-    apply_visitor(BinarySerializeVariantHelper{writer}, value);
-  }
-
-
-  template<typename VariantType>
-  void deserialize_variant_helper(BinaryDeserialize& reader,
-                                  unsigned which, unsigned index,
-                                  VariantType&) {
-    reader.errors << "Error: tried to deserialize variant " << which
-                  << " but there were only " << index << " types."
-                  << std::endl;
-  }
-  
-  template<typename VariantType, typename First, typename ...Rest>
-  void deserialize_variant_helper(BinaryDeserialize& reader,
-                                  unsigned which, unsigned index,
-                                  VariantType& value) {
-    if (which == index) {
-      value.template set<First>();
-      visit(reader, value.template get<First>());
-    } else {
-      deserialize_variant_helper<VariantType, Rest...>(reader, which, index+1, value);
-    }
-  }
-
-  template<typename ...Variants>
-  void visit(BinaryDeserialize& reader, variant<Variants...>& value) {
-    unsigned which;
-    visit(reader, which);
-    deserialize_variant_helper<variant<Variants...>, Variants...>
-      (reader, which, 0, value);
-  }
-  
 }
 
 
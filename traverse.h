@@ -9,6 +9,7 @@
  *   - debugging output using ostream::operator <<
  *   - binary serialization
  *   - binary deserialization
+ *   - counting the size of the binary serialization
  *
  * The serialization format offers no backwards/forwards compatibility.
  * It is useful for network messages between client and server, but not
@@ -17,7 +18,8 @@
  * The traverse library is generic and can be extended to more data types
  * and also more operations. To extend it to work on a user-defined struct
  * or class, see TRAVERSE_STRUCT below. To extend it to work on a container,
- * see traverse-variant.h, which extends traverse to work on mapbox::variant.
+ * see traverse-variant.h, which extends traverse to work on mapbox::variant
+ * through VariantTraits.
  * To extend it to a new operation, see traverse-json.h, which writes to or 
  * reads from a JSON object (via the picojson library), and traverse-lua.h, 
  * which writes to or reads from a Lua object on the Lua stack.
@@ -26,12 +28,210 @@
 #ifndef TRAVERSE_H
 #define TRAVERSE_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
 #include <iostream>
 #include <iomanip>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <optional>
 #include <streambuf>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <span>
+#include <bit>
+#include <utility>
+#include <variant>
+
+namespace traverse {
+
+  /* Readers keep their errors in an ErrorLog. Constructing one costs
+   * nothing, and nothing is allocated until there's an error, so a
+   * reader per message is cheap. The log keeps the text of every
+   * error and warning, as before, plus the kind of the first error,
+   * where it happened in the input (for binary readers), and which
+   * struct fields the reader was inside (the path).
+   */
+  enum class ErrorCode {
+    NONE,
+    END_OF_INPUT,   // input ended in the middle of a value
+    SIZE_LIMIT,     // a size was over max_elements or max_bytes
+    BAD_VALUE,      // a value that can't be stored, like a variant index
+    TYPE_MISMATCH,  // JSON or Lua value of the wrong type
+    MISSING_FIELD,  // JSON or Lua object without one of the struct's fields
+    EXTRA_FIELD,    // Lua object with keys that aren't in the struct
+    PARSE_ERROR,    // JSON syntax error
+    BAD_FRAMING,    // batch or record sizes that don't fit the input
+    FILE_ERROR,     // a file that can't be opened or mapped
+  };
+
+  inline const char* error_code_name(ErrorCode code) {
+    switch (code) {
+    case ErrorCode::NONE: return "none";
+    case ErrorCode::END_OF_INPUT: return "end of input";
+    case ErrorCode::SIZE_LIMIT: return "size limit";
+    case ErrorCode::BAD_VALUE: return "bad value";
+    case ErrorCode::TYPE_MISMATCH: return "type mismatch";
+    case ErrorCode::MISSING_FIELD: return "missing field";
+    case ErrorCode::EXTRA_FIELD: return "extra field";
+    case ErrorCode::PARSE_ERROR: return "parse error";
+    case ErrorCode::BAD_FRAMING: return "bad framing";
+    case ErrorCode::FILE_ERROR: return "file error";
+    }
+    return "unknown";
+  }
+
+  struct ErrorLog {
+    static constexpr uint64_t unknown_offset = ~uint64_t(0);
+
+    ErrorCode code = ErrorCode::NONE; // first error
+    uint64_t offset = unknown_offset; // input position of first error
+    std::vector<const char*> path;    // fields around first error, innermost first
+    std::string text;                 // all the messages
+
+    bool failed() const { return code != ErrorCode::NONE; }
+    bool empty() const { return text.empty(); }
+    const std::string& str() const { return text; }
+
+    void clear() {
+      code = ErrorCode::NONE;
+      offset = unknown_offset;
+      path.clear();
+      text.clear();
+    }
+
+    // Start an error; the message is written with << after this
+    ErrorLog& error(ErrorCode code_, uint64_t offset_ = unknown_offset) {
+      if (!failed()) {
+        code = code_;
+        offset = offset_;
+      }
+      return *this;
+    }
+
+    // Called by struct visitors after a field; failed_before is
+    // failed() from before the field was visited
+    void note_field(const char* label, bool failed_before) {
+      if (!failed_before && failed()) { path.push_back(label); }
+    }
+
+    // Add another log's errors, with a prefix on the text
+    void append(const ErrorLog& other, std::string_view prefix = "") {
+      if (other.failed() && !failed()) {
+        code = other.code;
+        offset = other.offset;
+        path = other.path;
+      }
+      if (!other.text.empty()) {
+        text += prefix;
+        text += other.text;
+      }
+    }
+
+    // The fields around the first error, outermost first, like "points.x"
+    std::string field_path() const {
+      std::string result;
+      for (size_t i = path.size(); i-- > 0; ) {
+        result += path[i];
+        if (i != 0) { result += '.'; }
+      }
+      return result;
+    }
+
+    // A one line description of the first error
+    std::string summary() const {
+      if (!failed()) { return ""; }
+      std::string result = error_code_name(code);
+      if (offset != unknown_offset) { result += " at byte " + std::to_string(offset); }
+      if (!path.empty()) { result += " in " + field_path(); }
+      return result;
+    }
+
+    template<typename T>
+    ErrorLog& operator << (const T& value) {
+      if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        text += std::string_view(value);
+      } else if constexpr (std::is_same_v<T, char>) {
+        text += value;
+      } else if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        text.append(buffer, result.ptr);
+      } else {
+        std::ostringstream out;
+        out << value;
+        text += out.str();
+      }
+      return *this;
+    }
+
+    // For std::endl
+    ErrorLog& operator << (std::ostream& (*)(std::ostream&)) {
+      text += '\n';
+      return *this;
+    }
+  };
+
+  /* The JSON and Lua readers write errors to an ErrorSink, which is
+   * either an ErrorLog or a std::ostream supplied by the caller. An
+   * ostream (such as a std::stringstream) works as it always has; an
+   * ErrorLog costs nothing when there are no errors, and also
+   * records the error code and field path.
+   */
+  struct ErrorSink {
+    ErrorLog* log = nullptr;
+    std::ostream* stream = nullptr;
+
+    ErrorSink(ErrorLog& log_): log(&log_) {}
+    ErrorSink(std::ostream& stream_): stream(&stream_) {}
+
+    bool failed() const { return log && log->failed(); }
+
+    ErrorSink& error(ErrorCode code, uint64_t offset = ErrorLog::unknown_offset) {
+      if (log) { log->error(code, offset); }
+      return *this;
+    }
+
+    void note_field(const char* label, bool failed_before) {
+      if (log) { log->note_field(label, failed_before); }
+    }
+
+    template<typename T>
+    ErrorSink& operator << (const T& value) {
+      if (log) { *log << value; } else { *stream << value; }
+      return *this;
+    }
+
+    ErrorSink& operator << (std::ostream& (*manipulator)(std::ostream&)) {
+      if (log) { *log << manipulator; } else { *stream << manipulator; }
+      return *this;
+    }
+  };
+
+  template<typename Visitor>
+  constexpr bool has_error_log = requires (Visitor& visitor) {
+    visitor.errors.note_field("", false);
+  };
+
+  template<typename Visitor>
+  constexpr bool has_fail_fast = requires (Visitor& visitor) {
+    bool(visitor.fail_fast);
+  };
+
+  // With fail_fast set, a reader stops at its first error
+  template<typename Reader>
+  bool stopped(const Reader& reader) {
+    return reader.fail_fast && reader.errors.failed();
+  }
+}
+
 
 namespace traverse {
 
@@ -43,7 +243,7 @@ namespace traverse {
    *
    *     template<typename Visitor>
    *     void visit(Visitor& visitor, MyUserType& obj) {
-   *       visit_struct("MyUserType", visitor)
+   *       visit_struct("MyUserType", visitor, obj)
    *          .field("x", obj.x)
    *          .field("y", obj.y);
    *     }
@@ -57,15 +257,178 @@ namespace traverse {
    * constructor and destructor.
    *
    * All serializable fields must be public.
+   *
+   * TRAVERSE_STRUCT also makes a FieldTable with the field names in
+   * order. Readers for formats with named fields can match them up
+   * with the input in one pass instead of searching the input once
+   * for each field. A StructVisitor that wants the table has a
+   * constructor StructVisitor(name, visitor, const FieldTable&); the
+   * n-th call to field() is then for fields.names[n].
+   *
+   * It also declares StructFields<MyUserType>::types(obj), whose
+   * return type lists the field types, so that fixed_encoding() can
+   * tell at compile time which structs only hold numbers. The visit()
+   * functions first give the visitor a chance to handle those structs
+   * all at once with visit_fixed().
+   *
+   * When TRAVERSE_INSTRUMENT is defined, the visit() functions also
+   * count the calls, bytes, and time of each struct and field for the
+   * Profile in traverse-instrument.h. Without it, they're as above.
    */
-  
+
+  struct FieldTable {
+    static constexpr size_t npos = size_t(-1);
+    std::vector<std::string_view> names; // in the order they're visited
+    std::vector<uint32_t> sorted;        // indices into names, sorted by name
+
+    size_t size() const { return names.size(); }
+    
+    // Returns the index of the field with this name, or npos
+    size_t find(std::string_view name) const {
+      auto i = std::lower_bound(sorted.begin(), sorted.end(), name,
+                                [this](uint32_t index, std::string_view key) {
+                                  return names[index] < key;
+                                });
+      if (i == sorted.end() || names[*i] != name) { return npos; }
+      return *i;
+    }
+  };
+
+  struct FieldTableBuilder {
+    FieldTable table;
+    template<typename T>
+    FieldTableBuilder& field(const char* label, const T&) {
+      table.names.push_back(label);
+      return *this;
+    }
+    FieldTable build() {
+      for (uint32_t i = 0; i < table.names.size(); ++i) {
+        table.sorted.push_back(i);
+      }
+      std::stable_sort(table.sorted.begin(), table.sorted.end(),
+                       [this](uint32_t a, uint32_t b) {
+                         return table.names[a] < table.names[b];
+                       });
+      return std::move(table);
+    }
+  };
+
+  // Specialized by TRAVERSE_STRUCT; the table is built on first use
+  template<typename T>
+  struct StructFields;
+
+  template<typename T>
+  constexpr bool has_struct_fields_v = requires (const T& obj) { StructFields<T>::table(obj); };
+
+  /* The types of a struct's fields, in order, are the type of
+   * StructFields<T>::types(obj). It's only used in decltype, so the
+   * field() calls are never made. */
+  template<typename ...Fields>
+  struct FieldTypes {
+    template<typename T>
+    FieldTypes<Fields..., std::remove_cvref_t<T>> field(const char*, const T&) const;
+  };
+
+  template<typename T>
+  constexpr bool is_std_array_v = false;
+  template<typename Element, size_t N>
+  constexpr bool is_std_array_v<std::array<Element, N>> = true;
+
+  /* Some types only hold numbers, so their binary encoding has a
+   * most bytes it can take. For those, max_size is that many bytes,
+   * and numbers is how many numbers are in it. For all other types,
+   * both are 0. Numbers are variable length integers; see
+   * write_unsigned_int() below.
+   */
+  struct FixedEncoding {
+    size_t max_size = 0;
+    size_t numbers = 0;
+  };
+
+  template<typename T>
+  constexpr FixedEncoding fixed_encoding();
+
+  template<typename ...Fields>
+  constexpr FixedEncoding fixed_encoding_of_fields(FieldTypes<Fields...>) {
+    if constexpr (sizeof...(Fields) > 0 && (... && (fixed_encoding<Fields>().max_size > 0))) {
+      return {(0 + ... + fixed_encoding<Fields>().max_size),
+              (0 + ... + fixed_encoding<Fields>().numbers)};
+    } else {
+      return {};
+    }
+  }
+
+  template<typename T>
+  constexpr FixedEncoding fixed_encoding() {
+    if constexpr (std::is_same_v<T, bool>) {
+      return {1, 1};
+    } else if constexpr (std::is_floating_point_v<T>) {
+      return {10, 1}; // written as a 64-bit integer
+    } else if constexpr (std::is_arithmetic_v<T>) {
+      return {(8 * sizeof(T) + 6) / 7, 1};
+    } else if constexpr (std::is_enum_v<T>) {
+      return fixed_encoding<std::underlying_type_t<T>>();
+    } else if constexpr (is_std_array_v<T>) {
+      constexpr FixedEncoding element = fixed_encoding<typename T::value_type>();
+      return {element.max_size * std::tuple_size_v<T>, element.numbers * std::tuple_size_v<T>};
+    } else if constexpr (has_struct_fields_v<T>) {
+      return fixed_encoding_of_fields(decltype(StructFields<T>::types(std::declval<const T&>())){});
+    } else {
+      return {};
+    }
+  }
+
+  template<typename T>
+  constexpr size_t max_encoded_size_v = fixed_encoding<T>().max_size;
+
+  /* A visitor can handle a whole struct at once instead of a field
+   * at a time by overloading visit_fixed() to return true. The
+   * binary writers and readers do this for structs that only hold
+   * numbers. */
+  template<typename Visitor, typename T>
+  constexpr bool visit_fixed(Visitor&, const T&) { return false; }
+
+  /* A reader can keep a slot for each field, such as a pointer to
+   * the field's input, while it makes its one pass over the input.
+   * Most structs fit in the inline slots, so this usually doesn't
+   * allocate. Only the first count slots are initialized.
+   */
+  template<typename Slot>
+  struct FieldSlots {
+    static constexpr size_t inline_size = 32;
+    Slot inline_slots[inline_size];
+    std::unique_ptr<Slot[]> heap_slots;
+    Slot* slots = inline_slots;
+
+    explicit FieldSlots(size_t count) {
+      if (count > inline_size) {
+        heap_slots.reset(new Slot[count]());
+        slots = heap_slots.get();
+      } else {
+        std::fill_n(slots, count, Slot{});
+      }
+    }
+    FieldSlots(const FieldSlots&) = delete;
+    FieldSlots& operator = (const FieldSlots&) = delete;
+    Slot& operator [] (size_t i) { return slots[i]; }
+  };
+
   template<typename Visitor>
   struct StructVisitor {
     const char* name;
     Visitor& visitor;
     template<typename T>
     StructVisitor& field([[maybe_unused]] const char* label, T& value) {
-      visit(visitor, value);
+      if constexpr (has_fail_fast<Visitor>) {
+        if (stopped(visitor)) { return *this; }
+      }
+      if constexpr (has_error_log<Visitor>) {
+        bool failed = visitor.errors.failed();
+        visit(visitor, value);
+        visitor.errors.note_field(label, failed);
+      } else {
+        visit(visitor, value);
+      }
       return *this;
     }
   };
@@ -75,14 +438,193 @@ namespace traverse {
     return StructVisitor<Visitor>{name, visitor};
   }
 
+  template<typename Visitor, typename T>
+  StructVisitor<Visitor> visit_struct(const char* name, Visitor& visitor, const T& obj) {
+    if constexpr (std::is_constructible_v<StructVisitor<Visitor>, const char*, Visitor&, const FieldTable&>) {
+      return StructVisitor<Visitor>(name, visitor, StructFields<T>::table(obj));
+    } else {
+      return StructVisitor<Visitor>{name, visitor};
+    }
+  }
+
+  /* Variants are visited through VariantTraits, so that every variant
+   * type works with every visitor. It's specialized for std::variant
+   * here and for mapbox::util::variant in traverse-variant.h:
+   *
+   * - size: the number of alternatives
+   * - index(value): which alternative the value holds
+   * - emplace<I>(value): switch the value to a default constructed
+   *      alternative I, and return a reference to it
+   * - apply(function, value): call function with the held alternative
+   */
+  template<typename VariantType>
+  struct VariantTraits;
+
+  template<typename ...Alternatives>
+  struct VariantTraits<std::variant<Alternatives...>> {
+    using VariantType = std::variant<Alternatives...>;
+    static constexpr size_t size = sizeof...(Alternatives);
+    static size_t index(const VariantType& value) { return value.index(); }
+    template<size_t I>
+    static auto& emplace(VariantType& value) { return value.template emplace<I>(); }
+    template<typename Function>
+    static void apply(Function&& function, const VariantType& value) {
+      std::visit(std::forward<Function>(function), value);
+    }
+  };
+
+  template<typename T>
+  constexpr bool is_variant_v = requires { VariantTraits<std::remove_const_t<T>>::size; };
+
+  /* Readers get the alternative's index from the input. Instead of
+   * comparing it with each alternative in turn, they look up the
+   * function that reads that alternative in a table. Returns false
+   * if the index is out of range.
+   */
+  template<typename Reader, typename VariantType, size_t I>
+  void visit_alternative(Reader& reader, VariantType& value) {
+    visit(reader, VariantTraits<VariantType>::template emplace<I>(value));
+  }
+
+  template<typename Reader, typename VariantType, size_t ...I>
+  constexpr auto make_alternative_table(std::index_sequence<I...>) {
+    using Function = void (*)(Reader&, VariantType&);
+    return std::array<Function, sizeof...(I)>{&visit_alternative<Reader, VariantType, I>...};
+  }
+
+  template<typename Reader, typename VariantType>
+  bool visit_alternative(Reader& reader, VariantType& value, uint64_t which) {
+    static constexpr auto table = make_alternative_table<Reader, VariantType>
+      (std::make_index_sequence<VariantTraits<VariantType>::size>());
+    if (which >= table.size()) { return false; }
+    table[size_t(which)](reader, value);
+    return true;
+  }
+
+  /* std::map and std::unordered_map are visited by the same code,
+   * which takes any type with is_map_v. */
+  template<typename T>
+  struct is_map : std::false_type {};
+
+  template<typename Key, typename Value, typename Compare, typename Allocator>
+  struct is_map<std::map<Key, Value, Compare, Allocator>> : std::true_type {};
+
+  template<typename Key, typename Value, typename Hash, typename Equal, typename Allocator>
+  struct is_map<std::unordered_map<Key, Value, Hash, Equal, Allocator>> : std::true_type {};
+
+  template<typename T>
+  constexpr bool is_map_v = is_map<std::remove_const_t<T>>::value;
+
+  // Maps with string keys are written as JSON and Lua objects
+  template<typename T>
+  struct is_string : std::false_type {};
+
+  template<typename Allocator>
+  struct is_string<std::basic_string<char, std::char_traits<char>, Allocator>> : std::true_type {};
+
+  template<typename Map>
+  constexpr bool has_string_key_v = is_string<typename Map::key_type>::value;
+
+  /* Versioned<T> holds a value with a version number that changes
+   * every time the value can change, so that a cache can tell whether
+   * it has seen this value before. Versions come from one counter, so
+   * no two values share a version unless one is a copy of the other.
+   * Change the value only through modify(). It's visited as the value
+   * it holds; a reader (a visitor with an error log) modifies it.
+   */
+  inline uint64_t next_version() {
+    static std::atomic<uint64_t> counter{1};
+    return counter.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  template<typename T>
+  class Versioned {
+    T value_;
+    uint64_t version_ = next_version();
+  public:
+    Versioned() = default;
+    Versioned(T value): value_(std::move(value)) {}
+
+    const T& get() const { return value_; }
+    uint64_t version() const { return version_; }
+
+    T& modify() {
+      version_ = next_version();
+      return value_;
+    }
+  };
+
+  /* Encoded Versioned values, by version, so that a value written
+   * many times is encoded once and copied after that. Give it to a
+   * writer by setting writer.cache; BinarySerialize, BufferSerialize,
+   * and the rapidjson writers use it. Each format has its own entries;
+   * a BufferSerialize with columnar set writes BINARY_COLUMNAR. It's
+   * cleared when the entries take more than max_bytes. It's only
+   * for one thread at a time.
+   */
+  struct SerializationCache {
+    enum Format { BINARY, JSON, BINARY_COLUMNAR };
+    std::unordered_map<uint64_t, std::string> fragments;
+    size_t bytes = 0;
+    size_t max_bytes = size_t(64) << 20;
+    size_t hits = 0;
+
+    // Versions don't get to 2^62, so the top two bits are free for the format
+    static uint64_t key(uint64_t version, Format format) {
+      return version | (uint64_t(format) << 62);
+    }
+
+    const std::string* find(uint64_t version, Format format) {
+      auto i = fragments.find(key(version, format));
+      if (i == fragments.end()) { return nullptr; }
+      hits++;
+      return &i->second;
+    }
+
+    const std::string& insert(uint64_t version, Format format, std::string fragment) {
+      if (bytes + fragment.size() > max_bytes) { clear(); }
+      bytes += fragment.size();
+      return fragments.insert_or_assign(key(version, format), std::move(fragment)).first->second;
+    }
+
+    void clear() {
+      fragments.clear();
+      bytes = 0;
+    }
+  };
+
+  template<typename Visitor, typename T>
+  void visit(Visitor& visitor, const Versioned<T>& versioned) {
+    visit(visitor, versioned.get());
+  }
+
+  template<typename Visitor, typename T>
+  void visit(Visitor& visitor, Versioned<T>& versioned) {
+    if constexpr (has_error_log<Visitor>) {
+      visit(visitor, versioned.modify());
+    } else {
+      visit(visitor, std::as_const(versioned));
+    }
+  }
+
   /* Each visitor type needs visit() functions for the standard types
    * it handles (primitives, strings, vectors) and optionally a
    * StructVisitor to handle the field name/value pairs in a struct.
+   *
+   * Visitors that take a variant use a template parameter for it,
+   * constrained with is_variant_v, rather than std::variant<...>&.
+   * Otherwise argument dependent lookup would pick std::visit for a
+   * non-const std::variant.
    */
 }
 
 
-#define TRAVERSE_STRUCT(TYPE, FIELDS) namespace traverse { template<typename Visitor> void visit(Visitor& visitor, TYPE& obj) { visit_struct(#TYPE, visitor) FIELDS ; } template<typename Visitor> void visit(Visitor& visitor, const TYPE& obj) { visit_struct(#TYPE, visitor) FIELDS ; } } inline std::ostream& operator << (std::ostream& out, const TYPE& obj) { traverse::CoutWriter writer(out); visit(writer, obj); return out; }
+#ifdef TRAVERSE_INSTRUMENT
+#define TRAVERSE_VISIT_FIELDS(TYPE, FIELDS) StructProbe<Visitor> probe(#TYPE, visitor); if (probe.profile || !visit_fixed(visitor, obj)) { instrument_fields(#TYPE, visitor, visit_struct(#TYPE, visitor, obj)) FIELDS ; }
+#else
+#define TRAVERSE_VISIT_FIELDS(TYPE, FIELDS) if (!visit_fixed(visitor, obj)) { visit_struct(#TYPE, visitor, obj) FIELDS ; }
+#endif
+#define TRAVERSE_STRUCT(TYPE, FIELDS) namespace traverse { template<> struct StructFields<TYPE> { static const FieldTable& table(const TYPE& obj) { static const FieldTable fields = [&obj]() { FieldTableBuilder builder; builder FIELDS; return builder.build(); }(); return fields; } static auto types(const TYPE& obj) -> decltype(FieldTypes<>{} FIELDS); }; template<typename Visitor> void visit(Visitor& visitor, TYPE& obj) { TRAVERSE_VISIT_FIELDS(TYPE, FIELDS) } template<typename Visitor> void visit(Visitor& visitor, const TYPE& obj) { TRAVERSE_VISIT_FIELDS(TYPE, FIELDS) } } inline std::ostream& operator << (std::ostream& out, const TYPE& obj) { traverse::CoutWriter writer(out); visit(writer, obj); return out; }
 #define FIELD(NAME) .field(#NAME, obj.NAME)
 
 
@@ -106,16 +648,21 @@ namespace traverse {
     writer.out << (long long)(value);
   }
 
-  inline void visit(CoutWriter& writer, const std::string& string) {
+  template<typename Allocator>
+  void visit(CoutWriter& writer, const std::basic_string<char, std::char_traits<char>, Allocator>& string) {
 #if __cplusplus >= 201400L
     writer.out << std::quoted(string);
 #else
     writer.out << '"' << string << '"';
 #endif
   }
+
+  inline void visit(CoutWriter& writer, const std::string_view& string) {
+    writer.out << std::quoted(string);
+  }
   
-  template<typename Element>
-  void visit(CoutWriter& writer, const std::vector<Element>& vector) {
+  template<typename Element, typename Allocator>
+  void visit(CoutWriter& writer, const std::vector<Element, Allocator>& vector) {
     writer.out << '[';
     for (size_t i = 0; i < vector.size(); ++i) {
       if (i != 0) writer.out << ", ";
@@ -124,6 +671,55 @@ namespace traverse {
     writer.out << ']';
   }
 
+  template<typename Element>
+  void visit(CoutWriter& writer, const std::span<Element>& span) {
+    writer.out << '[';
+    for (size_t i = 0; i < span.size(); ++i) {
+      if (i != 0) writer.out << ", ";
+      visit(writer, span[i]);
+    }
+    writer.out << ']';
+  }
+
+  template<typename T>
+  void visit(CoutWriter& writer, const std::optional<T>& value) {
+    if (value) { visit(writer, *value); }
+    else { writer.out << "null"; }
+  }
+
+  template<typename T>
+  void visit(CoutWriter& writer, const std::unique_ptr<T>& pointer) {
+    if (pointer) { visit(writer, *pointer); }
+    else { writer.out << "null"; }
+  }
+
+  template<typename Element, size_t N>
+  void visit(CoutWriter& writer, const std::array<Element, N>& array) {
+    visit(writer, std::span<const Element>(array));
+  }
+
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map>>
+  visit(CoutWriter& writer, const Map& map) {
+    writer.out << '{';
+    bool first = true;
+    for (const auto& [key, value] : map) {
+      if (!first) writer.out << ", ";
+      first = false;
+      visit(writer, key);
+      writer.out << ": ";
+      visit(writer, value);
+    }
+    writer.out << '}';
+  }
+
+  template<typename VariantType> inline
+  std::enable_if_t<is_variant_v<VariantType>>
+  visit(CoutWriter& writer, VariantType& value) {
+    VariantTraits<std::remove_const_t<VariantType>>::apply
+      ([&](const auto& alternative) { visit(writer, alternative); }, value);
+  }
+
   template<>
   struct StructVisitor<CoutWriter> {
     const char* name;
@@ -187,7 +783,10 @@ namespace traverse {
         return false;
       }
       bool endbit = (c & 0x80) == 0;
-      result |= uint64_t(c & 0x7f) << (byte * 7);
+      if (byte * 7 < 64) {
+        // Bits past 64 can only come from a malformed number; drop them
+        result |= uint64_t(c & 0x7f) << (byte * 7);
+      }
       if (endbit) {
         break;
       }
@@ -213,6 +812,18 @@ namespace traverse {
     }
     return status;
   }
+
+  // Number of bytes write_unsigned_int and write_signed_int will use
+  inline size_t unsigned_int_size(uint64_t value) {
+    // 7 bits per byte, and zero still takes one byte
+    return (std::bit_width(value | 1) + 6) / 7;
+  }
+
+  inline size_t signed_int_size(int64_t value) {
+    return unsigned_int_size((value < 0)
+                             ? ((uint64_t(-(value+1)) << 1) | 1)
+                             : (value << 1));
+  }
   
 }
 
@@ -225,9 +836,15 @@ namespace traverse {
 
   struct BinarySerialize {
     std::streambuf& out;
+    SerializationCache* cache = nullptr;
     BinarySerialize(std::streambuf& out_): out(out_) {}
   };
 
+  inline uint64_t output_offset(BinarySerialize& writer) {
+    auto pos = writer.out.pubseekoff(0, std::ios::cur, std::ios::out);
+    return pos < 0 ? ErrorLog::unknown_offset : uint64_t(pos);
+  }
+
   template<typename T> inline
   std::enable_if_t<std::is_arithmetic_v<T> && !std::is_signed_v<T>>
   visit(BinarySerialize& writer, const T& value) {
@@ -255,14 +872,23 @@ namespace traverse {
     visit(writer, std::underlying_type_t<T>(value));
   }
   
-  inline void visit(BinarySerialize& writer, const std::string& string) {
+  template<typename Allocator>
+  void visit(BinarySerialize& writer, const std::basic_string<char, std::char_traits<char>, Allocator>& string) {
     uint64_t size = string.size();
     write_unsigned_int(writer.out, size);
     writer.out.sputn(&string[0], size);
   }
   
-  template<typename Element>
-  void visit(BinarySerialize& writer, const std::vector<Element>& vector) {
+  // Views are written the same way as the owning types, so that a
+  // struct of views and a struct of owning types can share a format
+  inline void visit(BinarySerialize& writer, const std::string_view& string) {
+    uint64_t size = string.size();
+    write_unsigned_int(writer.out, size);
+    writer.out.sputn(string.data(), size);
+  }
+  
+  template<typename Element, typename Allocator>
+  void visit(BinarySerialize& writer, const std::vector<Element, Allocator>& vector) {
     uint64_t size = vector.size();
     write_unsigned_int(writer.out, size);
     for (auto& element : vector) {
@@ -270,20 +896,315 @@ namespace traverse {
     }
   }
 
+  template<typename Element>
+  void visit(BinarySerialize& writer, const std::span<Element>& span) {
+    uint64_t size = span.size();
+    write_unsigned_int(writer.out, size);
+    for (auto& element : span) {
+      visit(writer, element);
+    }
+  }
+
+  /* An optional value or a pointer is 1 followed by the value, or 0
+   * if there's no value. An array has no size in front, since the
+   * size is part of the type. A map is the size, then each key
+   * followed by its value. */
+  template<typename T>
+  void visit(BinarySerialize& writer, const std::optional<T>& value) {
+    write_unsigned_int(writer.out, value.has_value());
+    if (value) { visit(writer, *value); }
+  }
+
+  template<typename T>
+  void visit(BinarySerialize& writer, const std::unique_ptr<T>& pointer) {
+    write_unsigned_int(writer.out, pointer != nullptr);
+    if (pointer) { visit(writer, *pointer); }
+  }
+
+  template<typename Element, size_t N>
+  void visit(BinarySerialize& writer, const std::array<Element, N>& array) {
+    for (const auto& element : array) {
+      visit(writer, element);
+    }
+  }
+
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map>>
+  visit(BinarySerialize& writer, const Map& map) {
+    write_unsigned_int(writer.out, map.size());
+    for (const auto& [key, value] : map) {
+      visit(writer, key);
+      visit(writer, value);
+    }
+  }
+
+  // A variant is the index of the alternative, then the alternative
+  template<typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType>>
+  visit(BinarySerialize& writer, VariantType& value) {
+    using Traits = VariantTraits<std::remove_const_t<VariantType>>;
+    write_unsigned_int(writer.out, Traits::index(value));
+    Traits::apply([&](const auto& alternative) { visit(writer, alternative); }, value);
+  }
+
+  // With a cache, a Versioned value is encoded once per version
+  template<typename T>
+  void visit(BinarySerialize& writer, const Versioned<T>& versioned) {
+    if (writer.cache == nullptr) {
+      visit(writer, versioned.get());
+      return;
+    }
+    const std::string* fragment = writer.cache->find(versioned.version(), SerializationCache::BINARY);
+    if (fragment == nullptr) {
+      std::stringbuf buf;
+      BinarySerialize fragment_writer(buf);
+      fragment_writer.cache = writer.cache;
+      visit(fragment_writer, versioned.get());
+      fragment = &writer.cache->insert(versioned.version(), SerializationCache::BINARY, std::move(buf).str());
+    }
+    writer.out.sputn(fragment->data(), std::streamsize(fragment->size()));
+  }
+
+
+  /* The SizeCounter walks the same data as BinarySerialize, adding
+   * up how many bytes it would write instead of writing them. Use it
+   * to allocate an output buffer of exactly the right size.
+   *
+   *     traverse::SizeCounter counter;
+   *     visit(counter, yourobject);
+   *     // counter.size is the number of bytes
+   */
+  struct SizeCounter {
+    size_t size = 0;
+  };
+
+  inline uint64_t output_offset(SizeCounter& counter) {
+    return counter.size;
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T> && !std::is_signed_v<T>>
+  visit(SizeCounter& counter, const T& value) {
+    counter.size += unsigned_int_size(uint64_t(value));
+  }
+
+  template<typename T> inline
+  std::enable_if_t<std::is_arithmetic_v<T> && std::is_signed_v<T>>
+  visit(SizeCounter& counter, const T& value) {
+    counter.size += signed_int_size(value);
+  }
+
+  // Always treat char as unsigned
+  inline void visit(SizeCounter& counter, const char& value) {
+    visit(counter, static_cast<unsigned char>(value));
+  }
+  inline void visit(SizeCounter& counter, const signed char& value) {
+    visit(counter, static_cast<unsigned char>(value));
+  }
+
+  template <typename T>
+  inline std::enable_if_t<std::is_enum_v<T>>
+  visit(SizeCounter& counter, const T& value) {
+    visit(counter, std::underlying_type_t<T>(value));
+  }
+
+  inline void visit(SizeCounter& counter, const std::string_view& string) {
+    counter.size += unsigned_int_size(string.size()) + string.size();
+  }
+
+  template<typename Allocator>
+  void visit(SizeCounter& counter, const std::basic_string<char, std::char_traits<char>, Allocator>& string) {
+    visit(counter, std::string_view(string));
+  }
+
+  template<typename Element>
+  void visit(SizeCounter& counter, const std::span<Element>& span) {
+    counter.size += unsigned_int_size(span.size());
+    for (auto& element : span) {
+      visit(counter, element);
+    }
+  }
+
+  template<typename Element, typename Allocator>
+  void visit(SizeCounter& counter, const std::vector<Element, Allocator>& vector) {
+    counter.size += unsigned_int_size(vector.size());
+    for (auto& element : vector) {
+      visit(counter, element);
+    }
+  }
+
+  template<typename T>
+  void visit(SizeCounter& counter, const std::optional<T>& value) {
+    counter.size += 1;
+    if (value) { visit(counter, *value); }
+  }
+
+  template<typename T>
+  void visit(SizeCounter& counter, const std::unique_ptr<T>& pointer) {
+    counter.size += 1;
+    if (pointer) { visit(counter, *pointer); }
+  }
+
+  template<typename Element, size_t N>
+  void visit(SizeCounter& counter, const std::array<Element, N>& array) {
+    for (const auto& element : array) {
+      visit(counter, element);
+    }
+  }
+
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map>>
+  visit(SizeCounter& counter, const Map& map) {
+    counter.size += unsigned_int_size(map.size());
+    for (const auto& [key, value] : map) {
+      visit(counter, key);
+      visit(counter, value);
+    }
+  }
+
+  template<typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType>>
+  visit(SizeCounter& counter, VariantType& value) {
+    using Traits = VariantTraits<std::remove_const_t<VariantType>>;
+    counter.size += unsigned_int_size(Traits::index(value));
+    Traits::apply([&](const auto& alternative) { visit(counter, alternative); }, value);
+  }
+
+
+  /* Each reader has a memory_resource* field. When it's set,
+   * std::pmr strings and vectors are switched over to that resource
+   * before being read into, so that a whole message, including the
+   * containers inside structs, can be allocated from one arena:
+   *
+   *     std::pmr::monotonic_buffer_resource arena;
+   *     reader.resource = &arena;
+   *     visit(reader, message);
+   *
+   * The message must not outlive the arena. Containers with other
+   * allocators are read the usual way.
+   */
+  template<typename Container>
+  void use_resource(Container& container, std::pmr::memory_resource* resource) {
+    using Allocator = typename Container::allocator_type;
+    if constexpr (std::is_same_v<Allocator, std::pmr::polymorphic_allocator<typename Container::value_type>>) {
+      if (resource != nullptr && container.get_allocator().resource() != resource) {
+        // A container's allocator can't be changed by assignment
+        container.~Container();
+        ::new (static_cast<void*>(&container)) Container(Allocator(resource));
+      }
+    }
+  }
 
+
+  /* The sizes of strings and vectors come from the input, so they
+   * can't be trusted. To limit how much memory a message can make
+   * the reader allocate, set these fields before visit():
+   *
+   * - max_elements: the largest vector allowed, or 0 for no limit
+   * - max_bytes: the most bytes of string and vector data allowed
+   *      for the whole message, or 0 for no limit. A vector is
+   *      counted as size * sizeof(element).
+   * - reserve_limit: the most elements to reserve space for before
+   *      reading them, when the streambuf doesn't know how much input
+   *      there is. When streambuf::in_avail() says there are N bytes,
+   *      up to N elements are reserved instead, since every element
+   *      takes at least one byte. That way a legitimate vector is
+   *      allocated once, and a fake size can't allocate more than
+   *      the input could fill.
+   *
+   * A size that's over a limit is an error, and the vector or string
+   * is left empty.
+   *
+   * Set update_in_place to true when reading into an object that
+   * still holds an earlier message, such as one reused every tick.
+   * Vectors are then shortened or lengthened instead of cleared, and
+   * existing elements are read into, so the strings and vectors
+   * inside them keep their capacity. When each message has the same
+   * number of elements as the one before, and no longer strings than
+   * the object has held, reading doesn't allocate. If there's an
+   * error, an element may be left with some of its old values.
+   *
+   * Set resource to read std::pmr containers into a memory_resource;
+   * see use_resource() above.
+   *
+   * Set fail_fast to true to stop at the first error. Every visit()
+   * and struct field after that returns right away, so a corrupt
+   * message is rejected without reading the rest of it. Values after
+   * the error are left unchanged, and Errors() has only that error.
+   */
   struct BinaryDeserialize {
     std::streambuf& in;
-    std::stringstream errors;
+    ErrorLog errors;
+    uint64_t max_elements = 0;
+    uint64_t max_bytes = 0;
+    uint64_t reserve_limit = 65536;
+    uint64_t bytes_used = 0;
+    bool update_in_place = false;
+    bool fail_fast = false;
+    std::pmr::memory_resource* resource = nullptr;
     BinaryDeserialize(std::streambuf& buf): in(buf) {}
     std::string Errors() { return errors.str(); }
   };
+
+  // Where the reader is in its input, for error messages
+  inline uint64_t input_offset(BinaryDeserialize& reader) {
+    auto pos = reader.in.pubseekoff(0, std::ios::cur, std::ios::in);
+    return pos < 0 ? ErrorLog::unknown_offset : uint64_t(pos);
+  }
+
+  // Start an error at the reader's position in the input
+  template<typename Reader>
+  ErrorLog& fail(Reader& reader, ErrorCode code) {
+    return reader.errors.error(code, input_offset(reader));
+  }
+
+  // Charge a string or vector to the reader's max_bytes budget
+  template<typename Reader>
+  bool check_bytes_limit(Reader& reader, uint64_t size, uint64_t element_size, const char* kind) {
+    if (reader.max_bytes == 0) { return true; }
+    uint64_t budget = reader.max_bytes - std::min(reader.bytes_used, reader.max_bytes);
+    if (size > budget / element_size) {
+      fail(reader, ErrorCode::SIZE_LIMIT) << "Error: " << kind << " of size " << size
+                    << " is over the limit of " << reader.max_bytes
+                    << " bytes\n";
+      return false;
+    }
+    reader.bytes_used += size * element_size;
+    return true;
+  }
+
+  template<typename Reader>
+  bool check_vector_limits(Reader& reader, uint64_t size, uint64_t element_size) {
+    if (reader.max_elements != 0 && size > reader.max_elements) {
+      fail(reader, ErrorCode::SIZE_LIMIT) << "Error: vector of size " << size
+                    << " is over the limit of " << reader.max_elements
+                    << " elements\n";
+      return false;
+    }
+    return check_bytes_limit(reader, size, element_size, "vector");
+  }
+
+  inline bool read_unsigned_int(BinaryDeserialize& reader, uint64_t& value) {
+    return read_unsigned_int(reader.in, value);
+  }
+
+  inline bool at_end(BinaryDeserialize& reader) {
+    return reader.in.sgetc() == std::streambuf::traits_type::eof();
+  }
+
+  // How much to reserve for an untrusted size
+  inline uint64_t reserve_size(BinaryDeserialize& reader, uint64_t size) {
+    std::streamsize available = reader.in.in_avail();
+    return std::min(size, available > 0 ? uint64_t(available) : reader.reserve_limit);
+  }
  
   template<typename T> inline
   std::enable_if_t<std::is_arithmetic_v<T> && !std::is_signed_v<T>>
   visit(BinaryDeserialize& reader, T& value) {
-    uint64_t wide_value;
+    if (stopped(reader)) { return; }
+    uint64_t wide_value = 0;
     if (!read_unsigned_int(reader.in, wide_value)) {
-      reader.errors << "Error: not enough data in buffer to read number\n";
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read number\n";
     }
     value = static_cast<T>(wide_value);
   }
@@ -291,20 +1212,23 @@ namespace traverse {
   template<typename T> inline
   std::enable_if_t<std::is_arithmetic_v<T> && std::is_signed_v<T>>
   visit(BinaryDeserialize& reader, T& value) {
-    int64_t wide_value;
+    if (stopped(reader)) { return; }
+    int64_t wide_value = 0;
     if (!read_signed_int(reader.in, wide_value)) {
-      reader.errors << "Error: not enough data in buffer to read number\n";
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read number\n";
     }
     value = static_cast<T>(wide_value);
   }
 
   // Always treat char as unsigned
   inline void visit(BinaryDeserialize& reader, char& value) {
+    if (stopped(reader)) { return; }
     unsigned char u;
     visit(reader, u);
     value = static_cast<char>(u);
   }
   inline void visit(BinaryDeserialize& reader, signed char& value) {
+    if (stopped(reader)) { return; }
     unsigned char u;
     visit(reader, u);
     value = static_cast<signed char>(u);
@@ -313,17 +1237,21 @@ namespace traverse {
   template<typename T> inline
   std::enable_if_t<std::is_enum_v<T>>
   visit(BinaryDeserialize& reader, T& value) {
+    if (stopped(reader)) { return; }
     std::underlying_type_t<T> v;
     visit(reader, v);
     value = static_cast<T>(v);
   }
 
-  inline void visit(BinaryDeserialize& reader, std::string& string) {
+  template<typename Allocator>
+  void visit(BinaryDeserialize& reader, std::basic_string<char, std::char_traits<char>, Allocator>& string) {
+    if (stopped(reader)) { return; }
     uint64_t size = 0;
     if (!read_unsigned_int(reader.in, size)) {
-      reader.errors << "Error: not enough data in buffer to read string size\n";
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read string size\n";
       return;
     }
+    use_resource(string, reader.resource);
 
     /* Copy blocks out of the input stream into the output string.
      * 
@@ -332,9 +1260,13 @@ namespace traverse {
      * and there may not actually be 'size' bytes available in the
      * stream.
      */
+    string.resize(0);
+    if (!check_bytes_limit(reader, size, 1, "string")) {
+      return;
+    }
+    string.reserve(reserve_size(reader, size));
     const size_t buffersize = 1024;
     char buffer[buffersize];
-    string.resize(0);
     size_t bytes_remaining = size;
     while (bytes_remaining > 0
            && reader.in.sgetc() != std::streambuf::traits_type::eof()) {
@@ -342,34 +1274,178 @@ namespace traverse {
       size_t bytes_actually_read = reader.in.sgetn(buffer, bytes_to_read);
       string.append(buffer, buffer + bytes_actually_read);
       if (bytes_actually_read < bytes_to_read) {
-        reader.errors << "Error: expected " << size
+        fail(reader, ErrorCode::END_OF_INPUT) << "Error: expected " << size
                       << " bytes in string but only found "
-                      << (string.size() + bytes_actually_read) << "\n";
+                      << string.size() << "\n";
         return;
       }
       bytes_remaining -= bytes_actually_read;
     }
   }
   
-  template<typename Element>
-  void visit(BinaryDeserialize& reader, std::vector<Element>& vector) {
+  template<typename Element, typename Allocator>
+  void visit(BinaryDeserialize& reader, std::vector<Element, Allocator>& vector) {
+    if (stopped(reader)) { return; }
     uint64_t i = 0, size = 0;
     if (!read_unsigned_int(reader.in, size)) {
-      reader.errors << "Error: not enough data in buffer to read vector size\n";
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read vector size\n";
       return;
     }
-    vector.clear();
+    use_resource(vector, reader.resource);
+    if (!reader.update_in_place) {
+      vector.clear();
+    }
+    if (!check_vector_limits(reader, size, sizeof(Element))) {
+      vector.clear();
+      return;
+    }
+    vector.reserve(reserve_size(reader, size));
     for (; i < size && reader.in.sgetc() != std::streambuf::traits_type::eof(); ++i) {
-      vector.emplace_back();
-      visit(reader, vector.back());
+      if (i == vector.size()) {
+        vector.emplace_back();
+      }
+      visit(reader, vector[i]);
+      if (stopped(reader)) { ++i; break; }
     }
-    if (i != size) {
-      reader.errors << "Error: expected " << size
+    vector.erase(vector.begin() + i, vector.end());
+    if (i != size && !stopped(reader)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: expected " << size
                     << " elements in vector but only found "
                     << i << "\n";
     }
   }
+
+  /* The reader for a variant switches it to the alternative named in
+   * the input, even if it already held that alternative. */
+  template<typename Reader, typename VariantType>
+  void read_variant(Reader& reader, VariantType& value) {
+    if (stopped(reader)) { return; }
+    uint64_t which = 0;
+    visit(reader, which);
+    if (!visit_alternative(reader, value, which)) {
+      fail(reader, ErrorCode::BAD_VALUE) << "Error: tried to deserialize variant " << which
+                    << " but there were only " << VariantTraits<VariantType>::size << " types.\n";
+    }
+  }
+
+  template<typename VariantType>
+  std::enable_if_t<is_variant_v<VariantType> && !std::is_const_v<VariantType>>
+  visit(BinaryDeserialize& reader, VariantType& value) {
+    read_variant(reader, value);
+  }
+
+  /* These are shared by the streambuf and buffer readers. An
+   * optional value or pointer is switched to a new value unless
+   * update_in_place is set and it already has one. A map is always
+   * cleared first. Its entries are inserted with end() as the hint,
+   * which is constant time for a std::map when the keys are in
+   * order, as they are when written from a std::map.
+   */
+  template<typename Reader>
+  bool read_presence(Reader& reader, bool& present) {
+    uint64_t tag = 0;
+    if (!read_unsigned_int(reader, tag)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read number\n";
+      return false;
+    }
+    if (tag > 1) {
+      fail(reader, ErrorCode::BAD_VALUE) << "Error: expected 0 or 1 before an optional value, found "
+                    << tag << "\n";
+      return false;
+    }
+    present = tag == 1;
+    return true;
+  }
+
+  template<typename Reader, typename T>
+  void read_optional(Reader& reader, std::optional<T>& value) {
+    if (stopped(reader)) { return; }
+    bool present = false;
+    if (!read_presence(reader, present)) { return; }
+    if (!present) {
+      value.reset();
+      return;
+    }
+    if (!value || !reader.update_in_place) { value.emplace(); }
+    visit(reader, *value);
+  }
+
+  template<typename Reader, typename T>
+  void read_pointer(Reader& reader, std::unique_ptr<T>& pointer) {
+    if (stopped(reader)) { return; }
+    bool present = false;
+    if (!read_presence(reader, present)) { return; }
+    if (!present) {
+      pointer.reset();
+      return;
+    }
+    if (!pointer || !reader.update_in_place) { pointer = std::make_unique<T>(); }
+    visit(reader, *pointer);
+  }
+
+  template<typename Reader, typename Map>
+  void read_map(Reader& reader, Map& map) {
+    if (stopped(reader)) { return; }
+    uint64_t i = 0, size = 0;
+    if (!read_unsigned_int(reader, size)) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: not enough data in buffer to read map size\n";
+      return;
+    }
+    use_resource(map, reader.resource);
+    map.clear();
+    if (!check_vector_limits(reader, size, sizeof(typename Map::value_type))) {
+      return;
+    }
+    if constexpr (requires { map.reserve(size_t(size)); }) {
+      map.reserve(size_t(reserve_size(reader, size)));
+    }
+    for (; i < size && !at_end(reader); ++i) {
+      typename Map::key_type key{};
+      typename Map::mapped_type value{};
+      visit(reader, key);
+      visit(reader, value);
+      if (stopped(reader)) { return; }
+      size_t before = map.size();
+      map.emplace_hint(map.end(), std::move(key), std::move(value));
+      if (map.size() == before) {
+        fail(reader, ErrorCode::BAD_VALUE) << "Error: duplicate key in map\n";
+        if (stopped(reader)) { return; }
+      }
+    }
+    if (i != size) {
+      fail(reader, ErrorCode::END_OF_INPUT) << "Error: expected " << size
+                    << " elements in map but only found "
+                    << i << "\n";
+    }
+  }
+
+  template<typename T>
+  void visit(BinaryDeserialize& reader, std::optional<T>& value) {
+    read_optional(reader, value);
+  }
+
+  template<typename T>
+  void visit(BinaryDeserialize& reader, std::unique_ptr<T>& pointer) {
+    read_pointer(reader, pointer);
+  }
+
+  template<typename Element, size_t N>
+  void visit(BinaryDeserialize& reader, std::array<Element, N>& array) {
+    for (auto& element : array) {
+      visit(reader, element);
+    }
+  }
+
+  template<typename Map>
+  std::enable_if_t<is_map_v<Map> && !std::is_const_v<Map>>
+  visit(BinaryDeserialize& reader, Map& map) {
+    read_map(reader, map);
+  }
 }
 
 
+#ifdef TRAVERSE_INSTRUMENT
+#include "traverse-instrument.h"
+#endif
+
 #endif